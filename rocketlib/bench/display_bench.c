@@ -0,0 +1,153 @@
+#define _POSIX_C_SOURCE 200809L
+#define DISPLAY_IMPLEMENTATION
+#define DISPLAY_STRIP_PREFIX
+#include <rocketlib.h>
+
+#include <threads.h>
+
+/// Line throughput of fprintln with 1..N threads writing into one shared file.
+/// After each run the file is read back to check that no line was torn.
+/// Every thread count is run several times, see bench.h for the baseline flags
+
+typedef struct worker_t {
+  FILE *file;
+  int id, lines;
+  rocket_t r;
+
+} worker_t;
+
+static int worker(void *arg) {
+  worker_t *w = (worker_t *)arg;
+  w->r.d.self = &w->r;
+
+  for (int i = 0; i < w->lines; i++) {
+    w->r.time = i * 1e-3;
+    fprintln(w->file, "%d,%d,{}", w->id, i, &w->r);
+  }
+
+  display_thread_buffer_free();
+  return 0;
+}
+
+/// @return Number of lines which don't look like the ones written by worker()
+static int count_torn_lines(FILE *file, int expected) {
+  char line[512];
+  int good = 0, total = 0;
+
+  rewind(file);
+  while (fgets(line, sizeof(line), file)) {
+    int id, i, commas = 0;
+    for (char *c = line; *c; c++)
+      commas += *c == ',';
+
+    total++;
+    if (sscanf(line, "%d,%d,", &id, &i) == 2 && commas == ROCKET_LOG_COLUMNS + 1 &&
+        line[strlen(line) - 1] == '\n')
+      good++;
+  }
+
+  return (total - good) + (expected - total);
+}
+
+void usage() {
+  puts("OPTIONS:\n"
+       "--threads <number>\tMaximum number of threads(default is 8)\n"
+       "--lines <number>\tLines written by every thread(default is 100000)\n"
+       "--repeats <number>\tRuns of every thread count(default is 5)\n"
+       "--baseline <file>\tWrite the results to a JSON baseline\n"
+       "--compare <file>\tCompare the results with a JSON baseline\n"
+       "--threshold <number>\tRegression threshold in percent(default is 5)\n"
+       "-h\t\t\tPrint this help message");
+}
+
+int main(int argc, char *argv[]) {
+  int max_threads = 8, lines = 100000, handled;
+  bench_t b = bench_init();
+
+  for (int i = 1; i < argc; i++) {
+    char *token = argv[i];
+    if ((handled = bench_parse_flag(&b, argc, argv, &i)) != 0) {
+      if (handled < 0)
+        return -1;
+    } else if (strcmp(token, "-h") == 0) {
+      usage();
+      return 0;
+    } else if (strcmp(token, "--threads") == 0 || strcmp(token, "--lines") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      int value = atoi(argv[++i]);
+      if (value <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--threads") == 0)
+        max_threads = value;
+      else
+        lines = value;
+    } else {
+      println("Unknown flag: %s", token);
+      return -1;
+    }
+  }
+
+  thrd_t *threads = (thrd_t *)malloc(sizeof(thrd_t) * max_threads);
+  worker_t *workers = (worker_t *)calloc(max_threads, sizeof(worker_t));
+  double *samples = (double *)malloc(sizeof(double) * b.repeats);
+  if (!threads || !workers || !samples)
+    return -1;
+
+  println("threads,lines,seconds,mad,lines_per_second,torn_lines");
+  for (int n = 1; n <= max_threads; n++) {
+    int total = n * lines, torn = 0;
+
+    for (int k = 0; k < b.repeats; k++) {
+      FILE *file = tmpfile();
+      if (!file)
+        return -1;
+      setvbuf(file, NULL, _IOFBF, LOGGER_BUFFER_SIZE);
+
+      double start = bench_now();
+      int started = 0;
+      for (int t = 0; t < n; t++) {
+        workers[t] = (worker_t){.file = file, .id = t, .lines = lines};
+        workers[t].r.d.sndisplay_fn = sndisplay_rocket;
+        workers[t].r.d.fdisplay_fn = fdisplay_rocket;
+        if (thrd_create(&threads[t], worker, &workers[t]) != thrd_success)
+          break;
+        started++;
+      }
+      for (int t = 0; t < started; t++)
+        thrd_join(threads[t], NULL);
+      if (started < n) {
+        fprintln(stderr, "Can't start %d threads", n);
+        fclose(file);
+        return -1;
+      }
+      fflush(file);
+      samples[k] = bench_now() - start;
+
+      torn += count_torn_lines(file, total);
+      fclose(file);
+    }
+
+    char name[BENCH_NAME_SIZE];
+    snprintf(name, sizeof(name), "fprintln/threads=%d", n);
+    const bench_result_t *res = bench_add(&b, name, samples, b.repeats);
+    if (!res)
+      return -1;
+
+    println("%d,%d,%.4f,%.4f,%.0f,%d", n, total, res->median, res->mad, total / res->median,
+            torn);
+  }
+
+  free(threads);
+  free(workers);
+  free(samples);
+
+  int status = bench_finish(&b);
+  bench_free(&b);
+
+  return status;
+}
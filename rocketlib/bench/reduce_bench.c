@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+#define DISPLAY_IMPLEMENTATION
+#define DISPLAY_STRIP_PREFIX
+#include <rocketlib.h>
+
+#include <stdint.h>
+
+/// Throughput of reduce_sum_pool and reduce_variance_pool with 1..N threads.
+/// Every result is compared bit for bit with the serial reduce_sum and reduce_variance, a
+/// difference makes the exit status nonzero. See bench.h for the baseline flags
+
+// Values of very different magnitudes, so that any change of the summation order shows up
+static void fill_values(double *values, size_t count) {
+  uint64_t state = 0x9E3779B97F4A7C15u;
+  for (size_t i = 0; i < count; i++) {
+    state = state * 6364136223846793005u + 1442695040888963407u;
+    double u = (double)(state >> 11) / (double)(1ull << 53);
+    values[i] = (u - 0.5) * pow(10, (int)(state % 13) - 6);
+  }
+}
+
+void usage() {
+  puts("OPTIONS:\n"
+       "--threads <number>\tMaximum number of threads(default is 8)\n"
+       "--values <number>\tNumber of values(default is 10000000)\n"
+       "--repeats <number>\tRuns of every thread count(default is 5)\n"
+       "--baseline <file>\tWrite the results to a JSON baseline\n"
+       "--compare <file>\tCompare the results with a JSON baseline\n"
+       "--threshold <number>\tRegression threshold in percent(default is 5)\n"
+       "-h\t\t\tPrint this help message");
+}
+
+int main(int argc, char *argv[]) {
+  int max_threads = 8, count = 10000000, handled;
+  bench_t b = bench_init();
+
+  for (int i = 1; i < argc; i++) {
+    char *token = argv[i];
+    if ((handled = bench_parse_flag(&b, argc, argv, &i)) != 0) {
+      if (handled < 0)
+        return -1;
+    } else if (strcmp(token, "-h") == 0) {
+      usage();
+      return 0;
+    } else if (strcmp(token, "--threads") == 0 || strcmp(token, "--values") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      int value = atoi(argv[++i]);
+      if (value <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--threads") == 0)
+        max_threads = value;
+      else
+        count = value;
+    } else {
+      println("Unknown flag: %s", token);
+      return -1;
+    }
+  }
+
+  double *values = (double *)malloc(sizeof(double) * count);
+  double *samples = (double *)malloc(sizeof(double) * b.repeats);
+  if (!values || !samples)
+    return -1;
+  fill_values(values, count);
+
+  double sum = reduce_sum(values, count);
+  double variance = reduce_variance(values, count, sum / count);
+  int mismatches = 0;
+
+  println("threads,values,seconds,mad,values_per_second,sum,variance,identical");
+  for (int n = 1; n <= max_threads; n++) {
+    pool_t *pool = pool_create(n);
+    if (!pool)
+      return -1;
+
+    double s = 0, v = 0;
+    for (int k = 0; k < b.repeats; k++) {
+      double start = bench_now();
+      s = reduce_sum_pool(pool, values, count);
+      v = reduce_variance_pool(pool, values, count, s / count);
+      samples[k] = bench_now() - start;
+    }
+    pool_free(pool);
+
+    bool identical = memcmp(&s, &sum, sizeof(double)) == 0 &&
+                     memcmp(&v, &variance, sizeof(double)) == 0;
+    mismatches += !identical;
+
+    char name[BENCH_NAME_SIZE];
+    snprintf(name, sizeof(name), "reduce/threads=%d", n);
+    const bench_result_t *res = bench_add(&b, name, samples, b.repeats);
+    if (!res)
+      return -1;
+
+    println("%d,%d,%.4f,%.4f,%.0f,%a,%a,%s", n, count, res->median, res->mad,
+            2.0 * count / res->median, s, v, identical ? "yes" : "NO");
+  }
+
+  free(values);
+  free(samples);
+
+  int status = bench_finish(&b);
+  bench_free(&b);
+
+  if (mismatches) {
+    fprintln(stderr, "%d thread count(s) gave a different result than the serial reduction",
+             mismatches);
+    return 1;
+  }
+
+  return status;
+}
@@ -36,6 +36,9 @@ int main() {
   println("Point = {}", &a); // Pass a pointer to the struct
   // Output: Point = (2,3)
 
+  putln("Point = ", &a, " x = ", a.x); // Typed variant, resolved at compile time
+  // Output: Point = (2,3) x = 2
+
   return 0;
 }
 ```
@@ -44,6 +47,13 @@ int main() {
 #ifndef DISPLAY_H
 #define DISPLAY_H
 
+// The implementation locks streams with POSIX flockfile, which a strict C11 <stdio.h> only
+// declares with a POSIX feature level. Files including other system headers before this one
+// define _POSIX_C_SOURCE themselves, on their first line
+#if defined(DISPLAY_IMPLEMENTATION) && !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <ctype.h>
 #include <stdarg.h>
 #include <stddef.h>
@@ -70,6 +80,27 @@ typedef struct display_t {
 
 } display_t;
 
+/*---------------------------Threading----------------------------*/
+
+// All print functions below can be called from several threads at once:
+// - Calls writing to a FILE render the text into a per-thread buffer (using sndisplay_fn for
+//   structs) and emit it with a single fwrite, so a call's output is never interleaved with
+//   another thread's. Structs without sndisplay_fn fall back to writing piece by piece under the
+//   lock of the stream
+// - Calls printing to stdout run under the lock of stdout because display_fn writes to stdout
+//   itself
+// Both locks are the stream's own(flockfile), so the guarantee holds between the two families and
+// across translation units
+// The typed display_put/display_fput macros make one write per value and give no such guarantee
+
+/// Initial size of the per-thread render buffer. It grows as needed
+#define DISPLAY_BUFFER_SIZE 1024
+
+/// @brief Frees the calling thread's render buffer. Worker threads may call it before exiting
+void display_thread_buffer_free(void);
+
+/*---------------------------Threading----------------------------*/
+
 /*------------------------Print to stdout-------------------------*/
 
 /// @brief Prints formatted text to stdout
@@ -138,6 +169,107 @@ int display_snprintln(char *buf, size_t size, const char *__restrict format, ...
 
 /*-------------------------Print to string-------------------------*/
 
+/*--------------------------Typed printing--------------------------*/
+
+// The display_put/display_fput macros below take the values themselves instead of a format
+// string. Every argument is dispatched on its static type with _Generic, so a call expands to a
+// straight-line sequence of writes with no format scanning at runtime. Pointers that aren't
+// strings are treated as displayable structs (`{}` in the format API); wrap a double with
+// DISPLAY_FIXED(x, precision) to control the number of decimals. Note that character constants
+// like 'a' have type int in C and are printed as numbers, use "a" instead.
+// The macros take up to 16 values, evaluate `file` once per value and return 0 on success or
+// -1 on the first failed write.
+
+/// @brief A double printed with a fixed number of decimals
+typedef struct display_fixed_t {
+  double value;
+  int precision;
+
+} display_fixed_t;
+
+#define DISPLAY_FIXED(x, prec) ((display_fixed_t){(x), (prec)})
+
+int display_fput_char(FILE *file, char c);
+int display_fput_str(FILE *file, const char *s);
+int display_fput_int(FILE *file, long long n);
+int display_fput_uint(FILE *file, unsigned long long n);
+int display_fput_double(FILE *file, double x);
+int display_fput_ldouble(FILE *file, long double x);
+int display_fput_fixed(FILE *file, display_fixed_t x);
+/// @brief Writes a displayable struct with its fdisplay_fn
+int display_fput_object(FILE *file, const void *obj);
+/// @brief Writes a displayable struct with its display_fn (`file` is expected to be stdout)
+int display_put_object(FILE *file, const void *obj);
+
+#define DISPLAY_TYPED_PUT(file, x, object_fn)                                                      \
+  (_Generic((x),                                                                                   \
+       char: display_fput_char,                                                                    \
+       _Bool: display_fput_int,                                                                    \
+       signed char: display_fput_int,                                                              \
+       short: display_fput_int,                                                                    \
+       int: display_fput_int,                                                                      \
+       long: display_fput_int,                                                                     \
+       long long: display_fput_int,                                                                \
+       unsigned char: display_fput_uint,                                                           \
+       unsigned short: display_fput_uint,                                                          \
+       unsigned int: display_fput_uint,                                                            \
+       unsigned long: display_fput_uint,                                                           \
+       unsigned long long: display_fput_uint,                                                      \
+       float: display_fput_double,                                                                 \
+       double: display_fput_double,                                                                \
+       long double: display_fput_ldouble,                                                          \
+       char *: display_fput_str,                                                                   \
+       const char *: display_fput_str,                                                             \
+       display_fixed_t: display_fput_fixed,                                                        \
+       default: object_fn)(file, x) >= 0)
+
+#define DISPLAY_FPUT_ONE(file, x) DISPLAY_TYPED_PUT(file, x, display_fput_object)
+#define DISPLAY_PUT_ONE(file, x) DISPLAY_TYPED_PUT(file, x, display_put_object)
+
+#define DISPLAY_NARG(...)                                                                          \
+  DISPLAY_NARG_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DISPLAY_NARG_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N,     \
+                      ...)                                                                         \
+  N
+#define DISPLAY_CAT(a, b) DISPLAY_CAT_(a, b)
+#define DISPLAY_CAT_(a, b) a##b
+
+// Expands to P(f, a1) && P(f, a2) && ... so the writes are sequenced left to right
+#define DISPLAY_EACH_1(P, f, a) P(f, a)
+#define DISPLAY_EACH_2(P, f, a, ...) P(f, a) && DISPLAY_EACH_1(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_3(P, f, a, ...) P(f, a) && DISPLAY_EACH_2(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_4(P, f, a, ...) P(f, a) && DISPLAY_EACH_3(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_5(P, f, a, ...) P(f, a) && DISPLAY_EACH_4(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_6(P, f, a, ...) P(f, a) && DISPLAY_EACH_5(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_7(P, f, a, ...) P(f, a) && DISPLAY_EACH_6(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_8(P, f, a, ...) P(f, a) && DISPLAY_EACH_7(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_9(P, f, a, ...) P(f, a) && DISPLAY_EACH_8(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_10(P, f, a, ...) P(f, a) && DISPLAY_EACH_9(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_11(P, f, a, ...) P(f, a) && DISPLAY_EACH_10(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_12(P, f, a, ...) P(f, a) && DISPLAY_EACH_11(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_13(P, f, a, ...) P(f, a) && DISPLAY_EACH_12(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_14(P, f, a, ...) P(f, a) && DISPLAY_EACH_13(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_15(P, f, a, ...) P(f, a) && DISPLAY_EACH_14(P, f, __VA_ARGS__)
+#define DISPLAY_EACH_16(P, f, a, ...) P(f, a) && DISPLAY_EACH_15(P, f, __VA_ARGS__)
+#define DISPLAY_EACH(P, f, ...)                                                                    \
+  DISPLAY_CAT(DISPLAY_EACH_, DISPLAY_NARG(__VA_ARGS__))(P, f, __VA_ARGS__)
+
+/// @brief Writes the values to the specified file stream
+#define display_fput(file, ...) ((DISPLAY_EACH(DISPLAY_FPUT_ONE, file, __VA_ARGS__)) ? 0 : -1)
+
+/// @brief Writes the values to the specified file stream, followed by a newline
+#define display_fputln(file, ...)                                                                  \
+  ((DISPLAY_EACH(DISPLAY_FPUT_ONE, file, __VA_ARGS__)) && putc('\n', file) != EOF ? 0 : -1)
+
+/// @brief Prints the values to stdout
+#define display_put(...) ((DISPLAY_EACH(DISPLAY_PUT_ONE, stdout, __VA_ARGS__)) ? 0 : -1)
+
+/// @brief Prints the values to stdout, followed by a newline
+#define display_putln(...)                                                                         \
+  ((DISPLAY_EACH(DISPLAY_PUT_ONE, stdout, __VA_ARGS__)) && putchar('\n') != EOF ? 0 : -1)
+
+/*--------------------------Typed printing--------------------------*/
+
 #endif // DISPLAY_H
 #ifdef DISPLAY_IMPLEMENTATION
 
@@ -377,7 +509,62 @@ static format_specs_array_t find_format_specifiers(const char *format) {
   return specs;
 }
 
-int display_vprint(const char *__restrict format, va_list args) {
+// Calls that write piece by piece hold the lock of the stream itself, which every stdio call on
+// it(and so the single fwrite of the buffered calls) takes too. The lock is recursive
+#if defined(_WIN32)
+static void display_lock(FILE *file) { _lock_file(file); }
+static void display_unlock(FILE *file) { _unlock_file(file); }
+#elif defined(__unix__) || defined(__APPLE__)
+static void display_lock(FILE *file) { flockfile(file); }
+static void display_unlock(FILE *file) { funlockfile(file); }
+#else
+static void display_lock(FILE *file) { (void)file; }
+static void display_unlock(FILE *file) { (void)file; }
+#endif
+
+#if !defined(__STDC_NO_THREADS__) && !defined(_WIN32)
+#define DISPLAY_THREAD_LOCAL _Thread_local
+#else
+#define DISPLAY_THREAD_LOCAL
+#endif
+
+typedef struct display_buffer_t {
+  char *data;
+  size_t cap;
+
+} display_buffer_t;
+
+static DISPLAY_THREAD_LOCAL display_buffer_t display_thread_buffer;
+
+static int display_vsnprint_impl(char *buf, size_t size, const char *__restrict format,
+                                  va_list args, int *elements, int *unrenderable);
+
+static int display_buffer_reserve(display_buffer_t *b, size_t size) {
+  if (size <= b->cap)
+    return 0;
+
+  size_t cap = b->cap ? b->cap : DISPLAY_BUFFER_SIZE;
+  while (cap < size)
+    cap *= 2;
+
+  char *data = (char *)realloc(b->data, cap);
+  if (!data)
+    return -1;
+
+  b->data = data;
+  b->cap = cap;
+
+  return 0;
+}
+
+void display_thread_buffer_free(void) {
+  free(display_thread_buffer.data);
+  display_thread_buffer = (display_buffer_t){NULL, 0};
+}
+
+// display_fn writes to stdout itself, so stdout output can't be rendered into a buffer. The
+// whole call is made under the lock of stdout instead
+static int display_vprint_stream(const char *__restrict format, va_list args) {
   if (!format)
     return -1;
 
@@ -524,10 +711,20 @@ int display_vprint(const char *__restrict format, va_list args) {
   return spec_count + struct_count;
 }
 
+int display_vprint(const char *__restrict format, va_list args) {
+  display_lock(stdout);
+  int result = display_vprint_stream(format, args);
+  display_unlock(stdout);
+
+  return result;
+}
+
 int display_vprintln(const char *__restrict format, va_list args) {
-  int result = display_vprint(format, args);
+  display_lock(stdout);
+  int result = display_vprint_stream(format, args);
   if (result != -1)
     putchar('\n');
+  display_unlock(stdout);
 
   return result;
 }
@@ -550,7 +747,9 @@ int display_println(const char *__restrict format, ...) {
   return result;
 }
 
-int display_vfprint(FILE *file, const char *__restrict format, va_list args) {
+// Writes piece by piece straight into `file`. Used when a struct can only be written with
+// fdisplay_fn
+static int display_vfprint_stream(FILE *file, const char *__restrict format, va_list args) {
   if (!format || !file)
     return -1;
 
@@ -697,12 +896,57 @@ int display_vfprint(FILE *file, const char *__restrict format, va_list args) {
   return spec_count + struct_count;
 }
 
-int display_vfprintln(FILE *file, const char *__restrict format, va_list args) {
-  int result = display_vfprint(file, format, args);
-  if (result != -1)
-    putc('\n', file);
+// Renders the whole call into the thread's buffer and emits it with a single fwrite, which
+// holds the stream lock, so lines from concurrent threads never interleave
+static int display_vfprint_buffered(FILE *file, const char *__restrict format, va_list args,
+                                    int newline) {
+  if (!format || !file)
+    return -1;
 
-  return result;
+  display_buffer_t *b = &display_thread_buffer;
+  if (!b->data && display_buffer_reserve(b, DISPLAY_BUFFER_SIZE) != 0)
+    return -1;
+
+  int elements = 0, unrenderable = 0;
+  va_list copy;
+  va_copy(copy, args);
+  int len = display_vsnprint_impl(b->data, b->cap, format, copy, &elements, &unrenderable);
+  va_end(copy);
+
+  if (len >= 0 && !unrenderable && (size_t)len + 2 > b->cap) {
+    // Didn't fit, grow and render again
+    if (display_buffer_reserve(b, (size_t)len + 2) != 0)
+      return -1;
+    len = display_vsnprint_impl(b->data, b->cap, format, args, &elements, &unrenderable);
+  }
+
+  if (len < 0)
+    return -1;
+
+  if (unrenderable) {
+    display_lock(file);
+    int result = display_vfprint_stream(file, format, args);
+    if (newline && result != -1)
+      putc('\n', file);
+    display_unlock(file);
+    return result;
+  }
+
+  if (newline)
+    b->data[len++] = '\n';
+
+  if (fwrite(b->data, 1, (size_t)len, file) != (size_t)len)
+    return -1;
+
+  return elements;
+}
+
+int display_vfprint(FILE *file, const char *__restrict format, va_list args) {
+  return display_vfprint_buffered(file, format, args, 0);
+}
+
+int display_vfprintln(FILE *file, const char *__restrict format, va_list args) {
+  return display_vfprint_buffered(file, format, args, 1);
 }
 
 int display_fprint(FILE *file, const char *__restrict format, ...) {
@@ -723,12 +967,17 @@ int display_fprintln(FILE *file, const char *__restrict format, ...) {
   return result;
 }
 
-int display_vsnprint(char *buf, size_t size, const char *__restrict format, va_list args) {
+// Renders into `buf` like vsnprintf. `elements` receives the number of specifiers and structs
+// written, `unrenderable` is set when a struct has no sndisplay_fn
+static int display_vsnprint_impl(char *buf, size_t size, const char *__restrict format,
+                                  va_list args, int *elements, int *unrenderable) {
   if (!format)
     return -1;
   if (!buf && size > 0)
     return -1;
 
+  int spec_count = 0, struct_count = 0;
+
   format_specs_array_t specs = find_format_specifiers(format);
   const char *p = format;
   size_t spec_idx = 0;
@@ -876,6 +1125,7 @@ int display_vsnprint(char *buf, size_t size, const char *__restrict format, va_l
 
         p += strlen(specs.data[spec_idx].substr);
         spec_idx++;
+        spec_count++;
       } else {
         if (remaining_size > 1) {
           *buf_ptr++ = *p;
@@ -894,12 +1144,15 @@ int display_vsnprint(char *buf, size_t size, const char *__restrict format, va_l
     } else if (*p == '{' && *(p + 1) == '}') {
       display_t *d = va_arg(args, display_t *);
       if (!d || !d->sndisplay_fn || !d->self) { // Invalid pointer
+        if (unrenderable && d && d->self && (d->display_fn || d->fdisplay_fn))
+          *unrenderable = 1;
         p += 2;
         continue;
       }
 
       int written = d->sndisplay_fn(d->self, buf_ptr, remaining_size);
       if (written >= 0) {
+        struct_count++;
         if ((size_t)written < remaining_size) {
           buf_ptr += written;
           remaining_size -= written;
@@ -928,9 +1181,16 @@ int display_vsnprint(char *buf, size_t size, const char *__restrict format, va_l
 
   format_specs_array_t_free(&specs);
 
+  if (elements)
+    *elements = spec_count + struct_count;
+
   return total_chars;
 }
 
+int display_vsnprint(char *buf, size_t size, const char *__restrict format, va_list args) {
+  return display_vsnprint_impl(buf, size, format, args, NULL, NULL);
+}
+
 int display_vsnprintln(char *buf, size_t size, const char *__restrict format, va_list args) {
   int written = display_vsnprint(buf, size, format, args);
   if (written < 0)
@@ -962,6 +1222,64 @@ int display_snprintln(char *buf, size_t size, const char *__restrict format, ...
   return result;
 }
 
+int display_fput_char(FILE *file, char c) { return putc(c, file) == EOF ? -1 : 1; }
+
+int display_fput_str(FILE *file, const char *s) {
+  if (!s)
+    return -1;
+
+  size_t len = strlen(s);
+  return fwrite(s, 1, len, file) == len ? (int)len : -1;
+}
+
+static int display_fput_digits(FILE *file, unsigned long long n, int negative) {
+  char buf[24];
+  char *p = buf + sizeof(buf);
+  do {
+    *--p = (char)('0' + n % 10);
+    n /= 10;
+  } while (n);
+  if (negative)
+    *--p = '-';
+
+  size_t len = (size_t)(buf + sizeof(buf) - p);
+  return fwrite(p, 1, len, file) == len ? (int)len : -1;
+}
+
+int display_fput_int(FILE *file, long long n) {
+  if (n < 0)
+    return display_fput_digits(file, 0ULL - (unsigned long long)n, 1);
+
+  return display_fput_digits(file, (unsigned long long)n, 0);
+}
+
+int display_fput_uint(FILE *file, unsigned long long n) { return display_fput_digits(file, n, 0); }
+
+int display_fput_double(FILE *file, double x) { return fprintf(file, "%f", x); }
+
+int display_fput_ldouble(FILE *file, long double x) { return fprintf(file, "%Lf", x); }
+
+int display_fput_fixed(FILE *file, display_fixed_t x) {
+  return fprintf(file, "%.*f", x.precision, x.value);
+}
+
+int display_fput_object(FILE *file, const void *obj) {
+  const display_t *d = (const display_t *)obj;
+  if (!d || !d->fdisplay_fn || !d->self)
+    return -1;
+
+  return d->fdisplay_fn(d->self, file);
+}
+
+int display_put_object(FILE *file, const void *obj) {
+  (void)file;
+  const display_t *d = (const display_t *)obj;
+  if (!d || !d->display_fn || !d->self)
+    return -1;
+
+  return d->display_fn(d->self);
+}
+
 #ifdef DISPLAY_STRIP_PREFIX
 #define print display_print
 #define println display_println
@@ -975,6 +1293,10 @@ int display_snprintln(char *buf, size_t size, const char *__restrict format, ...
 #define snprintln display_snprintln
 #define vsnprint display_vsnprint
 #define vsnprintln display_vsnprintln
+#define put display_put
+#define putln display_putln
+#define fput display_fput
+#define fputln display_fputln
 #endif // DISPLAY_STRIP_PREFIX
 
 #endif // DISPLAY_IMPLEMENTATION
@@ -10,11 +10,26 @@
 #endif
 
 #include "rocketlib/PID.h"
+#include "rocketlib/aggregate.h"
+#ifdef __linux__
+#include "rocketlib/async_writer.h"
+#endif
+#include "rocketlib/bench.h"
+#include "rocketlib/checkpoint.h"
+#include "rocketlib/config_watch.h"
 #include "rocketlib/events.h"
 #include "rocketlib/fparser.h"
+#include "rocketlib/gp.h"
 #include "rocketlib/logger.h"
+#include "rocketlib/logreader.h"
+#include "rocketlib/pool.h"
+#include "rocketlib/procs.h"
+#include "rocketlib/reduce.h"
 #include "rocketlib/rocket.h"
+#include "rocketlib/shard_logger.h"
 #include "rocketlib/simulator.h"
+#include "rocketlib/topology.h"
+#include "rocketlib/trajectory.h"
 #include "rocketlib/utils.h"
 
 #include <math.h>
@@ -10,6 +10,10 @@
  */
 
 #include "../display.h"
+#include "logger.h"
+
+/// Number of columns in pid_log_columns
+#define PID_LOG_COLUMNS 7
 
 /**
  * @struct PID
@@ -22,10 +26,17 @@ typedef struct PID {
   double K_p, K_i, K_d;
   double integral, prev_err;
 
+  // Telemetry of the last update
+  double time, err;
+  double output; // Commanded thrust(fraction of the maximum)
+
 } PID;
 
 int display_pid(const void *self);
 int fdisplay_pid(const void *self, FILE *file);
 int sndisplay_pid(const void *self, char *buff, size_t size);
 
+/// Per-tick telemetry fields of PID. Keys: time, err, P, I, D, integral, output
+extern const log_column_t pid_log_columns[PID_LOG_COLUMNS];
+
 #endif // PID_H
\ No newline at end of file
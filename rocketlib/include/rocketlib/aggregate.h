@@ -0,0 +1,117 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+/*
+ * @file aggregate.h
+ * @brief Online statistics of a run in constant memory
+ *
+ * The building blocks see every value once and keep a few numbers:
+ * - welford_t: count, mean and variance(Welford's update, no cancellation)
+ * - extremes_t: minimum and maximum with the times they were reached
+ * - p2_t: estimate of one quantile with five markers(the P² algorithm of Jain and Chlamtac),
+ *   exact up to five values
+ *
+ * An aggregate_t applies the statistics chosen by AGGREGATE_* flags to one quantity read from
+ * the simulated object by a function. An aggregate_set_t holds the aggregates of a run, is
+ * sampled once per step and writes one CSV summary record per run, so a campaign needs no log
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct welford_t {
+  uint64_t count;
+  double mean, m2; // m2: sum of squared deviations from the mean
+
+} welford_t;
+
+void welford_add(welford_t *w, double x);
+/// @return Sample variance or 0 if there are less than two values
+double welford_variance(const welford_t *w);
+
+typedef struct extremes_t {
+  uint64_t count;
+  double min, max;
+  double min_time, max_time; // First time each was reached
+
+} extremes_t;
+
+void extremes_add(extremes_t *e, double time, double x);
+
+typedef struct p2_t {
+  double p;
+  int count;
+  double q[5];    // Marker heights, the first values while count < 5
+  double n[5];    // Marker positions
+  double want[5]; // Desired positions
+  double dn[5];   // Increments of the desired positions
+
+} p2_t;
+
+/// @param p Quantile in (0, 1), e.g. 0.5 for the median
+p2_t p2_init(double p);
+void p2_add(p2_t *q, double x);
+/// @return The estimate or NAN if there are no values
+double p2_value(const p2_t *q);
+
+// Statistics of an aggregate_t and their summary columns
+#define AGGREGATE_MEAN 1     // <name>_mean, <name>_std
+#define AGGREGATE_EXTREMES 2 // <name>_min, <name>_min_time, <name>_max, <name>_max_time
+#define AGGREGATE_ENDS 4     // <name>_first, <name>_last
+
+#define AGGREGATE_MAX_QUANTILES 4 // <name>_p<100 * p> each
+#define AGGREGATE_MAX 16          // Aggregates in a set
+
+/// Reads the aggregated quantity from the simulated object
+typedef double (*aggregate_fn)(const void *obj);
+
+/**
+ * @struct aggregate_t
+ * @brief Statistics of one quantity
+ *
+ */
+typedef struct aggregate_t {
+  const char *name;
+  aggregate_fn value;
+  unsigned flags;
+
+  welford_t w;
+  extremes_t e;
+  double first, last;
+  p2_t q[AGGREGATE_MAX_QUANTILES];
+  int quantiles;
+
+} aggregate_t;
+
+/**
+ * @struct aggregate_set_t
+ * @brief The aggregates of a run. A plain value: copy a configured set to run it again
+ *
+ */
+typedef struct aggregate_set_t {
+  aggregate_t items[AGGREGATE_MAX];
+  int count;
+  uint64_t samples;
+  double start, end; // Times of the first and the last sample
+
+} aggregate_set_t;
+
+/// @brief Adds a quantity to the set
+/// @param flags AGGREGATE_* flags
+/// @param quantiles Quantiles to estimate(at most AGGREGATE_MAX_QUANTILES) or NULL
+/// @return 0 on success or -1 if the set is full or the arguments are invalid
+int aggregate_set_add(aggregate_set_t *s, const char *name, aggregate_fn value, unsigned flags,
+                      const double *quantiles, int quantile_count);
+/// @brief Clears the statistics for a new run, the quantities stay
+void aggregate_set_reset(aggregate_set_t *s);
+/// @brief Feeds the state of `obj` at `time` to every aggregate. Non-finite values are skipped
+void aggregate_set_sample(aggregate_set_t *s, double time, const void *obj);
+
+/// @brief Writes the comma separated column names of the summary, without a newline: duration,
+/// samples, then the columns of every aggregate
+int aggregate_set_write_header(const aggregate_set_t *s, FILE *file);
+/// @brief Writes the summary record matching aggregate_set_write_header, without a newline
+int aggregate_set_write(const aggregate_set_t *s, FILE *file);
+
+#endif // AGGREGATE_H
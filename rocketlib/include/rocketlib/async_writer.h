@@ -0,0 +1,69 @@
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+/*
+ * @file async_writer.h
+ * @brief Asynchronous append-only file writer (Linux)
+ *
+ * Data is copied into one of two large page-aligned buffers. When a buffer is full it is handed
+ * to the kernel with io_uring and filling continues in the other one, so the caller only blocks
+ * when both buffers are still in flight (a stall). If io_uring is unavailable a writer thread
+ * doing pwrite is used instead
+ *
+ * async_writer_fopen wraps the writer into a FILE, so everything built on stdio (logger_t,
+ * fprintln, ...) can use it unchanged
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// Default size of each of the two buffers: 4 MB
+#define ASYNC_WRITER_BUFFER_SIZE (4 * 1024 * 1024)
+
+typedef enum async_writer_backend_t {
+  ASYNC_WRITER_IO_URING,
+  ASYNC_WRITER_THREAD,
+
+} async_writer_backend_t;
+
+/// Don't try io_uring, always use the writer thread
+#define ASYNC_WRITER_FORCE_THREAD 1
+
+/**
+ * @struct async_writer_stats_t
+ * @brief Counters of an async_writer_t
+ *
+ */
+typedef struct async_writer_stats_t {
+  async_writer_backend_t backend;
+  uint64_t writes_submitted, writes_completed;
+  uint64_t bytes_submitted, bytes_completed;
+  uint64_t stalls;      // Number of times the caller waited for a buffer
+  double stall_seconds; // Total time spent waiting
+
+} async_writer_stats_t;
+
+typedef struct async_writer_t async_writer_t;
+
+/// @brief Creates (or truncates) `filename` for writing
+/// @param buffer_size Size of each buffer, ASYNC_WRITER_BUFFER_SIZE if 0
+/// @param flags 0 or ASYNC_WRITER_FORCE_THREAD
+/// @return The writer or NULL on failure
+async_writer_t *async_writer_open(const char *filename, size_t buffer_size, int flags);
+/// @brief Waits for all pending writes and frees the writer
+int async_writer_close(async_writer_t *w);
+
+/// @brief Appends `size` bytes
+int async_writer_write(async_writer_t *w, const void *data, size_t size);
+/// @brief Writes `size` bytes at `offset` synchronously, after all pending data
+int async_writer_write_at(async_writer_t *w, const void *data, size_t size, uint64_t offset);
+/// @brief Submits the partially filled buffer and waits for all pending writes
+int async_writer_flush(async_writer_t *w);
+
+async_writer_stats_t async_writer_stats(async_writer_t *w);
+
+/// @brief Wraps the writer into a FILE. Closing the FILE flushes but doesn't free the writer
+FILE *async_writer_fopen(async_writer_t *w);
+
+#endif // ASYNC_WRITER_H
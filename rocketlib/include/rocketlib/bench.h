@@ -0,0 +1,93 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * @file bench.h
+ * @brief Repeated timing measurements with a JSON baseline and regression checks
+ *
+ * Every benchmark is run several times, and its result is the median of the samples together
+ * with the median absolute deviation (MAD) as a measure of noise. The results can be written
+ * to a JSON baseline file:
+ *
+ * {
+ *   "benchmarks": [
+ *     {"name": "rk4/dt=1.25e-02", "median": 1.9e-04, "mad": 2.1e-06, "repeats": 5}
+ *   ]
+ * }
+ *
+ * A later run can be compared against the baseline. A benchmark counts as a regression when its
+ * median is slower than the baseline by more than the threshold (relative) AND by more than
+ * BENCH_NOISE_SIGMAS standard deviations estimated from the MAD of both runs
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define BENCH_NAME_SIZE 64
+#define BENCH_DEFAULT_REPEATS 5
+/// Default regression threshold, relative to the baseline median
+#define BENCH_DEFAULT_THRESHOLD 0.05
+/// MAD to standard deviation of a normal distribution
+#define BENCH_MAD_TO_SIGMA 1.4826
+#define BENCH_NOISE_SIGMAS 3.0
+
+/**
+ * @struct bench_result_t
+ * @brief Summary of the samples of one benchmark
+ *
+ */
+typedef struct bench_result_t {
+  char name[BENCH_NAME_SIZE];
+  double median, mad; // Seconds
+  int repeats;
+
+} bench_result_t;
+
+/**
+ * @struct bench_t
+ * @brief Collects benchmark results and the baseline options of a benchmark executable
+ *
+ */
+typedef struct bench_t {
+  bench_result_t *results;
+  size_t count, capacity;
+
+  int repeats;
+  double threshold;
+  const char *baseline; // Write the results to this file(--baseline)
+  const char *compare;  // Compare the results with this file(--compare)
+
+} bench_t;
+
+bench_t bench_init();
+void bench_free(bench_t *b);
+
+/// @brief Wall clock time in seconds
+double bench_now();
+
+/// @brief Handles the common flags: --repeats <n>, --baseline <file>, --compare <file> and
+/// --threshold <percent>
+/// @param i Index of the current argument, moved past the value of the flag
+/// @return 1 if the flag was handled, 0 if it's not a bench flag, -1 on invalid value
+int bench_parse_flag(bench_t *b, int argc, char *argv[], int *i);
+
+/// @brief Adds a result computed from `count` samples(seconds). `samples` gets sorted
+/// @return Added result or NULL on failure
+const bench_result_t *bench_add(bench_t *b, const char *name, double *samples, int count);
+/// @return Result with `name` or NULL
+const bench_result_t *bench_find(const bench_t *b, const char *name);
+
+int bench_write_json(const bench_t *b, const char *filename);
+/// @brief Appends the results stored in a JSON file written by bench_write_json
+int bench_read_json(bench_t *b, const char *filename);
+
+/// @brief Prints the per-benchmark deltas of `current` against `baseline` into `out`
+/// @return Number of regressions or -1 on failure
+int bench_compare(const bench_t *current, const bench_t *baseline, double threshold, FILE *out);
+
+/// @brief Writes the baseline and runs the comparison requested by the flags. The report goes to
+/// stderr, so stdout stays a clean table
+/// @return Exit status: 0, 1 if there are regressions or -1 on failure
+int bench_finish(bench_t *b);
+
+#endif // BENCH_H
@@ -0,0 +1,43 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/*
+ * @file checkpoint.h
+ * @brief Crash-safe state files in the fparser format
+ *
+ * A checkpoint is written to `<file>.tmp`, flushed to the disk and renamed over `<file>`. The
+ * rename is atomic, so after a crash the file holds either the previous or the new state and
+ * never a partial one. Values are written as hexadecimal floats(whole numbers in decimal),
+ * which fparser reads back exactly(bind them with fparser_bind):
+ * [twiddle]
+ * best_err = 0x1.cbf3aca24cc64p+6
+ * evaluations = 395
+ */
+
+#include "fparser.h"
+
+#include <stdio.h>
+
+/**
+ * @struct checkpoint_t
+ * @brief A checkpoint being written
+ *
+ */
+typedef struct checkpoint_t {
+  FILE *file; // The temporary file, NULL on failure
+  char filename[MAX_LINE], tmp[MAX_LINE + 4];
+
+} checkpoint_t;
+
+/// @brief Starts a new state of `filename`
+/// @return The checkpoint, its file is NULL on failure
+checkpoint_t checkpoint_begin(const char *filename);
+void checkpoint_section(checkpoint_t *c, const char *name);
+void checkpoint_value(checkpoint_t *c, const char *key, double value);
+
+/// @brief Flushes the state to the disk and replaces the previous one. The temporary file is
+/// removed on failure and the previous state is kept
+/// @return 0 on success or -1 on failure
+int checkpoint_commit(checkpoint_t *c);
+
+#endif // CHECKPOINT_H
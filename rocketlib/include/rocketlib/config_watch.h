@@ -0,0 +1,36 @@
+#ifndef CONFIG_WATCH_H
+#define CONFIG_WATCH_H
+
+/*
+ * @file config_watch.h
+ * @brief Hot reload of a config file (Linux)
+ *
+ * A background thread watches the config file with inotify. When the file is written (or
+ * replaced by rename, as most editors do) it is re-parsed with fparser_reload into a fresh
+ * snapshot, which is published with an atomic exchange. The simulation picks it up between two
+ * steps with config_watch_take, which costs a single atomic operation when nothing changed, so
+ * the running simulation never sees a half-parsed file
+ *
+ * On other systems config_watch_open always returns NULL
+ */
+
+#include "fparser.h"
+
+#include <stdint.h>
+
+typedef struct config_watch_t config_watch_t;
+
+/// @brief Starts watching `filename`. The string must outlive the watcher
+/// @return The watcher or NULL on failure(no inotify, no such directory)
+config_watch_t *config_watch_open(const char *filename);
+/// @brief Stops the thread and frees the watcher with any snapshot not taken yet
+int config_watch_close(config_watch_t *w);
+
+/// @brief Takes the newest snapshot parsed since the last call
+/// @return The snapshot(free it with free) or NULL if the file didn't change
+fparser_t *config_watch_take(config_watch_t *w);
+
+/// @return Number of successful re-parses so far
+uint64_t config_watch_reloads(config_watch_t *w);
+
+#endif // CONFIG_WATCH_H
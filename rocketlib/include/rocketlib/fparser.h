@@ -4,6 +4,8 @@
 #include "utils.h"
 
 #include "stdio.h"
+#include <stdbool.h>
+#include <stddef.h>
 
 /*
  * @file fparser.h
@@ -17,8 +19,25 @@
  * [struct2]
  * var3 = 5.1
  * ...
+ *
+ * Parsed values can be bound to the fields of a C struct with a table of fparser_binding_t,
+ * see fparser_bind
+ *
+ * A file can also be a deck of scenarios. The ordinary sections form the base scenario and every
+ * [scenario.<name> : <parent>] section derives a scenario from its parent(`base` or another
+ * scenario) by overriding some values:
+ * [scenario.heavy : base]
+ * rocket.fuel_mass = 6000
+ *
+ * [scenario.heavy_weak : heavy]
+ * engine.thrust = 150000
  */
 
+/// Prefix of the sections describing scenarios of a deck
+#define FPARSER_SCENARIO_PREFIX "scenario."
+/// Name of the scenario formed by the ordinary sections
+#define FPARSER_BASE_SCENARIO "base"
+
 #define MAX_LINE 256
 #define MAX_NAME 64
 
@@ -48,6 +67,29 @@ typedef struct fparser_section_t {
 
 } fparser_section_t;
 
+typedef enum fparser_type_t {
+  FPARSER_DOUBLE,
+  FPARSER_FLOAT,
+  FPARSER_INT,
+  FPARSER_BOOL, // Any non-zero value is true
+
+} fparser_type_t;
+
+/**
+ * @struct fparser_binding_t
+ * @brief Binds `section.key` of the file to a field of a struct
+ *
+ */
+typedef struct fparser_binding_t {
+  const char *section;
+  const char *key;
+  size_t offset; // offsetof the field
+  fparser_type_t type;
+  double default_value; // Used if the key is missing
+  bool required;        // Missing key is an error
+
+} fparser_binding_t;
+
 /**
  * @struct fparser_t
  * @brief Represents the parser state, including all sections read from a file
@@ -61,10 +103,60 @@ typedef struct fparser_t {
 
 } fparser_t;
 
+/**
+ * @struct fparser_scenario_t
+ * @brief A scenario of a deck: its parent and the section with its overrides
+ *
+ */
+typedef struct fparser_scenario_t {
+  char name[MAX_NAME];
+  int parent;                          // Index of the parent scenario, -1 for the base
+  const fparser_section_t *overrides; // NULL for the base
+
+} fparser_scenario_t;
+
+/**
+ * @struct fparser_deck_t
+ * @brief Scenarios found in a parsed file. Scenarios aren't copied, the values of one are
+ * materialized on demand from the base sections and the overrides of its ancestors
+ *
+ */
+typedef struct fparser_deck_t {
+  const fparser_t *fp;
+  fparser_scenario_t scenarios[MAX_SECTIONS + 1]; // scenarios[0] is the base
+  int scenario_count;
+
+} fparser_deck_t;
+
 fparser_t fparser_init(const char *filename);
 int fparser_free(fparser_t *fp);
 
 int fparser_parse(fparser_t *fp);
+/// @brief Opens `fp->filename` again and parses it from the start. The file is closed after
+/// parsing, like after fparser_free
+int fparser_reload(fparser_t *fp);
+
+/// @brief Fills the fields of `obj` described by `table` in one pass over the parsed values.
+/// Missing keys get their default value. Missing required keys and keys of the bound sections
+/// which are not in `table` are reported to `report`(if not NULL)
+/// @return Number of missing required keys or -1 on failure
+int fparser_bind(fparser_t *fp, const fparser_binding_t *table, size_t count, void *obj,
+                 FILE *report);
+
+/// @brief Collects the scenarios of a parsed file. Problems(duplicate name, unknown parent,
+/// cycle) are reported to `report`(if not NULL)
+/// @return The deck or an empty deck(scenario_count == 0) on failure
+fparser_deck_t fparser_deck_init(const fparser_t *fp, FILE *report);
+/// @brief fparser_bind for one scenario of a deck: the base sections are bound first, then the
+/// overrides are applied from the oldest ancestor to the scenario itself. A required key is
+/// missing only if neither the base nor the chain sets it. Unknown keys of the base sections are
+/// only reported for scenario 0
+/// @return Number of missing required keys and unknown overrides or -1 on failure
+int fparser_deck_bind(const fparser_deck_t *deck, int scenario, const fparser_binding_t *table,
+                      size_t count, void *obj, FILE *report);
+/// @brief Looks up `section.key` in a scenario, falling back to its ancestors and the base
+fparser_var_t fparser_deck_get_var(const fparser_deck_t *deck, int scenario,
+                                   const char *section_name, const char *var_name);
 
 fparser_section_t fparser_get_section(fparser_t *fp, const char *section_name);
 fparser_var_t fparser_get_var(fparser_t *fp, const char *section_name, const char *var_name);
@@ -0,0 +1,61 @@
+#ifndef GP_H
+#define GP_H
+
+/*
+ * @file gp.h
+ * @brief Gaussian-process regression for surrogate models
+ *
+ * A gp_t predicts one output of an expensive function from `dim` inputs, with the standard
+ * deviation of the prediction. The kernel is a squared exponential with one length scale per
+ * input (inputs are expected to be scaled to about [0, 1]) plus a noise term. Outputs are
+ * standardized internally. gp_fit picks the length scales and the noise by coordinate search
+ * over a grid, maximizing the log marginal likelihood
+ *
+ * Models are saved as text with hexadecimal floats, so a loaded model predicts the same bits:
+ *
+ * gp <dim> <count>
+ * <mean> <scale> <noise>
+ * <length of every input>
+ * <inputs and weight of every training point>
+ * <Cholesky factor, lower triangle by rows>
+ */
+
+#include <stdio.h>
+
+// Upper limit of the inputs of a model
+#define GP_MAX_DIM 16
+
+/**
+ * @struct gp_t
+ * @brief A fitted model
+ *
+ */
+typedef struct gp_t {
+  int dim, count;
+  double length[GP_MAX_DIM];
+  double noise;       // Variance of the noise, relative to the signal
+  double mean, scale; // Of the training outputs
+
+  double *x;     // count x dim training inputs
+  double *alpha; // K^-1 (y - mean) / scale
+  double *chol;  // Lower Cholesky factor of K, count x count
+
+} gp_t;
+
+/// @brief Fits a model to `count` points
+/// @param x count x dim inputs(row-major)
+/// @param y Outputs
+/// @return 0 on success or -1 on failure
+int gp_fit(gp_t *gp, const double *x, const double *y, int count, int dim);
+void gp_free(gp_t *gp);
+
+/// @brief Predicts the output at `x`
+/// @param sigma Standard deviation of the prediction or NULL
+/// @return The predicted mean
+double gp_predict(const gp_t *gp, const double *x, double *sigma);
+
+int gp_write(const gp_t *gp, FILE *file);
+/// @return 0 on success or -1 on failure(malformed model)
+int gp_read(gp_t *gp, FILE *file);
+
+#endif // GP_H
@@ -8,8 +8,37 @@
  * This file provides functionality for logging data to a file with an
  * in-memory buffer to reduce the number of direct file I/O operations
  * The logger is designed to be flushed periodically or when the buffer is full
+ *
+ * Two output formats are supported:
+ * - LOGGER_FORMAT_CSV: text, one comma separated row per record
+ * - LOGGER_FORMAT_BINARY: a small fixed header followed by a plain C-contiguous
+ *   (row-major) array of doubles, so the data can be mapped directly into memory
+ *   (see logreader.h and numpy.memmap)
+ *
+ * Binary layout (native byte order, little-endian on all supported targets):
+ *
+ * offset  size  field
+ * 0       8     magic "RLOGBIN\0"
+ * 8       4     uint32 version (LOGGER_BINARY_VERSION)
+ * 12      4     uint32 number of columns
+ * 16      8     uint64 number of rows (0 until the logger is freed)
+ * 24      8     uint64 offset of the data section (multiple of 64)
+ * 32      ...   column names, comma separated, NUL-terminated
+ * data    ...   rows * columns float64 values, row-major
+ *
+ * Both formats start with a header naming the logged columns. Which fields are logged is
+ * described by a table of log_column_t (offset and type of every field) and can be narrowed
+ * down with logger_select_columns
  */
 
+#ifdef __linux__
+#include "async_writer.h"
+#else
+typedef struct async_writer_t async_writer_t;
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 typedef struct rocket_t rocket_t;
@@ -18,6 +47,54 @@ typedef struct PID PID;
 // Default buffer: 64 KB
 #define LOGGER_BUFFER_SIZE (64 * 1024)
 
+#define LOGGER_BINARY_MAGIC "RLOGBIN"
+#define LOGGER_BINARY_VERSION 1
+/// Alignment of the data section of binary logs
+#define LOGGER_BINARY_ALIGN 64
+
+/// Maximum number of columns a logger can write
+#define LOGGER_MAX_COLUMNS 32
+
+typedef enum log_column_type_t {
+  LOG_COLUMN_DOUBLE,
+  LOG_COLUMN_FLOAT,
+
+} log_column_type_t;
+
+/**
+ * @struct log_column_t
+ * @brief Describes where a logged value lives in a struct
+ *
+ */
+typedef struct log_column_t {
+  const char *key;    // Name used to select the column
+  const char *header; // Name written to the log header
+  size_t offset;      // offsetof the field
+  log_column_type_t type;
+  double scale; // The value is multiplied by it before writing
+
+} log_column_t;
+
+typedef enum logger_format_t {
+  LOGGER_FORMAT_CSV,
+  LOGGER_FORMAT_BINARY,
+
+} logger_format_t;
+
+/**
+ * @struct logger_binary_header_t
+ * @brief Fixed part of the binary log header
+ *
+ */
+typedef struct logger_binary_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t column_count;
+  uint64_t row_count;
+  uint64_t data_offset;
+
+} logger_binary_header_t;
+
 /**
  * @struct logger_t
  * @brief Represents a file logger with an internal buffer
@@ -26,15 +103,48 @@ typedef struct PID PID;
 typedef struct logger_t {
   FILE *file;
   const char *filename;
+  logger_format_t format;
+  uint32_t columns; // 0 until the header is written
+  uint64_t rows;    // Binary only: rows written so far
+
+  log_column_t selection[LOGGER_MAX_COLUMNS]; // Columns written by logger_write_selected
+  uint32_t selected;
+
+  async_writer_t *writer; // Set if the logger writes through an async_writer_t, NULL off Linux
 
 } logger_t;
 
 logger_t logger_init(const char *filename);
+logger_t logger_init_format(const char *filename, logger_format_t format);
+#ifdef __linux__
+/// @brief Creates a logger writing through an async_writer_t (io_uring or a writer thread), so
+/// the simulation doesn't block on file writes
+/// @param flags Flags for async_writer_open
+logger_t logger_init_async(const char *filename, logger_format_t format, int flags);
+#endif
+/// @brief Patches the row count of a binary log into its header and closes the file
+/// @return 0 on success or -1 if the header can't be patched or the file can't be closed
 int logger_free(logger_t *l);
 /// @brief Flushes the write buffer to the file.
 int logger_flush(logger_t *l);
 
+/// @brief Writes the binary header. Called automatically by the first logger_write_* call
+/// @param columns Comma separated column names
+int logger_write_binary_header(logger_t *l, const char *columns);
+/// @brief Appends one row of doubles to a binary log
+int logger_write_binary_row(logger_t *l, const double *row);
+
+/// @brief Precompiles the columns to write from `table`. Must be called before the first write
+/// @param keys Comma separated column keys, all columns of `table` if NULL or empty
+/// @return 0 on success or -1 on unknown key or too many columns
+int logger_select_columns(logger_t *l, const log_column_t *table, size_t count, const char *keys);
+/// @brief Writes the selected columns of `obj`, the header is written on the first call
+int logger_write_selected(logger_t *l, const void *obj);
+
+/// @brief Writes the selected columns of rocket_log_columns (all of them by default)
 int logger_write_rocket(logger_t *l, rocket_t *r);
+/// @brief Writes the selected columns of pid_log_columns (all of them by default), one record
+/// of controller telemetry from the last update
 int logger_write_pid(logger_t *l, PID *pid);
 
-#endif // LOGGER_H
\ No newline at end of file
+#endif // LOGGER_H
@@ -0,0 +1,66 @@
+#ifndef LOGREADER_H
+#define LOGREADER_H
+
+/*
+ * @file logreader.h
+ * @brief Zero-copy reader for binary logs
+ *
+ * The whole file is mapped into memory with mmap, values are accessed through
+ * pointers into the mapping. See logger.h for the file layout
+ *
+ * log_reader_downsample picks the rows worth drawing when a column is plotted, so plots and
+ * previews of a log at full rate handle a fixed number of points:
+ * - LTTB(Largest-Triangle-Three-Buckets) splits the rows into equal buckets and keeps the row
+ *   of every bucket which spans the largest triangle with the row kept before it and the mean
+ *   of the next bucket. It follows the shape of the curve with one point per bucket
+ * - Min/max keeps the lowest and the highest row of every bucket, so no peak is lost
+ */
+
+#include "logger.h"
+
+#include <stddef.h>
+
+/**
+ * @struct log_reader_t
+ * @brief Represents a binary log mapped into memory
+ *
+ */
+typedef struct log_reader_t {
+  const logger_binary_header_t *header;
+  const char *column_names; // Comma separated, NUL-terminated
+  const double *data;       // rows * cols values, row-major
+  size_t rows, cols;
+
+  void *map;
+  size_t map_size;
+
+} log_reader_t;
+
+/// @brief Value of column `col` in row `row`
+#define LOG_READER_AT(lr, row, col) ((lr).data[(size_t)(row) * (lr).cols + (col)])
+
+log_reader_t log_reader_open(const char *filename);
+int log_reader_close(log_reader_t *lr);
+
+/// @return Index of the column named `name` or -1 if there is none
+int log_reader_column_index(const log_reader_t *lr, const char *name);
+
+/// @return Pointer to the first value of row `row` or NULL if out of range
+const double *log_reader_row(const log_reader_t *lr, size_t row);
+
+typedef enum log_downsample_t {
+  LOG_DOWNSAMPLE_LTTB,
+  LOG_DOWNSAMPLE_MINMAX,
+
+} log_downsample_t;
+
+/// @brief Picks at most `target` rows which draw column `y` against column `x` like all rows.
+/// The first and last rows are always kept. The rows are read bucket by bucket, min/max reads
+/// every row once and LTTB twice(for the mean of its bucket, then for the triangles)
+/// @param target At least 3, every row is kept if the log has no more rows than that
+/// @param rows Indices of the picked rows in increasing order, room for `target` values
+/// @return Number of picked rows or -1 on failure
+long log_reader_downsample(const log_reader_t *lr, int x, int y, size_t target,
+                           log_downsample_t method, size_t *rows);
+
+#endif // LOGREADER_H
@@ -0,0 +1,41 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * @file pool.h
+ * @brief A fixed-size pool of worker threads (C11 threads)
+ *
+ * The pool runs parallel loops: pool_for calls a function for every index of a range on all
+ * workers and returns when the whole range is done. Indices are claimed one by one from a shared
+ * atomic counter, so long and short tasks balance out and every worker sees its indices in
+ * increasing order (which is what shard_logger_t expects)
+ */
+
+#include "topology.h"
+
+#include <stddef.h>
+
+/// @param worker Index of the calling worker in [0, pool_threads)
+typedef void (*pool_fn)(void *ctx, size_t index, int worker);
+
+typedef struct pool_t pool_t;
+
+/// @brief Number of online CPUs, at least 1
+int pool_default_threads();
+
+/// @param threads Number of workers, pool_default_threads() if <= 0
+/// @return The pool or NULL on failure
+pool_t *pool_create(int threads);
+/// @brief pool_create with worker i pinned to the CPU topology_slot(t, i) of `t`. Workers pin
+/// themselves before they run anything, so what they allocate is local to their node
+pool_t *pool_create_pinned(int threads, const topology_t *t);
+/// @brief Stops and joins the workers
+int pool_free(pool_t *p);
+
+int pool_threads(const pool_t *p);
+
+/// @brief Calls fn(ctx, i, worker) for every i in [0, count) and waits until all calls return.
+/// Must not be called from a worker
+int pool_for(pool_t *p, size_t count, pool_fn fn, void *ctx);
+
+#endif // POOL_H
@@ -0,0 +1,37 @@
+#ifndef PROCS_H
+#define PROCS_H
+
+/*
+ * @file procs.h
+ * @brief Parallel loops over forked worker processes (POSIX)
+ *
+ * procs_for is pool_for with processes instead of threads: the workers are forked, claim
+ * indices one by one from an atomic counter in shared memory and exit when the range is done.
+ * Nothing is written back through pipes or files: the function stores its results in a table
+ * allocated with procs_alloc (an anonymous shared mapping), which the parent reads once the
+ * workers are gone. A worker which crashes only loses the index it was working on
+ *
+ * On other systems procs_alloc returns NULL and procs_for fails without calling fn
+ */
+
+#include "pool.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// @brief Allocates zeroed memory shared with the workers forked later by procs_for
+/// @return The memory or NULL on failure
+void *procs_alloc(size_t size);
+void procs_free(void *ptr);
+
+/// @brief Calls fn(ctx, i, worker) for every i in [0, count) in `processes` forked workers and
+/// waits until they exit. Every worker sees its indices in increasing order. Only writes to
+/// procs_alloc memory(and to files) are seen by the caller
+/// @param processes Number of workers, pool_default_threads() if <= 0
+/// @param t Worker i is pinned to the CPU topology_slot(t, i), NULL to leave them unpinned
+/// @param completed Set for every index whose call returned(the worker didn't die) or NULL
+/// @return 0 if all calls returned or -1 otherwise
+int procs_for(int processes, size_t count, pool_fn fn, void *ctx, const topology_t *t,
+              bool *completed);
+
+#endif // PROCS_H
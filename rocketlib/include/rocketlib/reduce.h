@@ -0,0 +1,38 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+/*
+ * @file reduce.h
+ * @brief Bit-reproducible sums, means and variances
+ *
+ * Values are summed pairwise along a tree which depends only on their count: runs of
+ * REDUCE_LEAF values are added in a plain loop, and a range is split after the largest
+ * REDUCE_LEAF * 2^k values shorter than the range. The parallel versions sum REDUCE_CHUNK values
+ * per task, which are whole subtrees, and add the partial sums along the same tree. So the
+ * result is the same bits for any number of threads and any scheduling, as long as the values
+ * are stored in a fixed order(e.g. by scenario index)
+ */
+
+#include "pool.h"
+
+#include <stddef.h>
+
+// Values added in a plain loop at the leaves of the tree
+#define REDUCE_LEAF 64
+// Values per task of the parallel versions, REDUCE_LEAF * 2^k
+#define REDUCE_CHUNK (REDUCE_LEAF * 256)
+
+double reduce_sum(const double *values, size_t count);
+/// @return Mean of the values or 0 if there are none
+double reduce_mean(const double *values, size_t count);
+/// @brief Sample variance(divided by count - 1) around `mean`, summed with the same tree
+/// @return The variance or 0 if there are less than two values
+double reduce_variance(const double *values, size_t count, double mean);
+
+/// @brief reduce_sum on the workers of the pool. The result is identical to reduce_sum
+/// @return The sum or NAN on failure
+double reduce_sum_pool(pool_t *p, const double *values, size_t count);
+/// @brief reduce_variance on the workers of the pool. The result is identical to reduce_variance
+double reduce_variance_pool(pool_t *p, const double *values, size_t count, double mean);
+
+#endif // REDUCE_H
@@ -11,6 +11,7 @@
  */
 
 #include "../display.h"
+#include "logger.h"
 #include "utils.h"
 
 /// Header for rocket logger file
@@ -21,11 +22,14 @@
   "CoordinateOz(m),"                                                                               \
   "thrust_percent(%)"
 
+/// Number of columns in ROCKET_LOG_HEADER
+#define ROCKET_LOG_COLUMNS 13
+
 #define PRINT_ROCKET(r)                                                                            \
   {                                                                                                \
     (r).d.self = &(r);                                                                             \
     clrscrn();                                                                                     \
-    println("{}", &(r));                                                                           \
+    display_putln(&(r));                                                                           \
     _sleep_(0.01);                                                                                 \
   }
 
@@ -68,4 +72,11 @@ int display_rocket(const void *self);
 int fdisplay_rocket(const void *self, FILE *file);
 int sndisplay_rocket(const void *self, char *buff, size_t size);
 
+/// Loggable fields of rocket_t, in ROCKET_LOG_HEADER order. Keys: time, dry_mass, fuel_mass,
+/// acc_x, acc_y, acc_z, velocity_x, velocity_y, velocity_z, coord_x, coord_y, altitude, thrust
+extern const log_column_t rocket_log_columns[ROCKET_LOG_COLUMNS];
+
+/// @brief Fills `row` with the values of ROCKET_LOG_HEADER columns
+void rocket_log_row(const rocket_t *r, double row[ROCKET_LOG_COLUMNS]);
+
 #endif // ROCKET_H
@@ -0,0 +1,52 @@
+#ifndef SHARD_LOGGER_H
+#define SHARD_LOGGER_H
+
+/*
+ * @file shard_logger.h
+ * @brief A logger split into per-worker shards
+ *
+ * Every worker thread writes fixed-size binary records (scenario id, time, values) to its own
+ * shard, so workers never contend for a shared FILE lock. When all workers are done the shards
+ * are merged (k-way merge by scenario, then time) into one consolidated logger_t output
+ *
+ * A shard must be written in (scenario, time) order, which holds when every worker processes
+ * its scenarios in increasing order
+ */
+
+#include "logger.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct rocket_t rocket_t;
+
+/**
+ * @struct shard_logger_t
+ * @brief Represents a set of shards sharing one column layout
+ *
+ */
+typedef struct shard_logger_t {
+  FILE **shards;
+  int shard_count;
+  const char *columns; // Comma separated column names of the values
+  uint32_t column_count;
+
+} shard_logger_t;
+
+/// @param shards Number of shards, usually the number of worker threads
+/// @param columns Comma separated names of the values of a record
+shard_logger_t shard_logger_init(int shards, const char *columns);
+int shard_logger_free(shard_logger_t *sl);
+
+/// @brief Appends a record to shard `shard`. Only one thread may write to a shard
+int shard_logger_write(shard_logger_t *sl, int shard, uint64_t scenario, double time,
+                       const double *values);
+/// @brief Appends the ROCKET_LOG_HEADER columns of `r`
+int shard_logger_write_rocket(shard_logger_t *sl, int shard, uint64_t scenario, rocket_t *r);
+
+/// @brief Merges all shards into `out` ordered by scenario and time. A `scenario` column is
+/// prepended to the columns. Shards can't be written after merging
+/// @return Number of merged records or -1 on failure
+long shard_logger_merge(shard_logger_t *sl, logger_t *out);
+
+#endif // SHARD_LOGGER_H
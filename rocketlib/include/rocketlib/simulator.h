@@ -2,6 +2,7 @@
 #define SIMULATOR_H
 
 #include "events.h"
+#include "trajectory.h"
 #include "utils.h"
 
 /**
@@ -27,6 +28,14 @@ typedef struct simulator_t {
 
   void (*take_step)(struct simulator_t *);
 
+  /// @brief Optional: Receives every step of the integrator for dense output
+  trajectory_t *trajectory;
+
+  /// @brief Optional: Local error tolerance of the integrators with an error estimate. When it
+  /// is set they shrink dt until a step is accepted and propose the next step in next_dt
+  double tolerance;
+  double next_dt;
+
 } simulator_t;
 
 #endif // SIMULATOR_H
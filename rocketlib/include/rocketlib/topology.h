@@ -0,0 +1,51 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+/*
+ * @file topology.h
+ * @brief CPU and NUMA topology for worker placement (Linux)
+ *
+ * The CPUs this process may run on are read with sched_getaffinity. Their NUMA nodes come from
+ * /sys/devices/system/node/node<N>/cpulist and their hyperthread siblings from
+ * /sys/devices/system/cpu/cpu<N>/topology/thread_siblings_list. Without sysfs every CPU is on
+ * node 0
+ *
+ * The CPUs are ordered for placement: the first hyperthread of every core comes before the
+ * second ones, and consecutive workers alternate between the nodes. N workers thus get N
+ * separate cores spread evenly over the sockets. A pinned worker allocates its own data(malloc
+ * arenas, buffers) after pinning, so the pages land on its node by first touch
+ *
+ * On other systems topology_detect returns an empty topology and topology_pin fails, so
+ * nothing is pinned
+ */
+
+#include <stdio.h>
+
+/**
+ * @struct topology_t
+ * @brief Usable CPUs in placement order
+ *
+ */
+typedef struct topology_t {
+  int cpu_count, node_count;
+  int *cpus;  // Placement order
+  int *nodes; // NUMA node of every entry of cpus
+
+} topology_t;
+
+/// @return The topology, cpu_count is 0 on failure
+topology_t topology_detect();
+void topology_free(topology_t *t);
+
+/// @brief CPU of worker `worker`, workers beyond cpu_count wrap around
+/// @return The index into cpus or -1 if the topology is empty
+int topology_slot(const topology_t *t, int worker);
+
+/// @brief Pins the calling thread(or process) to one CPU
+/// @return 0 on success or -1 on failure
+int topology_pin(int cpu);
+
+/// @brief Prints the nodes and the placement order into `out`
+void topology_print(const topology_t *t, FILE *out);
+
+#endif // TOPOLOGY_H
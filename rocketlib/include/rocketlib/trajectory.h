@@ -0,0 +1,90 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+/*
+ * @file trajectory.h
+ * @brief A stored continuous trajectory with dense output
+ *
+ * Every accepted integrator step is kept together with its stage derivatives, folded into the
+ * coefficients of the method's continuous extension (a cubic in the step fraction for RK4).
+ * The state can then be queried at any time of the flight without integrating again: the step
+ * is found by index when all steps have the same length(O(1)) or by binary search(O(log n))
+ */
+
+#include "logger.h"
+#include "utils.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct rocket_t rocket_t;
+
+// Upper limit of the stages of a method passed to trajectory_push_dense
+#define TRAJECTORY_MAX_STAGES 8
+
+/**
+ * @struct trajectory_step_t
+ * @brief One accepted step. With θ = (t - time) / dt in [0, 1]:
+ * coords(θ) = coords + dt * (θ dx[0] + θ² dx[1] + θ³ dx[2]), same for velocity with dv
+ *
+ */
+typedef struct trajectory_step_t {
+  double time, dt;
+  vec3_t coords, velocity; // State at the start of the step
+  vec3_t dx[3], dv[3];
+  double fuel_mass, fuel_rate; // kg, kg/s
+  float thrust_percent;
+
+} trajectory_step_t;
+
+/**
+ * @struct trajectory_t
+ * @brief Accepted steps in time order
+ *
+ */
+typedef struct trajectory_t {
+  trajectory_step_t *steps;
+  size_t count, capacity;
+  double end;   // Time of the last state(can be inside the last step after an event)
+  bool uniform; // All steps have the same dt
+
+} trajectory_t;
+
+trajectory_t trajectory_init();
+void trajectory_free(trajectory_t *tr);
+
+/// @brief Records a step of an explicit Runge-Kutta method
+/// @param start State at the start of the step
+/// @param v Velocity at every stage(derivatives of the coordinates)
+/// @param a Acceleration at every stage(derivatives of the velocity)
+/// @param stages 1(Euler), 2(midpoint) or 4(classic RK4)
+/// @return 0 on success or -1 on failure
+int trajectory_push(trajectory_t *tr, const rocket_t *start, double dt, const vec3_t *v,
+                    const vec3_t *a, int stages);
+
+/// @brief Records a step of any explicit Runge-Kutta method with its own continuous extension
+/// @param weights Coefficient j of the step polynomial is sum(weights[j][i] * k_i) over the
+/// stage derivatives k_i
+/// @return 0 on success or -1 on failure
+int trajectory_push_dense(trajectory_t *tr, const rocket_t *start, double dt, const vec3_t *v,
+                          const vec3_t *a, int stages,
+                          const double weights[3][TRAJECTORY_MAX_STAGES]);
+
+/// @brief Ends the trajectory at `time` inside the last step, e.g. at the moment of an event
+int trajectory_truncate(trajectory_t *tr, double time);
+
+/// @return Start time of the trajectory or 0 if it is empty
+double trajectory_start(const trajectory_t *tr);
+
+/// @brief Fills time, coordinates, velocity, acceleration, fuel mass and thrust of `r` with the
+/// state at `time`. Other fields are left as they are
+/// @return 0 on success or -1 if `time` is outside of the trajectory
+int trajectory_at(const trajectory_t *tr, double time, rocket_t *r);
+
+/// @brief Writes the state every `step` seconds from the start to the end of the trajectory
+/// (the end is always written) into `l`
+/// @param r Template for the fields not stored in the trajectory(masses, engine, planet)
+/// @return Number of written states or -1 on failure
+long trajectory_resample(const trajectory_t *tr, const rocket_t *r, double step, logger_t *l);
+
+#endif // TRAJECTORY_H
@@ -1,5 +1,17 @@
 #include "rocketlib/PID.h"
 
+#include <stddef.h>
+
+const log_column_t pid_log_columns[PID_LOG_COLUMNS] = {
+    {"time", "time(s)", offsetof(PID, time), LOG_COLUMN_DOUBLE, 1},
+    {"err", "err(m/s)", offsetof(PID, err), LOG_COLUMN_DOUBLE, 1},
+    {"P", "P", offsetof(PID, P), LOG_COLUMN_DOUBLE, 1},
+    {"I", "I", offsetof(PID, I), LOG_COLUMN_DOUBLE, 1},
+    {"D", "D", offsetof(PID, D), LOG_COLUMN_DOUBLE, 1},
+    {"integral", "integral", offsetof(PID, integral), LOG_COLUMN_DOUBLE, 1},
+    {"output", "thrust_percent(%)", offsetof(PID, output), LOG_COLUMN_DOUBLE, 100},
+};
+
 int display_pid(const void *self) {
   if (!self)
     return -1;
@@ -0,0 +1,214 @@
+#include "rocketlib/aggregate.h"
+
+#include <math.h>
+#include <string.h>
+
+void welford_add(welford_t *w, double x) {
+  w->count++;
+  double d = x - w->mean;
+  w->mean += d / w->count;
+  w->m2 += d * (x - w->mean);
+}
+
+double welford_variance(const welford_t *w) { return w->count > 1 ? w->m2 / (w->count - 1) : 0; }
+
+void extremes_add(extremes_t *e, double time, double x) {
+  if (e->count++ == 0) {
+    e->min = e->max = x;
+    e->min_time = e->max_time = time;
+    return;
+  }
+
+  if (x < e->min) {
+    e->min = x;
+    e->min_time = time;
+  }
+  if (x > e->max) {
+    e->max = x;
+    e->max_time = time;
+  }
+}
+
+p2_t p2_init(double p) {
+  return (p2_t){.p = p,
+                .n = {0, 1, 2, 3, 4},
+                .want = {0, 2 * p, 4 * p, 2 + 2 * p, 4},
+                .dn = {0, p / 2, p, (1 + p) / 2, 1}};
+}
+
+static void sort5(double *v, int count) {
+  for (int i = 1; i < count; i++)
+    for (int j = i; j > 0 && v[j] < v[j - 1]; j--) {
+      double tmp = v[j];
+      v[j] = v[j - 1];
+      v[j - 1] = tmp;
+    }
+}
+
+void p2_add(p2_t *q, double x) {
+  if (q->count < 5) {
+    q->q[q->count++] = x;
+    if (q->count == 5)
+      sort5(q->q, 5);
+    return;
+  }
+  q->count++;
+
+  // Cell of x, the outer markers follow new extremes
+  int k;
+  if (x < q->q[0]) {
+    q->q[0] = x;
+    k = 0;
+  } else if (x >= q->q[4]) {
+    q->q[4] = x;
+    k = 3;
+  } else
+    for (k = 0; x >= q->q[k + 1]; k++)
+      ;
+
+  for (int i = k + 1; i < 5; i++)
+    q->n[i]++;
+  for (int i = 0; i < 5; i++)
+    q->want[i] += q->dn[i];
+
+  // Moves the middle markers back towards their desired positions
+  for (int i = 1; i < 4; i++) {
+    double d = q->want[i] - q->n[i];
+    if (!((d >= 1 && q->n[i + 1] - q->n[i] > 1) || (d <= -1 && q->n[i - 1] - q->n[i] < -1)))
+      continue;
+
+    int s = d > 0 ? 1 : -1;
+    double parabolic =
+        q->q[i] + s / (q->n[i + 1] - q->n[i - 1]) *
+                      ((q->n[i] - q->n[i - 1] + s) * (q->q[i + 1] - q->q[i]) /
+                           (q->n[i + 1] - q->n[i]) +
+                       (q->n[i + 1] - q->n[i] - s) * (q->q[i] - q->q[i - 1]) /
+                           (q->n[i] - q->n[i - 1]));
+    if (q->q[i - 1] < parabolic && parabolic < q->q[i + 1])
+      q->q[i] = parabolic;
+    else // Linear when the parabola would break the order
+      q->q[i] += s * (q->q[i + s] - q->q[i]) / (q->n[i + s] - q->n[i]);
+    q->n[i] += s;
+  }
+}
+
+double p2_value(const p2_t *q) {
+  if (q->count == 0)
+    return NAN;
+  if (q->count >= 5)
+    return q->q[2];
+
+  double v[5];
+  memcpy(v, q->q, sizeof(double) * q->count);
+  sort5(v, q->count);
+
+  return v[(int)(q->p * (q->count - 1) + 0.5)];
+}
+
+int aggregate_set_add(aggregate_set_t *s, const char *name, aggregate_fn value, unsigned flags,
+                      const double *quantiles, int quantile_count) {
+  if (!s || !name || !value || s->count == AGGREGATE_MAX || quantile_count < 0 ||
+      quantile_count > AGGREGATE_MAX_QUANTILES || (quantile_count && !quantiles))
+    return -1;
+
+  aggregate_t *a = &s->items[s->count];
+  *a = (aggregate_t){.name = name,
+                     .value = value,
+                     .flags = flags,
+                     .first = NAN,
+                     .last = NAN,
+                     .quantiles = quantile_count};
+  for (int i = 0; i < quantile_count; i++) {
+    if (!(quantiles[i] > 0 && quantiles[i] < 1))
+      return -1;
+    a->q[i] = p2_init(quantiles[i]);
+  }
+  s->count++;
+
+  return 0;
+}
+
+void aggregate_set_reset(aggregate_set_t *s) {
+  if (!s)
+    return;
+
+  for (int i = 0; i < s->count; i++) {
+    aggregate_t *a = &s->items[i];
+    a->w = (welford_t){0};
+    a->e = (extremes_t){0};
+    a->first = a->last = NAN;
+    for (int k = 0; k < a->quantiles; k++)
+      a->q[k] = p2_init(a->q[k].p);
+  }
+  s->samples = 0;
+  s->start = s->end = NAN;
+}
+
+void aggregate_set_sample(aggregate_set_t *s, double time, const void *obj) {
+  if (!s)
+    return;
+
+  if (s->samples++ == 0)
+    s->start = time;
+  s->end = time;
+
+  for (int i = 0; i < s->count; i++) {
+    aggregate_t *a = &s->items[i];
+    double x = a->value(obj);
+    if (!isfinite(x))
+      continue;
+
+    if (a->w.count == 0)
+      a->first = x;
+    a->last = x;
+    welford_add(&a->w, x); // Also counts the values for AGGREGATE_ENDS
+    if (a->flags & AGGREGATE_EXTREMES)
+      extremes_add(&a->e, time, x);
+    for (int k = 0; k < a->quantiles; k++)
+      p2_add(&a->q[k], x);
+  }
+}
+
+int aggregate_set_write_header(const aggregate_set_t *s, FILE *file) {
+  if (!s || !file)
+    return -1;
+
+  fprintf(file, "duration,samples");
+  for (int i = 0; i < s->count; i++) {
+    const aggregate_t *a = &s->items[i];
+    if (a->flags & AGGREGATE_MEAN)
+      fprintf(file, ",%s_mean,%s_std", a->name, a->name);
+    if (a->flags & AGGREGATE_EXTREMES)
+      fprintf(file, ",%s_min,%s_min_time,%s_max,%s_max_time", a->name, a->name, a->name, a->name);
+    if (a->flags & AGGREGATE_ENDS)
+      fprintf(file, ",%s_first,%s_last", a->name, a->name);
+    for (int k = 0; k < a->quantiles; k++)
+      fprintf(file, ",%s_p%g", a->name, 100 * a->q[k].p);
+  }
+
+  return ferror(file) ? -1 : 0;
+}
+
+int aggregate_set_write(const aggregate_set_t *s, FILE *file) {
+  if (!s || !file)
+    return -1;
+
+  fprintf(file, "%.9g,%llu", s->samples ? s->end - s->start : 0,
+          (unsigned long long)s->samples);
+  for (int i = 0; i < s->count; i++) {
+    const aggregate_t *a = &s->items[i];
+    bool any = a->w.count > 0;
+    if (a->flags & AGGREGATE_MEAN)
+      fprintf(file, ",%.9g,%.9g", any ? a->w.mean : NAN,
+              any ? sqrt(welford_variance(&a->w)) : NAN);
+    if (a->flags & AGGREGATE_EXTREMES)
+      fprintf(file, ",%.9g,%.9g,%.9g,%.9g", any ? a->e.min : NAN, any ? a->e.min_time : NAN,
+              any ? a->e.max : NAN, any ? a->e.max_time : NAN);
+    if (a->flags & AGGREGATE_ENDS)
+      fprintf(file, ",%.9g,%.9g", a->first, a->last);
+    for (int k = 0; k < a->quantiles; k++)
+      fprintf(file, ",%.9g", p2_value(&a->q[k]));
+  }
+
+  return ferror(file) ? -1 : 0;
+}
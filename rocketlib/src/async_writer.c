@@ -0,0 +1,543 @@
+#define _GNU_SOURCE
+#include "rocketlib/async_writer.h"
+
+#include "rocketlib/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+// IORING_OP_WRITE is an enum, IORING_FEAT_FAST_POLL comes with the same headers (Linux 5.7)
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(IORING_FEAT_FAST_POLL)
+#define HAVE_IO_URING 1
+#endif
+
+#define ASYNC_WRITER_ALIGN 4096
+#define ASYNC_WRITER_RING_ENTRIES 4
+
+typedef struct async_buffer_t {
+  char *data;
+  size_t used;
+  uint64_t offset; // File offset of data[0]
+  int in_flight;
+
+} async_buffer_t;
+
+#ifdef HAVE_IO_URING
+typedef struct uring_t {
+  int fd;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ring, *cq_ring;
+  size_t sq_ring_size, cq_ring_size, sqes_size;
+
+} uring_t;
+#endif
+
+struct async_writer_t {
+  int fd;
+  atomic_int error; // errno of a failed write, also set by the writer thread
+  async_buffer_t buffers[2];
+  int current;
+  size_t buffer_size;
+  uint64_t append_offset; // Offset of the next appended byte
+  uint64_t pos;           // Position of the FILE wrapper
+  async_writer_stats_t stats;
+
+#ifdef HAVE_IO_URING
+  uring_t ring;
+#endif
+
+  // Writer thread backend
+  thrd_t thread;
+  mtx_t lock;
+  cnd_t cond;
+  int queue[2], queue_head, queue_count;
+  int stop;
+};
+
+static double now() {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int pwrite_all(int fd, const char *data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t n = pwrite(fd, data, size, (off_t)offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    data += n;
+    size -= (size_t)n;
+    offset += (uint64_t)n;
+  }
+
+  return 0;
+}
+
+/*----------------------------io_uring----------------------------*/
+
+#ifdef HAVE_IO_URING
+static int uring_init(uring_t *r) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+
+  r->fd = (int)syscall(__NR_io_uring_setup, ASYNC_WRITER_RING_ENTRIES, &p);
+  if (r->fd < 0)
+    return -1;
+
+  // Older kernels don't know IORING_OP_WRITE
+  if (!(p.features & IORING_FEAT_FAST_POLL)) {
+    close(r->fd);
+    return -1;
+  }
+
+  r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (r->cq_ring_size > r->sq_ring_size)
+      r->sq_ring_size = r->cq_ring_size;
+    r->cq_ring_size = r->sq_ring_size;
+  }
+
+  r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    r->fd, IORING_OFF_SQ_RING);
+  if (r->sq_ring == MAP_FAILED) {
+    close(r->fd);
+    return -1;
+  }
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    r->cq_ring = r->sq_ring;
+  else {
+    r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_ring == MAP_FAILED) {
+      munmap(r->sq_ring, r->sq_ring_size);
+      close(r->fd);
+      return -1;
+    }
+  }
+
+  r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = (struct io_uring_sqe *)mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED) {
+    if (r->cq_ring != r->sq_ring)
+      munmap(r->cq_ring, r->cq_ring_size);
+    munmap(r->sq_ring, r->sq_ring_size);
+    close(r->fd);
+    return -1;
+  }
+
+  char *sq = (char *)r->sq_ring, *cq = (char *)r->cq_ring;
+  r->sq_head = (unsigned *)(sq + p.sq_off.head);
+  r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  r->sq_array = (unsigned *)(sq + p.sq_off.array);
+  r->cq_head = (unsigned *)(cq + p.cq_off.head);
+  r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+  return 0;
+}
+
+static void uring_free(uring_t *r) {
+  munmap(r->sqes, r->sqes_size);
+  if (r->cq_ring != r->sq_ring)
+    munmap(r->cq_ring, r->cq_ring_size);
+  munmap(r->sq_ring, r->sq_ring_size);
+  close(r->fd);
+}
+
+static int uring_submit(async_writer_t *w, int idx) {
+  uring_t *r = &w->ring;
+  async_buffer_t *b = &w->buffers[idx];
+
+  unsigned tail = *r->sq_tail;
+  unsigned slot = tail & *r->sq_mask;
+  struct io_uring_sqe *sqe = &r->sqes[slot];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_WRITE;
+  sqe->fd = w->fd;
+  sqe->addr = (uint64_t)(uintptr_t)b->data;
+  sqe->len = (unsigned)b->used;
+  sqe->off = b->offset;
+  sqe->user_data = (uint64_t)idx;
+  r->sq_array[slot] = slot;
+  __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+  while (syscall(__NR_io_uring_enter, r->fd, 1, 0, 0, NULL, 0) < 0)
+    if (errno != EINTR)
+      return -1;
+
+  return 0;
+}
+
+/// @brief Reaps completions, blocking until at least one arrives if `wait` is set
+static int uring_reap(async_writer_t *w, int wait) {
+  uring_t *r = &w->ring;
+  unsigned head = *r->cq_head;
+
+  if (wait && head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+    while (syscall(__NR_io_uring_enter, r->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+      if (errno != EINTR)
+        return -1;
+  }
+
+  while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+    async_buffer_t *b = &w->buffers[cqe->user_data];
+
+    if (cqe->res < 0)
+      atomic_store(&w->error, -cqe->res);
+    else if ((size_t)cqe->res < b->used &&
+             pwrite_all(w->fd, b->data + cqe->res, b->used - cqe->res, b->offset + cqe->res) != 0)
+      atomic_store(&w->error, errno); // Short write, finish it synchronously
+
+    b->in_flight = 0;
+    w->stats.writes_completed++;
+    w->stats.bytes_completed += b->used;
+    head++;
+  }
+  __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+  return 0;
+}
+#endif
+
+/*-------------------------Writer thread--------------------------*/
+
+static int writer_thread(void *arg) {
+  async_writer_t *w = (async_writer_t *)arg;
+
+  mtx_lock(&w->lock);
+  for (;;) {
+    while (w->queue_count == 0 && !w->stop)
+      cnd_wait(&w->cond, &w->lock);
+    if (w->queue_count == 0)
+      break;
+
+    int idx = w->queue[w->queue_head];
+    async_buffer_t *b = &w->buffers[idx];
+    mtx_unlock(&w->lock);
+
+    int result = pwrite_all(w->fd, b->data, b->used, b->offset);
+
+    mtx_lock(&w->lock);
+    if (result != 0)
+      atomic_store(&w->error, errno);
+    w->queue_head = (w->queue_head + 1) % 2;
+    w->queue_count--;
+    b->in_flight = 0;
+    w->stats.writes_completed++;
+    w->stats.bytes_completed += b->used;
+    cnd_broadcast(&w->cond);
+  }
+  mtx_unlock(&w->lock);
+
+  return 0;
+}
+
+/*----------------------------Writer------------------------------*/
+
+static int submit(async_writer_t *w, int idx) {
+  async_buffer_t *b = &w->buffers[idx];
+  if (b->used == 0)
+    return 0;
+
+  b->in_flight = 1;
+  w->stats.writes_submitted++;
+  w->stats.bytes_submitted += b->used;
+
+#ifdef HAVE_IO_URING
+  if (w->stats.backend == ASYNC_WRITER_IO_URING)
+    return uring_submit(w, idx);
+#endif
+
+  mtx_lock(&w->lock);
+  w->queue[(w->queue_head + w->queue_count) % 2] = idx;
+  w->queue_count++;
+  cnd_broadcast(&w->cond);
+  mtx_unlock(&w->lock);
+
+  return 0;
+}
+
+/// @brief Blocks until buffer `idx` is no longer in flight
+static int wait_buffer(async_writer_t *w, int idx) {
+  async_buffer_t *b = &w->buffers[idx];
+
+#ifdef HAVE_IO_URING
+  if (w->stats.backend == ASYNC_WRITER_IO_URING) {
+    while (b->in_flight)
+      if (uring_reap(w, 1) != 0)
+        return -1;
+    return 0;
+  }
+#endif
+
+  mtx_lock(&w->lock);
+  while (b->in_flight)
+    cnd_wait(&w->cond, &w->lock);
+  mtx_unlock(&w->lock);
+
+  return 0;
+}
+
+static int is_in_flight(async_writer_t *w, int idx) {
+#ifdef HAVE_IO_URING
+  if (w->stats.backend == ASYNC_WRITER_IO_URING) {
+    uring_reap(w, 0);
+    return w->buffers[idx].in_flight;
+  }
+#endif
+
+  mtx_lock(&w->lock);
+  int result = w->buffers[idx].in_flight;
+  mtx_unlock(&w->lock);
+
+  return result;
+}
+
+async_writer_t *async_writer_open(const char *filename, size_t buffer_size, int flags) {
+  if (!filename)
+    return NULL;
+
+  async_writer_t *w = (async_writer_t *)calloc(1, sizeof(async_writer_t));
+  if (!w)
+    return NULL;
+
+  atomic_init(&w->error, 0);
+  w->buffer_size = buffer_size ? buffer_size : ASYNC_WRITER_BUFFER_SIZE;
+  w->buffer_size =
+      (w->buffer_size + ASYNC_WRITER_ALIGN - 1) / ASYNC_WRITER_ALIGN * ASYNC_WRITER_ALIGN;
+  for (int i = 0; i < 2; i++) {
+    w->buffers[i].data = (char *)aligned_alloc(ASYNC_WRITER_ALIGN, w->buffer_size);
+    if (!w->buffers[i].data) {
+      free(w->buffers[0].data);
+      free(w);
+      return NULL;
+    }
+  }
+
+  w->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (w->fd < 0) {
+    free(w->buffers[0].data);
+    free(w->buffers[1].data);
+    free(w);
+    return NULL;
+  }
+
+  w->stats.backend = ASYNC_WRITER_THREAD;
+#ifdef HAVE_IO_URING
+  if (!(flags & ASYNC_WRITER_FORCE_THREAD) && uring_init(&w->ring) == 0)
+    w->stats.backend = ASYNC_WRITER_IO_URING;
+#else
+  (void)flags;
+#endif
+
+  if (w->stats.backend == ASYNC_WRITER_THREAD) {
+    if (mtx_init(&w->lock, mtx_plain) != thrd_success)
+      goto fail;
+    if (cnd_init(&w->cond) != thrd_success) {
+      mtx_destroy(&w->lock);
+      goto fail;
+    }
+    if (thrd_create(&w->thread, writer_thread, w) != thrd_success) {
+      cnd_destroy(&w->cond);
+      mtx_destroy(&w->lock);
+      goto fail;
+    }
+  }
+
+  return w;
+
+fail:
+  close(w->fd);
+  free(w->buffers[0].data);
+  free(w->buffers[1].data);
+  free(w);
+
+  return NULL;
+}
+
+/// @brief Makes buffer `idx` ready for filling, waiting for its previous write if needed
+static int acquire_buffer(async_writer_t *w, int idx) {
+  if (is_in_flight(w, idx)) {
+    // Both buffers are with the kernel, the caller has to wait
+    double start = now();
+    if (wait_buffer(w, idx) != 0)
+      return -1;
+    w->stats.stalls++;
+    w->stats.stall_seconds += now() - start;
+  }
+
+  w->buffers[idx].used = 0;
+  w->buffers[idx].offset = w->append_offset;
+
+  return 0;
+}
+
+int async_writer_write(async_writer_t *w, const void *data, size_t size) {
+  if (!w || (!data && size > 0))
+    return -1;
+
+  // The current buffer is never in flight
+  const char *p = (const char *)data;
+  while (size > 0) {
+    async_buffer_t *b = &w->buffers[w->current];
+    size_t n = MIN(size, w->buffer_size - b->used);
+    memcpy(b->data + b->used, p, n);
+    b->used += n;
+    w->append_offset += n;
+    p += n;
+    size -= n;
+
+    if (b->used == w->buffer_size) {
+      if (submit(w, w->current) != 0)
+        return -1;
+      w->current ^= 1;
+      if (acquire_buffer(w, w->current) != 0)
+        return -1;
+    }
+  }
+
+  return atomic_load(&w->error) ? -1 : 0;
+}
+
+int async_writer_flush(async_writer_t *w) {
+  if (!w)
+    return -1;
+
+  if (submit(w, w->current) != 0)
+    return -1;
+
+  for (int i = 0; i < 2; i++) {
+    if (wait_buffer(w, i) != 0)
+      return -1;
+    w->buffers[i].used = 0;
+    w->buffers[i].offset = w->append_offset;
+  }
+
+  return atomic_load(&w->error) ? -1 : 0;
+}
+
+int async_writer_write_at(async_writer_t *w, const void *data, size_t size, uint64_t offset) {
+  if (!w || async_writer_flush(w) != 0)
+    return -1;
+
+  if (pwrite_all(w->fd, (const char *)data, size, offset) != 0)
+    return -1;
+  if (offset + size > w->append_offset)
+    w->append_offset = offset + size;
+
+  return 0;
+}
+
+async_writer_stats_t async_writer_stats(async_writer_t *w) {
+  if (!w)
+    return (async_writer_stats_t){0};
+
+  if (w->stats.backend == ASYNC_WRITER_IO_URING) {
+#ifdef HAVE_IO_URING
+    uring_reap(w, 0);
+#endif
+    return w->stats;
+  }
+
+  mtx_lock(&w->lock);
+  async_writer_stats_t stats = w->stats;
+  mtx_unlock(&w->lock);
+
+  return stats;
+}
+
+int async_writer_close(async_writer_t *w) {
+  if (!w)
+    return -1;
+
+  int result = async_writer_flush(w);
+
+#ifdef HAVE_IO_URING
+  if (w->stats.backend == ASYNC_WRITER_IO_URING)
+    uring_free(&w->ring);
+#endif
+
+  if (w->stats.backend == ASYNC_WRITER_THREAD) {
+    mtx_lock(&w->lock);
+    w->stop = 1;
+    cnd_broadcast(&w->cond);
+    mtx_unlock(&w->lock);
+    thrd_join(w->thread, NULL);
+    mtx_destroy(&w->lock);
+    cnd_destroy(&w->cond);
+  }
+
+  if (close(w->fd) != 0)
+    result = -1;
+  free(w->buffers[0].data);
+  free(w->buffers[1].data);
+  free(w);
+
+  return result;
+}
+
+/*-------------------------FILE wrapper---------------------------*/
+
+static ssize_t cookie_write(void *cookie, const char *data, size_t size) {
+  async_writer_t *w = (async_writer_t *)cookie;
+
+  // Writes after a seek (e.g. patching a header) go straight to the file
+  int result = w->pos == w->append_offset ? async_writer_write(w, data, size)
+                                          : async_writer_write_at(w, data, size, w->pos);
+  if (result != 0)
+    return -1;
+
+  w->pos += size;
+  return (ssize_t)size;
+}
+
+static int cookie_seek(void *cookie, off64_t *offset, int whence) {
+  async_writer_t *w = (async_writer_t *)cookie;
+
+  int64_t base = 0;
+  if (whence == SEEK_CUR)
+    base = (int64_t)w->pos;
+  else if (whence == SEEK_END)
+    base = (int64_t)w->append_offset;
+  if (base + *offset < 0)
+    return -1;
+
+  w->pos = (uint64_t)(base + *offset);
+  *offset = (off64_t)w->pos;
+
+  return 0;
+}
+
+static int cookie_close(void *cookie) { return async_writer_flush((async_writer_t *)cookie); }
+
+FILE *async_writer_fopen(async_writer_t *w) {
+  if (!w)
+    return NULL;
+
+  cookie_io_functions_t io = {NULL, cookie_write, cookie_seek, cookie_close};
+  return fopencookie(w, "w", io);
+}
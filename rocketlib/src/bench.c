@@ -0,0 +1,290 @@
+#include "rocketlib/bench.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+bench_t bench_init() {
+  return (bench_t){.repeats = BENCH_DEFAULT_REPEATS, .threshold = BENCH_DEFAULT_THRESHOLD};
+}
+
+void bench_free(bench_t *b) {
+  if (!b)
+    return;
+
+  free(b->results);
+  b->results = NULL;
+  b->count = b->capacity = 0;
+}
+
+double bench_now() {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int bench_parse_flag(bench_t *b, int argc, char *argv[], int *i) {
+  if (!b || !argv || !i || *i >= argc)
+    return -1;
+
+  const char *token = argv[*i];
+  if (strcmp(token, "--repeats") != 0 && strcmp(token, "--baseline") != 0 &&
+      strcmp(token, "--compare") != 0 && strcmp(token, "--threshold") != 0)
+    return 0;
+
+  if (*i + 1 >= argc) {
+    fprintf(stderr, "Expected value after '%s'!\n", token);
+    return -1;
+  }
+  const char *value = argv[++*i];
+
+  if (strcmp(token, "--baseline") == 0)
+    b->baseline = value;
+  else if (strcmp(token, "--compare") == 0)
+    b->compare = value;
+  else if (strcmp(token, "--repeats") == 0) {
+    if ((b->repeats = atoi(value)) <= 0) {
+      fprintf(stderr, "Invalid value : %s\n", value);
+      return -1;
+    }
+  } else if ((b->threshold = atof(value) / 100) <= 0) {
+    fprintf(stderr, "Invalid value : %s\n", value);
+    return -1;
+  }
+
+  return 1;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// `values` must be sorted
+static double median(const double *values, int count) {
+  return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+static bench_result_t *bench_push(bench_t *b, const char *name) {
+  if (b->count == b->capacity) {
+    size_t capacity = b->capacity ? b->capacity * 2 : 16;
+    bench_result_t *results =
+        (bench_result_t *)realloc(b->results, capacity * sizeof(bench_result_t));
+    if (!results)
+      return NULL;
+    b->results = results;
+    b->capacity = capacity;
+  }
+
+  bench_result_t *r = &b->results[b->count++];
+  *r = (bench_result_t){0};
+  snprintf(r->name, sizeof(r->name), "%s", name);
+
+  return r;
+}
+
+const bench_result_t *bench_add(bench_t *b, const char *name, double *samples, int count) {
+  if (!b || !name || !samples || count <= 0)
+    return NULL;
+
+  double *deviations = (double *)malloc(count * sizeof(double));
+  if (!deviations)
+    return NULL;
+
+  qsort(samples, count, sizeof(double), compare_doubles);
+  double m = median(samples, count);
+  for (int i = 0; i < count; i++)
+    deviations[i] = fabs(samples[i] - m);
+  qsort(deviations, count, sizeof(double), compare_doubles);
+
+  bench_result_t *r = bench_push(b, name);
+  if (r) {
+    r->median = m;
+    r->mad = median(deviations, count);
+    r->repeats = count;
+  }
+
+  free(deviations);
+
+  return r;
+}
+
+const bench_result_t *bench_find(const bench_t *b, const char *name) {
+  if (!b || !name)
+    return NULL;
+
+  for (size_t i = 0; i < b->count; i++)
+    if (strcmp(b->results[i].name, name) == 0)
+      return &b->results[i];
+
+  return NULL;
+}
+
+int bench_write_json(const bench_t *b, const char *filename) {
+  if (!b || !filename)
+    return -1;
+
+  FILE *file = fopen(filename, "w");
+  if (!file)
+    return -1;
+
+  fprintf(file, "{\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < b->count; i++) {
+    const bench_result_t *r = &b->results[i];
+    fprintf(file, "    {\"name\": \"%s\", \"median\": %.9e, \"mad\": %.9e, \"repeats\": %d}%s\n",
+            r->name, r->median, r->mad, r->repeats, i + 1 < b->count ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+// Finds "key": inside [p, end) and returns a pointer past the colon
+static const char *json_value(const char *p, const char *end, const char *key) {
+  char pattern[BENCH_NAME_SIZE];
+  snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+
+  const char *found = strstr(p, pattern);
+  if (!found || found >= end)
+    return NULL;
+
+  found = strchr(found + strlen(pattern), ':');
+  return found && found < end ? found + 1 : NULL;
+}
+
+int bench_read_json(bench_t *b, const char *filename) {
+  if (!b || !filename)
+    return -1;
+
+  FILE *file = fopen(filename, "r");
+  if (!file)
+    return -1;
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+
+  char *text = size > 0 ? (char *)malloc(size + 1) : NULL;
+  if (!text || fread(text, 1, size, file) != (size_t)size) {
+    free(text);
+    fclose(file);
+    return -1;
+  }
+  text[size] = '\0';
+  fclose(file);
+
+  // Only the flat objects written by bench_write_json are understood
+  int result = 0;
+  const char *p = text;
+  while ((p = strchr(p, '{')) != NULL) {
+    const char *end = strchr(p + 1, '}');
+    const char *next = strchr(p + 1, '{');
+    if (!end)
+      break;
+    if (next && next < end) { // Enclosing object
+      p = next;
+      continue;
+    }
+
+    const char *name = json_value(p, end, "name");
+    const char *m = json_value(p, end, "median");
+    const char *mad = json_value(p, end, "mad");
+    const char *repeats = json_value(p, end, "repeats");
+    if (!name || !m || !mad || !(name = strchr(name, '"')) || name >= end) {
+      result = -1;
+      break;
+    }
+
+    char key[BENCH_NAME_SIZE];
+    size_t len = strcspn(name + 1, "\"");
+    snprintf(key, sizeof(key), "%.*s", (int)len, name + 1);
+
+    bench_result_t *r = bench_push(b, key);
+    if (!r) {
+      result = -1;
+      break;
+    }
+    r->median = strtod(m, NULL);
+    r->mad = strtod(mad, NULL);
+    r->repeats = repeats ? atoi(repeats) : 1;
+
+    p = end + 1;
+  }
+
+  free(text);
+
+  return result;
+}
+
+int bench_compare(const bench_t *current, const bench_t *baseline, double threshold, FILE *out) {
+  if (!current || !baseline || !out)
+    return -1;
+
+  int regressions = 0;
+  fprintf(out, "%-32s %12s %12s %9s %9s  %s\n", "benchmark", "baseline(s)", "current(s)", "delta",
+          "noise", "status");
+
+  for (size_t i = 0; i < current->count; i++) {
+    const bench_result_t *cur = &current->results[i];
+    const bench_result_t *base = bench_find(baseline, cur->name);
+    if (!base || base->median <= 0) {
+      fprintf(out, "%-32s %12s %12.4e %9s %9s  new\n", cur->name, "-", cur->median, "-", "-");
+      continue;
+    }
+
+    double delta = cur->median - base->median;
+    double noise = BENCH_NOISE_SIGMAS * BENCH_MAD_TO_SIGMA *
+                   sqrt(cur->mad * cur->mad + base->mad * base->mad);
+
+    const char *status = "ok";
+    if (delta > threshold * base->median && delta > noise) {
+      status = "REGRESSION";
+      regressions++;
+    } else if (-delta > threshold * base->median && -delta > noise)
+      status = "faster";
+
+    fprintf(out, "%-32s %12.4e %12.4e %+8.2f%% %8.2f%%  %s\n", cur->name, base->median,
+            cur->median, 100 * delta / base->median, 100 * noise / base->median, status);
+  }
+
+  for (size_t i = 0; i < baseline->count; i++)
+    if (!bench_find(current, baseline->results[i].name))
+      fprintf(out, "%-32s %12.4e %12s %9s %9s  missing\n", baseline->results[i].name,
+              baseline->results[i].median, "-", "-", "-");
+
+  return regressions;
+}
+
+int bench_finish(bench_t *b) {
+  if (!b)
+    return -1;
+
+  if (b->baseline) {
+    if (bench_write_json(b, b->baseline) != 0) {
+      fprintf(stderr, "Can't write baseline '%s'\n", b->baseline);
+      return -1;
+    }
+    fprintf(stderr, "Baseline written to '%s'\n", b->baseline);
+  }
+
+  if (!b->compare)
+    return 0;
+
+  bench_t baseline = bench_init();
+  if (bench_read_json(&baseline, b->compare) != 0) {
+    fprintf(stderr, "Can't read baseline '%s'\n", b->compare);
+    bench_free(&baseline);
+    return -1;
+  }
+
+  int regressions = bench_compare(b, &baseline, b->threshold, stderr);
+  bench_free(&baseline);
+  if (regressions < 0)
+    return -1;
+
+  fprintf(stderr, "%d regression(s) above %.1f%% and the noise level\n", regressions,
+          100 * b->threshold);
+
+  return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+#define _POSIX_C_SOURCE 200809L
+#include "rocketlib/checkpoint.h"
+
+#include <math.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+checkpoint_t checkpoint_begin(const char *filename) {
+  checkpoint_t c = {0};
+  if (!filename || strlen(filename) >= MAX_LINE)
+    return c;
+
+  strcpy(c.filename, filename);
+  snprintf(c.tmp, sizeof(c.tmp), "%s.tmp", filename);
+  c.file = fopen(c.tmp, "w");
+
+  return c;
+}
+
+void checkpoint_section(checkpoint_t *c, const char *name) {
+  if (c && c->file)
+    fprintf(c->file, "%s[%s]\n", ftell(c->file) > 0 ? "\n" : "", name);
+}
+
+void checkpoint_value(checkpoint_t *c, const char *key, double value) {
+  if (!c || !c->file)
+    return;
+
+  if (value == trunc(value) && fabs(value) < 1e15) // Counters and round values stay readable
+    fprintf(c->file, "%s = %.0f\n", key, value);
+  else
+    fprintf(c->file, "%s = %a\n", key, value);
+}
+
+// Pushes the flushed file to the disk, so the rename never replaces a state with a partial one
+static int checkpoint_sync(FILE *file) {
+#if defined(_WIN32)
+  return _commit(_fileno(file));
+#elif defined(__unix__) || defined(__APPLE__)
+  return fsync(fileno(file));
+#else
+  (void)file;
+  return 0; // Only the fflush, the state may be lost on a crash of the system
+#endif
+}
+
+int checkpoint_commit(checkpoint_t *c) {
+  if (!c || !c->file)
+    return -1;
+
+  int failed = fflush(c->file) != 0 || ferror(c->file) || checkpoint_sync(c->file) != 0;
+  failed |= fclose(c->file) != 0;
+  c->file = NULL;
+
+  if (failed || rename(c->tmp, c->filename) != 0) {
+    remove(c->tmp);
+    return -1;
+  }
+
+  return 0;
+}
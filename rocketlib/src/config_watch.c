@@ -0,0 +1,154 @@
+#define _POSIX_C_SOURCE 200809L
+#include "rocketlib/config_watch.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <threads.h>
+#include <unistd.h>
+
+// How often the thread checks if it should stop(ms)
+#define CONFIG_WATCH_POLL_MS 100
+
+struct config_watch_t {
+  int fd, wd;
+  const char *filename;
+  char dir[MAX_LINE], name[MAX_NAME];
+
+  thrd_t thread;
+  atomic_bool stop;
+  _Atomic(fparser_t *) pending; // Newest snapshot not taken yet
+  atomic_uint_fast64_t reloads;
+};
+
+// Parses the file and publishes the snapshot, replacing one which wasn't taken
+static void config_watch_reload(config_watch_t *w) {
+  fparser_t *fp = (fparser_t *)malloc(sizeof(fparser_t));
+  if (!fp)
+    return;
+
+  *fp = (fparser_t){.filename = w->filename};
+  if (fparser_reload(fp) != 0) { // Removed or replaced right now, wait for the next event
+    free(fp);
+    return;
+  }
+
+  free(atomic_exchange(&w->pending, fp));
+  atomic_fetch_add(&w->reloads, 1);
+}
+
+static int config_watch_thread(void *arg) {
+  config_watch_t *w = (config_watch_t *)arg;
+  _Alignas(struct inotify_event) char events[4096];
+  struct pollfd pfd = {.fd = w->fd, .events = POLLIN};
+
+  while (!atomic_load(&w->stop)) {
+    if (poll(&pfd, 1, CONFIG_WATCH_POLL_MS) <= 0)
+      continue;
+
+    ssize_t len = read(w->fd, events, sizeof(events));
+    int changed = 0;
+    for (char *p = events; len > 0 && p < events + len;) {
+      struct inotify_event *ev = (struct inotify_event *)p;
+      if (ev->len && strcmp(ev->name, w->name) == 0)
+        changed = 1;
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+
+    if (changed)
+      config_watch_reload(w);
+  }
+
+  return 0;
+}
+
+config_watch_t *config_watch_open(const char *filename) {
+  if (!filename)
+    return NULL;
+
+  config_watch_t *w = (config_watch_t *)calloc(1, sizeof(config_watch_t));
+  if (!w)
+    return NULL;
+  w->filename = filename;
+
+  // The directory is watched, so the file can be replaced by rename. A truncated path would
+  // watch another directory or never match the name
+  const char *slash = strrchr(filename, '/');
+  int dir = slash ? snprintf(w->dir, sizeof(w->dir), "%.*s", (int)(slash - filename + 1), filename)
+                  : snprintf(w->dir, sizeof(w->dir), ".");
+  int name = snprintf(w->name, sizeof(w->name), "%s", slash ? slash + 1 : filename);
+  if (dir < 0 || (size_t)dir >= sizeof(w->dir) || name < 0 || (size_t)name >= sizeof(w->name)) {
+    free(w);
+    return NULL;
+  }
+
+  atomic_init(&w->stop, false);
+  atomic_init(&w->pending, NULL);
+  atomic_init(&w->reloads, 0);
+
+  w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (w->fd < 0) {
+    free(w);
+    return NULL;
+  }
+
+  w->wd = inotify_add_watch(w->fd, w->dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (w->wd < 0 || thrd_create(&w->thread, config_watch_thread, w) != thrd_success) {
+    close(w->fd);
+    free(w);
+    return NULL;
+  }
+
+  return w;
+}
+
+int config_watch_close(config_watch_t *w) {
+  if (!w)
+    return -1;
+
+  atomic_store(&w->stop, true);
+  thrd_join(w->thread, NULL);
+
+  close(w->fd);
+  free(atomic_load(&w->pending));
+  free(w);
+
+  return 0;
+}
+
+fparser_t *config_watch_take(config_watch_t *w) {
+  if (!w || !atomic_load_explicit(&w->pending, memory_order_relaxed))
+    return NULL;
+
+  return atomic_exchange(&w->pending, NULL);
+}
+
+uint64_t config_watch_reloads(config_watch_t *w) { return w ? atomic_load(&w->reloads) : 0; }
+
+#else
+
+// Without inotify there is nothing to watch, so there is never a watcher
+config_watch_t *config_watch_open(const char *filename) {
+  (void)filename;
+  return NULL;
+}
+
+int config_watch_close(config_watch_t *w) {
+  (void)w;
+  return -1;
+}
+
+fparser_t *config_watch_take(config_watch_t *w) {
+  (void)w;
+  return NULL;
+}
+
+uint64_t config_watch_reloads(config_watch_t *w) {
+  (void)w;
+  return 0;
+}
+
+#endif // __linux__
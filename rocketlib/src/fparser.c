@@ -1,5 +1,6 @@
 #include "rocketlib/fparser.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 fparser_t fparser_init(const char *filename) {
@@ -69,6 +70,277 @@ int fparser_parse(fparser_t *fp) {
   return 0;
 }
 
+int fparser_reload(fparser_t *fp) {
+  if (!fp || !fp->filename)
+    return -1;
+
+  fp->file = fopen(fp->filename, "r");
+  if (!fp->file)
+    return -1;
+
+  int result = fparser_parse(fp);
+  fparser_free(fp);
+
+  return result;
+}
+
+static void fparser_store(const fparser_binding_t *b, void *obj, double value) {
+  char *field = (char *)obj + b->offset;
+
+  switch (b->type) {
+  case FPARSER_DOUBLE:
+    *(double *)field = value;
+    break;
+  case FPARSER_FLOAT:
+    *(float *)field = (float)value;
+    break;
+  case FPARSER_INT:
+    *(int *)field = (int)value;
+    break;
+  case FPARSER_BOOL:
+    *(bool *)field = value != 0;
+    break;
+  }
+}
+
+// Binds the keys of the sections named in `table`, marking the bindings it sets in `found`
+static void bind_sections(const fparser_t *fp, const fparser_binding_t *table, size_t count,
+                          void *obj, FILE *report, bool *found) {
+  for (int i = 0; i < fp->section_count; i++) {
+    const fparser_section_t *section = &fp->sections[i];
+
+    // Bindings of this section
+    size_t first = count, last = 0;
+    for (size_t k = 0; k < count; k++)
+      if (strcmp(table[k].section, section->name) == 0) {
+        first = MIN(first, k);
+        last = k + 1;
+      }
+    if (first == count) // Not bound, may be read by someone else
+      continue;
+
+    for (int j = 0; j < section->var_count; j++) {
+      const fparser_var_t *var = &section->vars[j];
+
+      size_t k = first;
+      while (k < last &&
+             (strcmp(table[k].key, var->name) != 0 || strcmp(table[k].section, section->name) != 0))
+        k++;
+
+      if (k == last) {
+        if (report)
+          fprintf(report, "%s: unknown key '%s.%s'\n", fp->filename, section->name, var->name);
+        continue;
+      }
+
+      fparser_store(&table[k], obj, var->value);
+      found[k] = true;
+    }
+  }
+}
+
+// Stores the defaults of the bindings not in `found`
+// @return Number of missing required keys
+static int bind_defaults(const fparser_t *fp, const fparser_binding_t *table, size_t count,
+                         void *obj, FILE *report, const bool *found, const char *scenario) {
+  int missing = 0;
+  for (size_t k = 0; k < count; k++) {
+    if (found[k])
+      continue;
+
+    fparser_store(&table[k], obj, table[k].default_value);
+    if (!table[k].required)
+      continue;
+
+    missing++;
+    if (report && scenario)
+      fprintf(report, "%s: missing required key '%s.%s' in scenario '%s'\n", fp->filename,
+              table[k].section, table[k].key, scenario);
+    else if (report)
+      fprintf(report, "%s: missing required key '%s.%s'\n", fp->filename, table[k].section,
+              table[k].key);
+  }
+
+  return missing;
+}
+
+int fparser_bind(fparser_t *fp, const fparser_binding_t *table, size_t count, void *obj,
+                 FILE *report) {
+  if (!fp || !table || !obj)
+    return -1;
+
+  bool *found = (bool *)calloc(count ? count : 1, sizeof(bool));
+  if (!found)
+    return -1;
+
+  bind_sections(fp, table, count, obj, report, found);
+  int missing = bind_defaults(fp, table, count, obj, report, found, NULL);
+
+  free(found);
+
+  return missing;
+}
+
+fparser_deck_t fparser_deck_init(const fparser_t *fp, FILE *report) {
+  if (!fp)
+    return (fparser_deck_t){0};
+
+  fparser_deck_t deck = {0};
+  deck.fp = fp;
+  deck.scenarios[0] = (fparser_scenario_t){FPARSER_BASE_SCENARIO, -1, NULL};
+  deck.scenario_count = 1;
+
+  // Parent names are resolved after all scenarios are known, so a parent may come later
+  char parents[MAX_SECTIONS + 1][MAX_NAME] = {{0}};
+  size_t prefix = strlen(FPARSER_SCENARIO_PREFIX);
+
+  for (int i = 0; i < fp->section_count; i++) {
+    const fparser_section_t *section = &fp->sections[i];
+    if (strncmp(section->name, FPARSER_SCENARIO_PREFIX, prefix) != 0)
+      continue;
+
+    fparser_scenario_t *sc = &deck.scenarios[deck.scenario_count];
+    char *parent = parents[deck.scenario_count];
+    if (sscanf(section->name + prefix, "%63[^: ] : %63s", sc->name, parent) != 2) {
+      if (report)
+        fprintf(report, "%s: expected [%s<name> : <parent>], got [%s]\n", fp->filename,
+                FPARSER_SCENARIO_PREFIX, section->name);
+      return (fparser_deck_t){0};
+    }
+    sc->overrides = section;
+    deck.scenario_count++;
+  }
+
+  for (int i = 1; i < deck.scenario_count; i++) {
+    fparser_scenario_t *sc = &deck.scenarios[i];
+    for (int j = 0; j < i; j++)
+      if (strcmp(deck.scenarios[j].name, sc->name) == 0) {
+        if (report)
+          fprintf(report, "%s: scenario '%s' is defined twice\n", fp->filename, sc->name);
+        return (fparser_deck_t){0};
+      }
+
+    sc->parent = -1;
+    for (int j = 0; j < deck.scenario_count; j++)
+      if (j != i && strcmp(deck.scenarios[j].name, parents[i]) == 0)
+        sc->parent = j;
+
+    if (sc->parent < 0) {
+      if (report)
+        fprintf(report, "%s: unknown parent '%s' of scenario '%s'\n", fp->filename, parents[i],
+                sc->name);
+      return (fparser_deck_t){0};
+    }
+  }
+
+  // Every chain of parents must end at the base
+  for (int i = 1; i < deck.scenario_count; i++) {
+    int depth = 0, j = i;
+    while (j > 0 && depth++ < deck.scenario_count)
+      j = deck.scenarios[j].parent;
+
+    if (j != 0) {
+      if (report)
+        fprintf(report, "%s: scenario '%s' inherits from itself\n", fp->filename,
+                deck.scenarios[i].name);
+      return (fparser_deck_t){0};
+    }
+  }
+
+  return deck;
+}
+
+// Splits "section.key" of an override
+static int split_override(const char *name, char *section, char *key) {
+  const char *dot = strchr(name, '.');
+  if (!dot || dot == name || !dot[1])
+    return -1;
+
+  snprintf(section, MAX_NAME, "%.*s", (int)(dot - name), name);
+  snprintf(key, MAX_NAME, "%s", dot + 1);
+
+  return 0;
+}
+
+int fparser_deck_bind(const fparser_deck_t *deck, int scenario, const fparser_binding_t *table,
+                      size_t count, void *obj, FILE *report) {
+  if (!deck || !deck->fp || scenario < 0 || scenario >= deck->scenario_count)
+    return -1;
+
+  if (!table || !obj)
+    return -1;
+
+  bool *found = (bool *)calloc(count ? count : 1, sizeof(bool));
+  if (!found)
+    return -1;
+
+  // Unknown keys of the base are the same for every scenario, they are reported once(scenario 0)
+  bind_sections(deck->fp, table, count, obj, scenario == 0 ? report : NULL, found);
+  int errors = 0;
+
+  // Chain from the scenario up to the base
+  int chain[MAX_SECTIONS + 1], length = 0;
+  for (int i = scenario; i > 0; i = deck->scenarios[i].parent)
+    chain[length++] = i;
+
+  for (int c = length - 1; c >= 0; c--) {
+    const fparser_scenario_t *sc = &deck->scenarios[chain[c]];
+
+    for (int j = 0; j < sc->overrides->var_count; j++) {
+      const fparser_var_t *var = &sc->overrides->vars[j];
+      char section[MAX_NAME], key[MAX_NAME];
+
+      size_t k = 0;
+      if (split_override(var->name, section, key) == 0)
+        while (k < count &&
+               (strcmp(table[k].section, section) != 0 || strcmp(table[k].key, key) != 0))
+          k++;
+      else
+        k = count;
+
+      if (k == count) {
+        errors++;
+        if (report)
+          fprintf(report, "%s: unknown override '%s' in scenario '%s'\n", deck->fp->filename,
+                  var->name, sc->name);
+        continue;
+      }
+
+      fparser_store(&table[k], obj, var->value);
+      found[k] = true;
+    }
+  }
+
+  // A required key may come from the base or from any scenario of the chain
+  errors += bind_defaults(deck->fp, table, count, obj, report, found,
+                          scenario > 0 ? deck->scenarios[scenario].name : NULL);
+  free(found);
+
+  return errors;
+}
+
+fparser_var_t fparser_deck_get_var(const fparser_deck_t *deck, int scenario,
+                                   const char *section_name, const char *var_name) {
+  if (!deck || !deck->fp || scenario < 0 || scenario >= deck->scenario_count || !section_name ||
+      !var_name)
+    return (fparser_var_t){0};
+
+  char name[MAX_NAME];
+  snprintf(name, sizeof(name), "%s.%s", section_name, var_name);
+
+  for (int i = scenario; i > 0; i = deck->scenarios[i].parent) {
+    const fparser_section_t *overrides = deck->scenarios[i].overrides;
+    for (int j = 0; j < overrides->var_count; j++)
+      if (strcmp(overrides->vars[j].name, name) == 0) {
+        fparser_var_t var = overrides->vars[j];
+        snprintf(var.name, sizeof(var.name), "%s", var_name);
+        return var;
+      }
+  }
+
+  return fparser_get_var((fparser_t *)deck->fp, section_name, var_name);
+}
+
 fparser_section_t fparser_get_section(fparser_t *fp, const char *section_name) {
   if (!fp || !fp->file)
     return (fparser_section_t){0};
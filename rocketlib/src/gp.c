@@ -0,0 +1,272 @@
+#include "rocketlib/gp.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Grids of the hyperparameter search
+static const double gp_lengths[] = {0.03, 0.05, 0.08, 0.12, 0.18, 0.27, 0.4,
+                                    0.6,  0.9,  1.35, 2.0,  3.0,  4.5,  7.0};
+static const double gp_noises[] = {1e-10, 1e-8, 1e-6, 1e-4, 1e-2};
+#define GP_SWEEPS 2
+
+static double gp_kernel(const double *a, const double *b, const double *length, int dim) {
+  double r = 0;
+  for (int k = 0; k < dim; k++) {
+    double d = (a[k] - b[k]) / length[k];
+    r += d * d;
+  }
+
+  return exp(-0.5 * r);
+}
+
+// Builds K and factors it in place
+static int gp_factor(gp_t *gp) {
+  int n = gp->count;
+  double *l = gp->chol;
+
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j <= i; j++)
+      l[i * n + j] = gp_kernel(gp->x + i * gp->dim, gp->x + j * gp->dim, gp->length, gp->dim) +
+                     (i == j ? gp->noise : 0);
+
+  for (int j = 0; j < n; j++) {
+    double d = l[j * n + j];
+    for (int k = 0; k < j; k++)
+      d -= l[j * n + k] * l[j * n + k];
+    if (d <= 0)
+      return -1;
+    l[j * n + j] = sqrt(d);
+
+    for (int i = j + 1; i < n; i++) {
+      double s = l[i * n + j];
+      for (int k = 0; k < j; k++)
+        s -= l[i * n + k] * l[j * n + k];
+      l[i * n + j] = s / l[j * n + j];
+    }
+  }
+
+  return 0;
+}
+
+// Solves L L^T alpha = y
+static void gp_solve(const gp_t *gp, const double *y, double *alpha) {
+  int n = gp->count;
+  const double *l = gp->chol;
+
+  for (int i = 0; i < n; i++) {
+    double s = y[i];
+    for (int k = 0; k < i; k++)
+      s -= l[i * n + k] * alpha[k];
+    alpha[i] = s / l[i * n + i];
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    double s = alpha[i];
+    for (int k = i + 1; k < n; k++)
+      s -= l[k * n + i] * alpha[k];
+    alpha[i] = s / l[i * n + i];
+  }
+}
+
+// Log marginal likelihood of the standardized outputs, -INFINITY if K isn't positive definite
+static double gp_likelihood(gp_t *gp, const double *y) {
+  if (gp_factor(gp) != 0)
+    return -INFINITY;
+
+  gp_solve(gp, y, gp->alpha);
+
+  double fit = 0, det = 0;
+  for (int i = 0; i < gp->count; i++) {
+    fit += y[i] * gp->alpha[i];
+    det += log(gp->chol[i * gp->count + i]);
+  }
+
+  return -0.5 * fit - det;
+}
+
+int gp_fit(gp_t *gp, const double *x, const double *y, int count, int dim) {
+  if (!gp || !x || !y || count < 2 || dim <= 0 || dim > GP_MAX_DIM)
+    return -1;
+
+  *gp = (gp_t){.dim = dim, .count = count};
+  gp->x = (double *)malloc(sizeof(double) * count * dim);
+  gp->alpha = (double *)malloc(sizeof(double) * count);
+  gp->chol = (double *)malloc(sizeof(double) * count * count);
+  double *ys = (double *)malloc(sizeof(double) * count);
+  if (!gp->x || !gp->alpha || !gp->chol || !ys) {
+    free(ys);
+    gp_free(gp);
+    return -1;
+  }
+  memcpy(gp->x, x, sizeof(double) * count * dim);
+
+  for (int i = 0; i < count; i++)
+    gp->mean += y[i] / count;
+  for (int i = 0; i < count; i++)
+    gp->scale += (y[i] - gp->mean) * (y[i] - gp->mean) / (count - 1);
+  gp->scale = gp->scale > 0 ? sqrt(gp->scale) : 1;
+  for (int i = 0; i < count; i++)
+    ys[i] = (y[i] - gp->mean) / gp->scale;
+
+  // Isotropic start, then one input(and the noise) at a time
+  const int lengths = sizeof(gp_lengths) / sizeof(gp_lengths[0]);
+  const int noises = sizeof(gp_noises) / sizeof(gp_noises[0]);
+  double best = -INFINITY, best_length = gp_lengths[0];
+  gp->noise = gp_noises[1];
+  for (int g = 0; g < lengths; g++) {
+    for (int k = 0; k < dim; k++)
+      gp->length[k] = gp_lengths[g];
+    double lml = gp_likelihood(gp, ys);
+    if (lml > best) {
+      best = lml;
+      best_length = gp_lengths[g];
+    }
+  }
+  for (int k = 0; k < dim; k++)
+    gp->length[k] = best_length;
+
+  for (int sweep = 0; sweep < GP_SWEEPS; sweep++) {
+    for (int k = 0; k <= dim; k++) {
+      int options = k < dim ? lengths : noises;
+      double *param = k < dim ? &gp->length[k] : &gp->noise;
+      double chosen = *param;
+
+      for (int g = 0; g < options; g++) {
+        *param = k < dim ? gp_lengths[g] : gp_noises[g];
+        double lml = gp_likelihood(gp, ys);
+        if (lml > best) {
+          best = lml;
+          chosen = *param;
+        }
+      }
+      *param = chosen;
+    }
+  }
+
+  double lml = gp_likelihood(gp, ys); // Leaves the factor and weights of the chosen model
+  free(ys);
+  if (!isfinite(lml)) {
+    gp_free(gp);
+    return -1;
+  }
+
+  return 0;
+}
+
+void gp_free(gp_t *gp) {
+  if (!gp)
+    return;
+
+  free(gp->x);
+  free(gp->alpha);
+  free(gp->chol);
+  gp->x = gp->alpha = gp->chol = NULL;
+  gp->count = 0;
+}
+
+double gp_predict(const gp_t *gp, const double *x, double *sigma) {
+  if (!gp || !x || gp->count == 0) {
+    if (sigma)
+      *sigma = INFINITY;
+    return NAN;
+  }
+
+  int n = gp->count;
+  double *k = (double *)malloc(sizeof(double) * n);
+  if (!k) {
+    if (sigma)
+      *sigma = INFINITY;
+    return NAN;
+  }
+
+  double mean = 0;
+  for (int i = 0; i < n; i++) {
+    k[i] = gp_kernel(x, gp->x + i * gp->dim, gp->length, gp->dim);
+    mean += k[i] * gp->alpha[i];
+  }
+
+  if (sigma) {
+    // Variance = k(x, x) - v^T v with L v = k
+    double variance = 1;
+    for (int i = 0; i < n; i++) {
+      double s = k[i];
+      for (int j = 0; j < i; j++)
+        s -= gp->chol[i * n + j] * k[j];
+      k[i] = s / gp->chol[i * n + i];
+      variance -= k[i] * k[i];
+    }
+    *sigma = gp->scale * sqrt(variance > 0 ? variance : 0);
+  }
+
+  free(k);
+
+  return gp->mean + gp->scale * mean;
+}
+
+int gp_write(const gp_t *gp, FILE *file) {
+  if (!gp || !file || gp->count == 0)
+    return -1;
+
+  int n = gp->count;
+  fprintf(file, "gp %d %d\n%a %a %a\n", gp->dim, n, gp->mean, gp->scale, gp->noise);
+  for (int k = 0; k < gp->dim; k++)
+    fprintf(file, k ? " %a" : "%a", gp->length[k]);
+  fprintf(file, "\n");
+
+  for (int i = 0; i < n; i++) {
+    for (int k = 0; k < gp->dim; k++)
+      fprintf(file, "%a ", gp->x[i * gp->dim + k]);
+    fprintf(file, "%a\n", gp->alpha[i]);
+  }
+
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j <= i; j++)
+      fprintf(file, j < i ? "%a " : "%a\n", gp->chol[i * n + j]);
+
+  return ferror(file) ? -1 : 0;
+}
+
+static int read_doubles(FILE *file, double *values, int count) {
+  for (int i = 0; i < count; i++) {
+    char token[64];
+    if (fscanf(file, "%63s", token) != 1)
+      return -1;
+    values[i] = strtod(token, NULL);
+  }
+
+  return 0;
+}
+
+int gp_read(gp_t *gp, FILE *file) {
+  if (!gp || !file)
+    return -1;
+
+  int dim, n;
+  if (fscanf(file, " gp %d %d", &dim, &n) != 2 || dim <= 0 || dim > GP_MAX_DIM || n < 2)
+    return -1;
+
+  *gp = (gp_t){.dim = dim, .count = n};
+  gp->x = (double *)malloc(sizeof(double) * n * dim);
+  gp->alpha = (double *)malloc(sizeof(double) * n);
+  gp->chol = (double *)calloc((size_t)n * n, sizeof(double));
+  double header[3];
+  if (!gp->x || !gp->alpha || !gp->chol || read_doubles(file, header, 3) != 0 ||
+      read_doubles(file, gp->length, dim) != 0)
+    goto fail;
+  gp->mean = header[0];
+  gp->scale = header[1];
+  gp->noise = header[2];
+
+  for (int i = 0; i < n; i++)
+    if (read_doubles(file, gp->x + i * dim, dim) != 0 || read_doubles(file, &gp->alpha[i], 1) != 0)
+      goto fail;
+  for (int i = 0; i < n; i++)
+    if (read_doubles(file, gp->chol + i * n, i + 1) != 0)
+      goto fail;
+
+  return 0;
+
+fail:
+  gp_free(gp);
+  return -1;
+}
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include "rocketlib/logger.h"
 
 #include "rocketlib/PID.h"
@@ -7,11 +8,26 @@
 #include <stddef.h>
 
 logger_t logger_init(const char *filename) {
+  return logger_init_format(filename, LOGGER_FORMAT_CSV);
+}
+
+logger_t logger_init_format(const char *filename, logger_format_t format) {
   if (!filename)
     return (logger_t){0};
 
   logger_t l = {0};
   l.filename = filename;
+  l.format = format;
+
+  if (format == LOGGER_FORMAT_BINARY) {
+    // The header is patched on logger_free, so the file can't be opened in append mode
+    l.file = fopen(l.filename, "wb");
+    if (!l.file)
+      return (logger_t){0};
+
+    setvbuf(l.file, NULL, _IOFBF, LOGGER_BUFFER_SIZE);
+    return l;
+  }
 
   // Clear file
   l.file = fopen(l.filename, "w");
@@ -28,37 +44,231 @@ logger_t logger_init(const char *filename) {
   return l;
 }
 
+#ifdef __linux__
+logger_t logger_init_async(const char *filename, logger_format_t format, int flags) {
+  if (!filename)
+    return (logger_t){0};
+
+  logger_t l = {0};
+  l.filename = filename;
+  l.format = format;
+
+  l.writer = async_writer_open(filename, ASYNC_WRITER_BUFFER_SIZE, flags);
+  if (!l.writer)
+    return (logger_t){0};
+
+  l.file = async_writer_fopen(l.writer);
+  if (!l.file) {
+    async_writer_close(l.writer);
+    return (logger_t){0};
+  }
+
+  setvbuf(l.file, NULL, _IOFBF, LOGGER_BUFFER_SIZE);
+
+  return l;
+}
+#endif
+
 int logger_flush(logger_t *l) {
   if (!l || !l->file)
     return -1;
 
-  return fflush(l->file);
+  int result = fflush(l->file);
+#ifdef __linux__
+  if (l->writer && async_writer_flush(l->writer) != 0)
+    result = -1;
+#endif
+
+  return result;
 }
 
 int logger_free(logger_t *l) {
   if (!l || !l->file)
     return -1;
 
-  int result = fclose(l->file);
+  // Patch the final row count into the binary header, a log without it is unreadable
+  int result = 0;
+  if (l->format == LOGGER_FORMAT_BINARY && l->columns > 0) {
+    if (fseek(l->file, offsetof(logger_binary_header_t, row_count), SEEK_SET) != 0 ||
+        fwrite(&l->rows, sizeof(l->rows), 1, l->file) != 1 || fflush(l->file) != 0)
+      result = -1;
+  }
+
+  if (fclose(l->file) != 0)
+    result = -1;
   l->file = NULL;
 
+#ifdef __linux__
+  if (l->writer && async_writer_close(l->writer) != 0)
+    result = -1;
+#endif
+  l->writer = NULL;
+
   return result;
 }
 
+int logger_write_binary_header(logger_t *l, const char *columns) {
+  if (!l || !l->file || !columns || l->format != LOGGER_FORMAT_BINARY || l->columns > 0)
+    return -1;
+
+  uint32_t count = 1;
+  for (const char *c = columns; *c; c++)
+    if (*c == ',')
+      count++;
+
+  size_t names_size = strlen(columns) + 1;
+  size_t end = sizeof(logger_binary_header_t) + names_size;
+  uint64_t data_offset =
+      (end + LOGGER_BINARY_ALIGN - 1) / LOGGER_BINARY_ALIGN * LOGGER_BINARY_ALIGN;
+
+  logger_binary_header_t h = {0};
+  memcpy(h.magic, LOGGER_BINARY_MAGIC, sizeof(LOGGER_BINARY_MAGIC));
+  h.version = LOGGER_BINARY_VERSION;
+  h.column_count = count;
+  h.row_count = 0;
+  h.data_offset = data_offset;
+
+  if (fwrite(&h, sizeof(h), 1, l->file) != 1 || fwrite(columns, names_size, 1, l->file) != 1)
+    return -1;
+
+  // Pad names up to the data section
+  for (size_t i = end; i < data_offset; i++)
+    putc('\0', l->file);
+
+  l->columns = count;
+  l->rows = 0;
+
+  return 0;
+}
+
+int logger_write_binary_row(logger_t *l, const double *row) {
+  if (!l || !l->file || !row || l->format != LOGGER_FORMAT_BINARY || l->columns == 0)
+    return -1;
+
+  if (fwrite(row, sizeof(double), l->columns, l->file) != l->columns)
+    return -1;
+
+  l->rows++;
+
+  return (int)l->columns;
+}
+
+int logger_select_columns(logger_t *l, const log_column_t *table, size_t count, const char *keys) {
+  if (!l || !table || l->columns > 0)
+    return -1;
+
+  l->selected = 0;
+  if (!keys || !*keys) {
+    if (count > LOGGER_MAX_COLUMNS)
+      return -1;
+    memcpy(l->selection, table, count * sizeof(log_column_t));
+    l->selected = (uint32_t)count;
+    return 0;
+  }
+
+  const char *p = keys;
+  while (*p) {
+    const char *end = strchr(p, ',');
+    size_t len = end ? (size_t)(end - p) : strlen(p);
+
+    size_t i = 0;
+    while (i < count && !(strlen(table[i].key) == len && strncmp(table[i].key, p, len) == 0))
+      i++;
+    if (i == count || l->selected >= LOGGER_MAX_COLUMNS) {
+      l->selected = 0;
+      return -1;
+    }
+    l->selection[l->selected++] = table[i];
+
+    if (!end)
+      break;
+    p = end + 1;
+  }
+
+  return l->selected > 0 ? 0 : -1;
+}
+
+static int logger_write_header(logger_t *l) {
+  size_t size = 1;
+  for (uint32_t i = 0; i < l->selected; i++)
+    size += strlen(l->selection[i].header) + 1;
+
+  char *names = (char *)malloc(size);
+  if (!names)
+    return -1;
+
+  char *p = names;
+  for (uint32_t i = 0; i < l->selected; i++) {
+    size_t len = strlen(l->selection[i].header);
+    memcpy(p, l->selection[i].header, len);
+    p += len;
+    *p++ = ',';
+  }
+  *(p > names ? p - 1 : p) = '\0';
+
+  int result = 0;
+  if (l->format == LOGGER_FORMAT_BINARY)
+    result = logger_write_binary_header(l, names);
+  else if (fprintf(l->file, "%s\n", names) < 0)
+    result = -1;
+  else
+    l->columns = l->selected;
+
+  free(names);
+
+  return result;
+}
+
+int logger_write_selected(logger_t *l, const void *obj) {
+  if (!l || !l->file || !obj || l->selected == 0)
+    return -1;
+
+  if (l->columns == 0 && logger_write_header(l) != 0)
+    return -1;
+
+  double row[LOGGER_MAX_COLUMNS];
+  const char *base = (const char *)obj;
+  for (uint32_t i = 0; i < l->selected; i++) {
+    const log_column_t *c = &l->selection[i];
+    double value = c->type == LOG_COLUMN_FLOAT ? *(const float *)(base + c->offset)
+                                               : *(const double *)(base + c->offset);
+    row[i] = value * c->scale;
+  }
+
+  if (l->format == LOGGER_FORMAT_BINARY)
+    return logger_write_binary_row(l, row);
+
+  // Render the whole line first, so it reaches the stream with one write
+  char line[LOGGER_MAX_COLUMNS * 32];
+  size_t len = 0;
+  for (uint32_t i = 0; i < l->selected; i++) {
+    int n = snprintf(line + len, sizeof(line) - len, i ? ",%.3f" : "%.3f", row[i]);
+    if (n < 0 || (size_t)n >= sizeof(line) - len)
+      return -1;
+    len += (size_t)n;
+  }
+  line[len++] = '\n';
+
+  return fwrite(line, 1, len, l->file) == len ? (int)l->selected : -1;
+}
+
 int logger_write_rocket(logger_t *l, rocket_t *r) {
   if (!l || !l->file || !r)
     return -1;
 
-  r->d.self = r;
+  if (l->selected == 0 &&
+      logger_select_columns(l, rocket_log_columns, ROCKET_LOG_COLUMNS, NULL) != 0)
+    return -1;
 
-  return fprintln(l->file, "{}", r);
+  return logger_write_selected(l, r);
 }
 
 int logger_write_pid(logger_t *l, PID *pid) {
-  if (!l || !l->file || pid)
+  if (!l || !l->file || !pid)
     return -1;
 
-  pid->d.self = pid;
+  if (l->selected == 0 && logger_select_columns(l, pid_log_columns, PID_LOG_COLUMNS, NULL) != 0)
+    return -1;
 
-  return fprintln(l->file, "{}", pid);
+  return logger_write_selected(l, pid);
 }
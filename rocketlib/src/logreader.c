@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+#include "rocketlib/logreader.h"
+#include "rocketlib/utils.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+log_reader_t log_reader_open(const char *filename) {
+  if (!filename)
+    return (log_reader_t){0};
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return (log_reader_t){0};
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(logger_binary_header_t)) {
+    close(fd);
+    return (log_reader_t){0};
+  }
+
+  log_reader_t lr = {0};
+  lr.map_size = (size_t)st.st_size;
+  lr.map = mmap(NULL, lr.map_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // The mapping keeps the file alive
+  if (lr.map == MAP_FAILED)
+    return (log_reader_t){0};
+
+  // The data must be aligned for doubles and the names between the header and the data must end
+  // with a terminator
+  lr.header = (const logger_binary_header_t *)lr.map;
+  uint64_t offset = lr.header->data_offset;
+  if (memcmp(lr.header->magic, LOGGER_BINARY_MAGIC, sizeof(LOGGER_BINARY_MAGIC)) != 0 ||
+      lr.header->version != LOGGER_BINARY_VERSION || lr.header->column_count == 0 ||
+      offset > lr.map_size || offset <= sizeof(logger_binary_header_t) ||
+      offset % sizeof(double) != 0 ||
+      !memchr((const char *)lr.map + sizeof(logger_binary_header_t), '\0',
+              offset - sizeof(logger_binary_header_t))) {
+    munmap(lr.map, lr.map_size);
+    return (log_reader_t){0};
+  }
+
+  lr.column_names = (const char *)lr.map + sizeof(logger_binary_header_t);
+  lr.data = (const double *)((const char *)lr.map + lr.header->data_offset);
+  lr.cols = lr.header->column_count;
+
+  // A row count of 0 means the writer didn't finish, take whatever complete rows are there
+  size_t available = (lr.map_size - lr.header->data_offset) / (lr.cols * sizeof(double));
+  lr.rows = lr.header->row_count;
+  if (lr.rows == 0 || lr.rows > available)
+    lr.rows = available;
+
+  return lr;
+}
+
+int log_reader_close(log_reader_t *lr) {
+  if (!lr || !lr->map)
+    return -1;
+
+  int result = munmap(lr->map, lr->map_size);
+  *lr = (log_reader_t){0};
+
+  return result;
+}
+
+int log_reader_column_index(const log_reader_t *lr, const char *name) {
+  if (!lr || !lr->map || !name)
+    return -1;
+
+  size_t len = strlen(name);
+  const char *p = lr->column_names;
+  for (int i = 0; i < (int)lr->cols; i++) {
+    const char *end = strchr(p, ',');
+    size_t n = end ? (size_t)(end - p) : strlen(p);
+    if (n == len && strncmp(p, name, n) == 0)
+      return i;
+
+    if (!end)
+      break;
+    p = end + 1;
+  }
+
+  return -1;
+}
+
+const double *log_reader_row(const log_reader_t *lr, size_t row) {
+  if (!lr || !lr->map || row >= lr->rows)
+    return NULL;
+
+  return lr->data + row * lr->cols;
+}
+
+// First row of bucket `i` of `buckets` over the rows between the first and the last one
+static size_t bucket_start(size_t rows, size_t buckets, size_t i) {
+  return 1 + i * (rows - 2) / buckets;
+}
+
+static size_t downsample_lttb(const log_reader_t *lr, int x, int y, size_t target, size_t *rows) {
+  size_t n = lr->rows, buckets = target - 2, picked = 0, a = 0;
+  rows[picked++] = 0;
+
+  for (size_t i = 0; i < buckets; i++) {
+    size_t start = bucket_start(n, buckets, i), end = bucket_start(n, buckets, i + 1);
+    size_t next_end = i + 1 < buckets ? bucket_start(n, buckets, i + 2) : n; // Last row
+
+    // The next bucket is represented by its mean
+    double cx = 0, cy = 0;
+    for (size_t k = end; k < next_end; k++) {
+      cx += LOG_READER_AT(*lr, k, x);
+      cy += LOG_READER_AT(*lr, k, y);
+    }
+    cx /= (double)(next_end - end);
+    cy /= (double)(next_end - end);
+
+    double ax = LOG_READER_AT(*lr, a, x), ay = LOG_READER_AT(*lr, a, y), best_area = -1;
+    size_t best = start;
+    for (size_t k = start; k < end; k++) {
+      double px = LOG_READER_AT(*lr, k, x), py = LOG_READER_AT(*lr, k, y);
+      double area = fabs((ax - cx) * (py - ay) - (ax - px) * (cy - ay)); // Doubled
+      if (area > best_area) {
+        best_area = area;
+        best = k;
+      }
+    }
+    rows[picked++] = a = best;
+  }
+  rows[picked++] = n - 1;
+
+  return picked;
+}
+
+static size_t downsample_minmax(const log_reader_t *lr, int y, size_t target, size_t *rows) {
+  size_t n = lr->rows, buckets = (target - 2) / 2, picked = 0;
+  rows[picked++] = 0;
+
+  for (size_t i = 0; i < buckets; i++) {
+    size_t start = bucket_start(n, buckets, i), end = bucket_start(n, buckets, i + 1);
+    size_t lo = start, hi = start;
+    for (size_t k = start + 1; k < end; k++) {
+      double v = LOG_READER_AT(*lr, k, y);
+      if (v < LOG_READER_AT(*lr, lo, y))
+        lo = k;
+      if (v > LOG_READER_AT(*lr, hi, y))
+        hi = k;
+    }
+    rows[picked++] = MIN(lo, hi);
+    if (lo != hi)
+      rows[picked++] = MAX(lo, hi);
+  }
+  rows[picked++] = n - 1;
+
+  return picked;
+}
+
+long log_reader_downsample(const log_reader_t *lr, int x, int y, size_t target,
+                           log_downsample_t method, size_t *rows) {
+  if (!lr || !lr->map || !rows || target < 3 || x < 0 || y < 0 || (size_t)x >= lr->cols ||
+      (size_t)y >= lr->cols)
+    return -1;
+
+  if (lr->rows <= target) {
+    for (size_t i = 0; i < lr->rows; i++)
+      rows[i] = i;
+    return (long)lr->rows;
+  }
+
+  switch (method) {
+  case LOG_DOWNSAMPLE_LTTB:
+    return (long)downsample_lttb(lr, x, y, target, rows);
+  case LOG_DOWNSAMPLE_MINMAX:
+    return (long)downsample_minmax(lr, y, target, rows);
+  }
+
+  return -1;
+}
@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+#include "rocketlib/pool.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <threads.h>
+#include <unistd.h>
+
+typedef struct pool_worker_t {
+  pool_t *pool;
+  int id;
+  int cpu; // -1 if not pinned
+
+} pool_worker_t;
+
+struct pool_t {
+  thrd_t *threads;
+  pool_worker_t *workers;
+  int thread_count;
+
+  mtx_t lock;
+  cnd_t work, done;
+  unsigned long generation; // Incremented for every pool_for
+  int busy;                 // Workers still running the current loop
+  int stop;
+
+  // Current loop
+  pool_fn fn;
+  void *ctx;
+  size_t count;
+  atomic_size_t next;
+};
+
+int pool_default_threads() {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+}
+
+static int pool_worker(void *arg) {
+  pool_worker_t *w = (pool_worker_t *)arg;
+  pool_t *p = w->pool;
+  unsigned long seen = 0;
+
+  if (w->cpu >= 0)
+    topology_pin(w->cpu);
+
+  mtx_lock(&p->lock);
+  for (;;) {
+    while (!p->stop && p->generation == seen)
+      cnd_wait(&p->work, &p->lock);
+    if (p->stop)
+      break;
+    seen = p->generation;
+    mtx_unlock(&p->lock);
+
+    size_t i;
+    while ((i = atomic_fetch_add(&p->next, 1)) < p->count)
+      p->fn(p->ctx, i, w->id);
+
+    mtx_lock(&p->lock);
+    if (--p->busy == 0)
+      cnd_signal(&p->done);
+  }
+  mtx_unlock(&p->lock);
+
+  return 0;
+}
+
+pool_t *pool_create(int threads) { return pool_create_pinned(threads, NULL); }
+
+pool_t *pool_create_pinned(int threads, const topology_t *t) {
+  if (threads <= 0)
+    threads = pool_default_threads();
+
+  pool_t *p = (pool_t *)calloc(1, sizeof(pool_t));
+  if (!p)
+    return NULL;
+
+  p->threads = (thrd_t *)calloc(threads, sizeof(thrd_t));
+  p->workers = (pool_worker_t *)calloc(threads, sizeof(pool_worker_t));
+  if (!p->threads || !p->workers || mtx_init(&p->lock, mtx_plain) != thrd_success) {
+    free(p->threads);
+    free(p->workers);
+    free(p);
+    return NULL;
+  }
+  cnd_init(&p->work);
+  cnd_init(&p->done);
+  atomic_init(&p->next, 0);
+
+  for (int i = 0; i < threads; i++) {
+    int slot = topology_slot(t, i);
+    p->workers[i] = (pool_worker_t){p, i, slot >= 0 ? t->cpus[slot] : -1};
+    if (thrd_create(&p->threads[i], pool_worker, &p->workers[i]) != thrd_success)
+      break;
+    p->thread_count++;
+  }
+
+  if (p->thread_count == 0) {
+    pool_free(p);
+    return NULL;
+  }
+
+  return p;
+}
+
+int pool_free(pool_t *p) {
+  if (!p)
+    return -1;
+
+  mtx_lock(&p->lock);
+  p->stop = 1;
+  cnd_broadcast(&p->work);
+  mtx_unlock(&p->lock);
+
+  for (int i = 0; i < p->thread_count; i++)
+    thrd_join(p->threads[i], NULL);
+
+  cnd_destroy(&p->work);
+  cnd_destroy(&p->done);
+  mtx_destroy(&p->lock);
+  free(p->threads);
+  free(p->workers);
+  free(p);
+
+  return 0;
+}
+
+int pool_threads(const pool_t *p) { return p ? p->thread_count : 0; }
+
+int pool_for(pool_t *p, size_t count, pool_fn fn, void *ctx) {
+  if (!p || !fn)
+    return -1;
+  if (count == 0)
+    return 0;
+
+  mtx_lock(&p->lock);
+  p->fn = fn;
+  p->ctx = ctx;
+  p->count = count;
+  atomic_store(&p->next, 0);
+  p->busy = p->thread_count;
+  p->generation++;
+  cnd_broadcast(&p->work);
+
+  while (p->busy > 0)
+    cnd_wait(&p->done, &p->lock);
+  mtx_unlock(&p->lock);
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+#define _DEFAULT_SOURCE
+#include "rocketlib/procs.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Room for the size in front of an allocation, keeps the data aligned to a cache line
+#define PROCS_HEADER 64
+
+enum { PROCS_FREE, PROCS_CLAIMED, PROCS_DONE };
+
+typedef struct procs_control_t {
+  atomic_size_t next;
+  atomic_uchar state[]; // One per index
+
+} procs_control_t;
+
+void *procs_alloc(size_t size) {
+  void *base = mmap(NULL, size + PROCS_HEADER, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                    -1, 0);
+  if (base == MAP_FAILED)
+    return NULL;
+
+  *(size_t *)base = size + PROCS_HEADER;
+
+  return (char *)base + PROCS_HEADER;
+}
+
+void procs_free(void *ptr) {
+  if (!ptr)
+    return;
+
+  void *base = (char *)ptr - PROCS_HEADER;
+  munmap(base, *(size_t *)base);
+}
+
+_Noreturn static void procs_worker(procs_control_t *c, size_t count, pool_fn fn, void *ctx,
+                                  int worker) {
+  size_t i;
+  while ((i = atomic_fetch_add(&c->next, 1)) < count) {
+    atomic_store(&c->state[i], PROCS_CLAIMED);
+    fn(ctx, i, worker);
+    atomic_store(&c->state[i], PROCS_DONE);
+  }
+
+  fflush(NULL); // Files written by fn, e.g. shards of a shard_logger_t
+  _exit(0);
+}
+
+int procs_for(int processes, size_t count, pool_fn fn, void *ctx, const topology_t *t,
+              bool *completed) {
+  if (!fn)
+    return -1;
+  if (processes <= 0)
+    processes = pool_default_threads();
+
+  procs_control_t *c = (procs_control_t *)procs_alloc(sizeof(procs_control_t) + count);
+  pid_t *pids = (pid_t *)calloc(processes, sizeof(pid_t));
+  if (!c || !pids || !atomic_is_lock_free(&c->next)) {
+    procs_free(c);
+    free(pids);
+    return -1;
+  }
+
+  fflush(NULL); // Otherwise every worker would write the buffered output again
+
+  int started = 0;
+  for (; started < processes; started++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      int slot = topology_slot(t, started);
+      if (slot >= 0)
+        topology_pin(t->cpus[slot]);
+      procs_worker(c, count, fn, ctx, started);
+    }
+    if (pid < 0)
+      break; // The started workers take over the whole range
+    pids[started] = pid;
+  }
+
+  for (int k = 0; k < started; k++)
+    while (waitpid(pids[k], NULL, 0) < 0 && errno == EINTR)
+      ;
+
+  int result = started > 0 ? 0 : -1;
+  for (size_t i = 0; i < count; i++) {
+    bool done = atomic_load(&c->state[i]) == PROCS_DONE;
+    if (completed)
+      completed[i] = done;
+    if (!done)
+      result = -1;
+  }
+
+  procs_free(c);
+  free(pids);
+
+  return result;
+}
+
+#else
+
+// Without fork and shared mappings there are no worker processes, callers use a pool_t
+void *procs_alloc(size_t size) {
+  (void)size;
+  return NULL;
+}
+
+void procs_free(void *ptr) { (void)ptr; }
+
+int procs_for(int processes, size_t count, pool_fn fn, void *ctx, const topology_t *t,
+              bool *completed) {
+  (void)processes;
+  (void)count;
+  (void)fn;
+  (void)ctx;
+  (void)t;
+  (void)completed;
+  return -1;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "rocketlib/reduce.h"
+#include "rocketlib/utils.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Largest REDUCE_LEAF * 2^k (or 2^k with leaf == 1) below count, count > leaf
+static size_t reduce_split(size_t count, size_t leaf) {
+  size_t m = leaf;
+  while (m * 2 < count)
+    m *= 2;
+
+  return m;
+}
+
+// Sum of values, or of squared deviations from `mean`, along the fixed tree
+static double pairwise(const double *values, size_t count, double mean, bool squares) {
+  if (count <= REDUCE_LEAF) {
+    double sum = 0;
+    for (size_t i = 0; i < count; i++) {
+      double d = values[i] - mean;
+      sum += squares ? d * d : values[i];
+    }
+    return sum;
+  }
+
+  size_t m = reduce_split(count, REDUCE_LEAF);
+  return pairwise(values, m, mean, squares) + pairwise(values + m, count - m, mean, squares);
+}
+
+// Adds the sums of whole chunks along the upper part of the same tree
+static double pairwise_chunks(const double *sums, size_t count) {
+  if (count == 1)
+    return sums[0];
+
+  size_t m = reduce_split(count, 1);
+  return pairwise_chunks(sums, m) + pairwise_chunks(sums + m, count - m);
+}
+
+double reduce_sum(const double *values, size_t count) {
+  return values && count ? pairwise(values, count, 0, false) : 0;
+}
+
+double reduce_mean(const double *values, size_t count) {
+  return values && count ? reduce_sum(values, count) / count : 0;
+}
+
+double reduce_variance(const double *values, size_t count, double mean) {
+  return values && count > 1 ? pairwise(values, count, mean, true) / (count - 1) : 0;
+}
+
+typedef struct reduce_job_t {
+  const double *values;
+  size_t count;
+  double mean;
+  bool squares;
+  double *sums; // One per chunk
+
+} reduce_job_t;
+
+static void reduce_chunk(void *ctx, size_t i, int worker) {
+  (void)worker;
+  reduce_job_t *job = (reduce_job_t *)ctx;
+  size_t first = i * REDUCE_CHUNK;
+  size_t count = MIN(REDUCE_CHUNK, job->count - first);
+
+  job->sums[i] = pairwise(job->values + first, count, job->mean, job->squares);
+}
+
+static double reduce_pool(pool_t *p, const double *values, size_t count, double mean,
+                          bool squares) {
+  size_t chunks = (count + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+  if (!p || chunks < 2) // A single subtree, nothing to share
+    return pairwise(values, count, mean, squares);
+
+  double *sums = (double *)malloc(chunks * sizeof(double));
+  if (!sums)
+    return NAN;
+
+  reduce_job_t job = {values, count, mean, squares, sums};
+  double result = pool_for(p, chunks, reduce_chunk, &job) == 0 ? pairwise_chunks(sums, chunks)
+                                                                : NAN;
+  free(sums);
+
+  return result;
+}
+
+double reduce_sum_pool(pool_t *p, const double *values, size_t count) {
+  return values && count ? reduce_pool(p, values, count, 0, false) : 0;
+}
+
+double reduce_variance_pool(pool_t *p, const double *values, size_t count, double mean) {
+  return values && count > 1 ? reduce_pool(p, values, count, mean, true) / (count - 1) : 0;
+}
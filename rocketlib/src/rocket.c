@@ -1,5 +1,23 @@
 #include "rocketlib/rocket.h"
 
+#include <stddef.h>
+
+const log_column_t rocket_log_columns[ROCKET_LOG_COLUMNS] = {
+    {"time", "time(s)", offsetof(rocket_t, time), LOG_COLUMN_DOUBLE, 1},
+    {"dry_mass", "dry_mass(kg)", offsetof(rocket_t, dry_mass), LOG_COLUMN_DOUBLE, 1},
+    {"fuel_mass", "fuel_mass(kg)", offsetof(rocket_t, fuel_mass), LOG_COLUMN_DOUBLE, 1},
+    {"acc_x", "accOx(m/s^2)", offsetof(rocket_t, acc.x), LOG_COLUMN_DOUBLE, 1},
+    {"acc_y", "accOy(m/s^2)", offsetof(rocket_t, acc.y), LOG_COLUMN_DOUBLE, 1},
+    {"acc_z", "accOz(m/s^2)", offsetof(rocket_t, acc.z), LOG_COLUMN_DOUBLE, 1},
+    {"velocity_x", "velocityOx(m/s)", offsetof(rocket_t, velocity.x), LOG_COLUMN_DOUBLE, 1},
+    {"velocity_y", "velocityOy(m/s)", offsetof(rocket_t, velocity.y), LOG_COLUMN_DOUBLE, 1},
+    {"velocity_z", "velocityOz(m/s)", offsetof(rocket_t, velocity.z), LOG_COLUMN_DOUBLE, 1},
+    {"coord_x", "CoordinateOx(m)", offsetof(rocket_t, coords.x), LOG_COLUMN_DOUBLE, 1},
+    {"coord_y", "CoordinateOy(m)", offsetof(rocket_t, coords.y), LOG_COLUMN_DOUBLE, 1},
+    {"altitude", "CoordinateOz(m)", offsetof(rocket_t, coords.z), LOG_COLUMN_DOUBLE, 1},
+    {"thrust", "thrust_percent(%)", offsetof(rocket_t, thrust_percent), LOG_COLUMN_FLOAT, 100},
+};
+
 int display_rocket(const void *self) {
   if (!self)
     return -1;
@@ -46,4 +64,20 @@ int sndisplay_rocket(const void *self, char *buff, size_t size) {
       r->time, r->dry_mass, r->fuel_mass, r->acc.x, r->acc.y, r->acc.z,
       r->velocity.x, r->velocity.y, r->velocity.z, r->coords.x, r->coords.y,
       r->coords.z, r->thrust_percent * 100);
-}
\ No newline at end of file
+}
+
+void rocket_log_row(const rocket_t *r, double row[ROCKET_LOG_COLUMNS]) {
+  row[0] = r->time;
+  row[1] = r->dry_mass;
+  row[2] = r->fuel_mass;
+  row[3] = r->acc.x;
+  row[4] = r->acc.y;
+  row[5] = r->acc.z;
+  row[6] = r->velocity.x;
+  row[7] = r->velocity.y;
+  row[8] = r->velocity.z;
+  row[9] = r->coords.x;
+  row[10] = r->coords.y;
+  row[11] = r->coords.z;
+  row[12] = r->thrust_percent * 100;
+}
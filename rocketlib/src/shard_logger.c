@@ -0,0 +1,201 @@
+#include "rocketlib/shard_logger.h"
+
+#include "rocketlib/rocket.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct shard_record_header_t {
+  uint64_t scenario;
+  double time;
+
+} shard_record_header_t;
+
+// Position of a shard during the merge
+typedef struct shard_cursor_t {
+  FILE *file;
+  shard_record_header_t h;
+  double *values;
+  int shard;
+
+} shard_cursor_t;
+
+shard_logger_t shard_logger_init(int shards, const char *columns) {
+  if (shards <= 0 || !columns)
+    return (shard_logger_t){0};
+
+  shard_logger_t sl = {0};
+  sl.columns = columns;
+  sl.column_count = 1;
+  for (const char *c = columns; *c; c++)
+    if (*c == ',')
+      sl.column_count++;
+
+  sl.shards = (FILE **)calloc(shards, sizeof(FILE *));
+  if (!sl.shards)
+    return (shard_logger_t){0};
+  sl.shard_count = shards;
+
+  for (int i = 0; i < shards; i++) {
+    sl.shards[i] = tmpfile();
+    if (!sl.shards[i]) {
+      shard_logger_free(&sl);
+      return (shard_logger_t){0};
+    }
+    setvbuf(sl.shards[i], NULL, _IOFBF, LOGGER_BUFFER_SIZE);
+  }
+
+  return sl;
+}
+
+int shard_logger_free(shard_logger_t *sl) {
+  if (!sl || !sl->shards)
+    return -1;
+
+  int result = 0;
+  for (int i = 0; i < sl->shard_count; i++)
+    if (sl->shards[i] && fclose(sl->shards[i]) != 0)
+      result = -1;
+
+  free(sl->shards);
+  *sl = (shard_logger_t){0};
+
+  return result;
+}
+
+int shard_logger_write(shard_logger_t *sl, int shard, uint64_t scenario, double time,
+                       const double *values) {
+  if (!sl || !sl->shards || shard < 0 || shard >= sl->shard_count || !values)
+    return -1;
+
+  shard_record_header_t h = {scenario, time};
+  FILE *file = sl->shards[shard];
+  if (fwrite(&h, sizeof(h), 1, file) != 1 ||
+      fwrite(values, sizeof(double), sl->column_count, file) != sl->column_count)
+    return -1;
+
+  return 0;
+}
+
+int shard_logger_write_rocket(shard_logger_t *sl, int shard, uint64_t scenario, rocket_t *r) {
+  if (!r || !sl || sl->column_count != ROCKET_LOG_COLUMNS)
+    return -1;
+
+  double row[ROCKET_LOG_COLUMNS];
+  rocket_log_row(r, row);
+
+  return shard_logger_write(sl, shard, scenario, r->time, row);
+}
+
+static int cursor_next(shard_cursor_t *c, uint32_t columns) {
+  return fread(&c->h, sizeof(c->h), 1, c->file) == 1 &&
+         fread(c->values, sizeof(double), columns, c->file) == columns;
+}
+
+static int cursor_less(const shard_cursor_t *a, const shard_cursor_t *b) {
+  if (a->h.scenario != b->h.scenario)
+    return a->h.scenario < b->h.scenario;
+  if (a->h.time != b->h.time)
+    return a->h.time < b->h.time;
+
+  return a->shard < b->shard;
+}
+
+static void heap_sift_down(shard_cursor_t **heap, int size, int i) {
+  for (;;) {
+    int smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+    if (l < size && cursor_less(heap[l], heap[smallest]))
+      smallest = l;
+    if (r < size && cursor_less(heap[r], heap[smallest]))
+      smallest = r;
+    if (smallest == i)
+      return;
+
+    shard_cursor_t *tmp = heap[i];
+    heap[i] = heap[smallest];
+    heap[smallest] = tmp;
+    i = smallest;
+  }
+}
+
+static int write_merged(logger_t *out, const shard_cursor_t *c, uint32_t columns, double *row) {
+  if (out->format == LOGGER_FORMAT_BINARY) {
+    row[0] = (double)c->h.scenario;
+    memcpy(row + 1, c->values, sizeof(double) * columns);
+    return logger_write_binary_row(out, row);
+  }
+
+  if (fprintf(out->file, "%llu", (unsigned long long)c->h.scenario) < 0)
+    return -1;
+  for (uint32_t i = 0; i < columns; i++)
+    if (fprintf(out->file, ",%.3f", c->values[i]) < 0)
+      return -1;
+
+  return putc('\n', out->file) == EOF ? -1 : 0;
+}
+
+long shard_logger_merge(shard_logger_t *sl, logger_t *out) {
+  if (!sl || !sl->shards || !out || !out->file)
+    return -1;
+
+  uint32_t columns = sl->column_count;
+  shard_cursor_t *cursors = (shard_cursor_t *)calloc(sl->shard_count, sizeof(shard_cursor_t));
+  shard_cursor_t **heap = (shard_cursor_t **)calloc(sl->shard_count, sizeof(shard_cursor_t *));
+  double *values = (double *)malloc(sizeof(double) * ((size_t)columns * (sl->shard_count + 1) + 1));
+  if (!cursors || !heap || !values) {
+    free(cursors);
+    free(heap);
+    free(values);
+    return -1;
+  }
+
+  // The merged output gets a leading scenario column
+  size_t names_size = strlen("scenario,") + strlen(sl->columns) + 1;
+  char *names = (char *)malloc(names_size);
+  if (names)
+    snprintf(names, names_size, "scenario,%s", sl->columns);
+
+  long merged = -1;
+  double *row = values + (size_t)columns * sl->shard_count;
+  int size = 0;
+
+  if (!names)
+    goto cleanup;
+  if (out->format == LOGGER_FORMAT_BINARY) {
+    if (logger_write_binary_header(out, names) != 0)
+      goto cleanup;
+  } else if (fprintf(out->file, "%s\n", names) < 0)
+    goto cleanup;
+
+  for (int i = 0; i < sl->shard_count; i++) {
+    fflush(sl->shards[i]);
+    rewind(sl->shards[i]);
+
+    cursors[i] = (shard_cursor_t){sl->shards[i], {0, 0}, values + (size_t)columns * i, i};
+    if (cursor_next(&cursors[i], columns))
+      heap[size++] = &cursors[i];
+  }
+  for (int i = size / 2 - 1; i >= 0; i--)
+    heap_sift_down(heap, size, i);
+
+  merged = 0;
+  while (size > 0) {
+    if (write_merged(out, heap[0], columns, row) < 0) {
+      merged = -1;
+      break;
+    }
+    merged++;
+
+    if (!cursor_next(heap[0], columns))
+      heap[0] = heap[--size];
+    heap_sift_down(heap, size, 0);
+  }
+
+cleanup:
+  free(names);
+  free(cursors);
+  free(heap);
+  free(values);
+
+  return merged;
+}
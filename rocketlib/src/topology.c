@@ -0,0 +1,162 @@
+#define _GNU_SOURCE
+#include "rocketlib/topology.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sched.h>
+
+#define TOPOLOGY_PATH 128
+
+// Reads a list like "0-3,8-11" from `path` into the set
+static int read_cpulist(const char *path, cpu_set_t *set) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return -1;
+
+  char line[4096];
+  char *ok = fgets(line, sizeof(line), f);
+  fclose(f);
+  if (!ok)
+    return -1;
+
+  CPU_ZERO(set);
+  for (char *s = line; *s && *s != '\n';) {
+    char *end;
+    long first = strtol(s, &end, 10), last = first;
+    if (end == s)
+      return -1;
+    if (*end == '-')
+      last = strtol(end + 1, &end, 10);
+    for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+      CPU_SET(cpu, set);
+    s = *end == ',' ? end + 1 : end;
+  }
+
+  return 0;
+}
+
+typedef struct topology_cpu_t {
+  int cpu, node;
+  int sibling; // Position among the hyperthreads of its core
+  int rank;    // Position among the CPUs of its node with the same sibling
+
+} topology_cpu_t;
+
+static int topology_cmp(const void *a, const void *b) {
+  const topology_cpu_t *x = (const topology_cpu_t *)a, *y = (const topology_cpu_t *)b;
+  if (x->sibling != y->sibling)
+    return x->sibling - y->sibling;
+  if (x->rank != y->rank)
+    return x->rank - y->rank;
+
+  return x->node - y->node;
+}
+
+topology_t topology_detect() {
+  topology_t t = {0};
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return t;
+
+  int count = CPU_COUNT(&allowed);
+  topology_cpu_t *cpus = (topology_cpu_t *)calloc(count, sizeof(topology_cpu_t));
+  t.cpus = (int *)malloc(count * sizeof(int));
+  t.nodes = (int *)malloc(count * sizeof(int));
+  if (!cpus || !t.cpus || !t.nodes) {
+    free(cpus);
+    topology_free(&t);
+    return t;
+  }
+
+  char path[TOPOLOGY_PATH];
+  cpu_set_t set;
+  for (int cpu = 0, k = 0; cpu < CPU_SETSIZE && k < count; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed))
+      continue;
+
+    topology_cpu_t *c = &cpus[k++];
+    c->cpu = cpu;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list",
+             cpu);
+    if (read_cpulist(path, &set) == 0)
+      for (int s = 0; s < cpu; s++)
+        c->sibling += CPU_ISSET(s, &set) != 0;
+  }
+
+  // Nodes are numbered densely, but may have gaps(offline or memory-only nodes)
+  for (int node = 0, missing = 0; missing < 64; node++) {
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if (read_cpulist(path, &set) != 0) {
+      missing++;
+      continue;
+    }
+    for (int k = 0; k < count; k++)
+      if (CPU_ISSET(cpus[k].cpu, &set))
+        cpus[k].node = node;
+    t.node_count = node + 1;
+  }
+  if (t.node_count == 0)
+    t.node_count = 1;
+
+  for (int k = 0; k < count; k++)
+    for (int j = 0; j < k; j++)
+      cpus[k].rank += cpus[j].node == cpus[k].node && cpus[j].sibling == cpus[k].sibling;
+
+  qsort(cpus, count, sizeof(topology_cpu_t), topology_cmp);
+  for (int k = 0; k < count; k++) {
+    t.cpus[k] = cpus[k].cpu;
+    t.nodes[k] = cpus[k].node;
+  }
+  t.cpu_count = count;
+  free(cpus);
+
+  return t;
+}
+
+#else
+
+// Without sched_getaffinity and sysfs there is no placement, the workers run unpinned
+topology_t topology_detect() { return (topology_t){0}; }
+
+#endif // __linux__
+
+void topology_free(topology_t *t) {
+  if (!t)
+    return;
+
+  free(t->cpus);
+  free(t->nodes);
+  *t = (topology_t){0};
+}
+
+int topology_slot(const topology_t *t, int worker) {
+  return t && t->cpu_count > 0 && worker >= 0 ? worker % t->cpu_count : -1;
+}
+
+int topology_pin(int cpu) {
+#ifdef __linux__
+  if (cpu < 0 || cpu >= CPU_SETSIZE)
+    return -1;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  return sched_setaffinity(0, sizeof(set), &set) == 0 ? 0 : -1;
+#else
+  (void)cpu;
+  return -1;
+#endif
+}
+
+void topology_print(const topology_t *t, FILE *out) {
+  if (!t || !out)
+    return;
+
+  fprintf(out, "%d CPUs on %d NUMA node(s), placement order:", t->cpu_count, t->node_count);
+  for (int k = 0; k < t->cpu_count; k++)
+    fprintf(out, " %d(node %d)", t->cpus[k], t->nodes[k]);
+  fprintf(out, "\n");
+}
@@ -0,0 +1,178 @@
+#include "rocketlib/trajectory.h"
+#include "rocketlib/rocket.h"
+
+#include <stdlib.h>
+
+// Continuous extensions of the supported methods: coefficient j of the step polynomial is
+// sum(weights[j][i] * k_i) over the stage derivatives k_i
+static const double euler_weights[3][TRAJECTORY_MAX_STAGES] = {{1}, {0}, {0}};
+static const double midpoint_weights[3][TRAJECTORY_MAX_STAGES] = {{1, 0}, {-1, 1}, {0, 0}};
+static const double rk4_weights[3][TRAJECTORY_MAX_STAGES] = {
+    {1, 0, 0, 0},
+    {-1.5, 1, 1, -0.5},
+    {2.0 / 3, -2.0 / 3, -2.0 / 3, 2.0 / 3},
+};
+
+static vec3_t combine(const double *weights, const vec3_t *k, int stages) {
+  vec3_t sum = VEC3_ZERO;
+  for (int i = 0; i < stages; i++) {
+    sum.x += weights[i] * k[i].x;
+    sum.y += weights[i] * k[i].y;
+    sum.z += weights[i] * k[i].z;
+  }
+
+  return sum;
+}
+
+trajectory_t trajectory_init() { return (trajectory_t){.uniform = true}; }
+
+void trajectory_free(trajectory_t *tr) {
+  if (!tr)
+    return;
+
+  free(tr->steps);
+  *tr = trajectory_init();
+}
+
+int trajectory_push(trajectory_t *tr, const rocket_t *start, double dt, const vec3_t *v,
+                    const vec3_t *a, int stages) {
+  switch (stages) {
+  case 1:
+    return trajectory_push_dense(tr, start, dt, v, a, stages, euler_weights);
+  case 2:
+    return trajectory_push_dense(tr, start, dt, v, a, stages, midpoint_weights);
+  case 4:
+    return trajectory_push_dense(tr, start, dt, v, a, stages, rk4_weights);
+  default:
+    return -1;
+  }
+}
+
+int trajectory_push_dense(trajectory_t *tr, const rocket_t *start, double dt, const vec3_t *v,
+                          const vec3_t *a, int stages,
+                          const double weights[3][TRAJECTORY_MAX_STAGES]) {
+  if (!tr || !start || !v || !a || !weights || dt <= 0 || stages <= 0 ||
+      stages > TRAJECTORY_MAX_STAGES)
+    return -1;
+
+  if (tr->count == tr->capacity) {
+    size_t capacity = tr->capacity ? tr->capacity * 2 : 1024;
+    trajectory_step_t *steps =
+        (trajectory_step_t *)realloc(tr->steps, capacity * sizeof(trajectory_step_t));
+    if (!steps)
+      return -1;
+    tr->steps = steps;
+    tr->capacity = capacity;
+  }
+
+  trajectory_step_t *s = &tr->steps[tr->count];
+  s->time = start->time;
+  s->dt = dt;
+  s->coords = start->coords;
+  s->velocity = start->velocity;
+  for (int j = 0; j < 3; j++) {
+    s->dx[j] = combine(weights[j], v, stages);
+    s->dv[j] = combine(weights[j], a, stages);
+  }
+  s->fuel_mass = start->fuel_mass;
+  s->fuel_rate = start->engine.consumption * start->thrust_percent;
+  s->thrust_percent = start->thrust_percent;
+
+  tr->uniform = tr->uniform && (tr->count == 0 || dt == tr->steps[0].dt);
+  tr->end = start->time + dt;
+  tr->count++;
+
+  return 0;
+}
+
+int trajectory_truncate(trajectory_t *tr, double time) {
+  if (!tr || tr->count == 0 || time < tr->steps[tr->count - 1].time)
+    return -1;
+
+  tr->end = time;
+
+  return 0;
+}
+
+double trajectory_start(const trajectory_t *tr) {
+  return tr && tr->count ? tr->steps[0].time : 0;
+}
+
+// Index of the step containing `time`, which must be inside the trajectory
+static size_t trajectory_find(const trajectory_t *tr, double time) {
+  const trajectory_step_t *steps = tr->steps;
+
+  if (tr->uniform) {
+    size_t i = (size_t)((time - steps[0].time) / steps[0].dt);
+    if (i >= tr->count)
+      i = tr->count - 1;
+
+    // Step times are accumulated, so the guess can be one step off
+    while (i > 0 && time < steps[i].time)
+      i--;
+    while (i + 1 < tr->count && time >= steps[i + 1].time)
+      i++;
+
+    return i;
+  }
+
+  size_t lo = 0, hi = tr->count; // Last step with steps[i].time <= time
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (steps[mid].time <= time)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+int trajectory_at(const trajectory_t *tr, double time, rocket_t *r) {
+  if (!tr || !r || tr->count == 0 || time < tr->steps[0].time || time > tr->end)
+    return -1;
+
+  const trajectory_step_t *s = &tr->steps[trajectory_find(tr, time)];
+  double theta = (time - s->time) / s->dt;
+  double p1 = s->dt * theta, p2 = p1 * theta, p3 = p2 * theta;
+  double d1 = 1, d2 = 2 * theta, d3 = 3 * theta * theta;
+
+  r->time = time;
+  r->coords.x = s->coords.x + p1 * s->dx[0].x + p2 * s->dx[1].x + p3 * s->dx[2].x;
+  r->coords.y = s->coords.y + p1 * s->dx[0].y + p2 * s->dx[1].y + p3 * s->dx[2].y;
+  r->coords.z = s->coords.z + p1 * s->dx[0].z + p2 * s->dx[1].z + p3 * s->dx[2].z;
+  r->velocity.x = s->velocity.x + p1 * s->dv[0].x + p2 * s->dv[1].x + p3 * s->dv[2].x;
+  r->velocity.y = s->velocity.y + p1 * s->dv[0].y + p2 * s->dv[1].y + p3 * s->dv[2].y;
+  r->velocity.z = s->velocity.z + p1 * s->dv[0].z + p2 * s->dv[1].z + p3 * s->dv[2].z;
+  r->acc.x = d1 * s->dv[0].x + d2 * s->dv[1].x + d3 * s->dv[2].x;
+  r->acc.y = d1 * s->dv[0].y + d2 * s->dv[1].y + d3 * s->dv[2].y;
+  r->acc.z = d1 * s->dv[0].z + d2 * s->dv[1].z + d3 * s->dv[2].z;
+  r->fuel_mass = MAX(0, s->fuel_mass - s->fuel_rate * (time - s->time));
+  r->thrust_percent = s->thrust_percent;
+
+  return 0;
+}
+
+long trajectory_resample(const trajectory_t *tr, const rocket_t *r, double step, logger_t *l) {
+  if (!tr || !r || !l || step <= 0 || tr->count == 0)
+    return -1;
+
+  rocket_t sample = *r;
+  double start = trajectory_start(tr);
+  long written = 0;
+
+  // Times are start + k * step, so rounding errors don't pile up over a long flight
+  for (long k = 0;; k++) {
+    double time = start + k * step;
+    if (time >= tr->end - step * 1e-9)
+      break;
+    if (trajectory_at(tr, time, &sample) != 0 || logger_write_rocket(l, &sample) < 0)
+      return -1;
+    written++;
+  }
+
+  if (trajectory_at(tr, tr->end, &sample) != 0 || logger_write_rocket(l, &sample) < 0)
+    return -1;
+
+  return written + 1;
+}
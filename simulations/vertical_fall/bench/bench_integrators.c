@@ -0,0 +1,342 @@
+#define _POSIX_C_SOURCE 200809L
+#define DISPLAY_IMPLEMENTATION
+#define DISPLAY_STRIP_PREFIX
+#include "common.h"
+
+/// Work-precision benchmark of the integrators on the vertical fall scenario.
+/// The rocket falls freely, ignites at a fixed time and burns until it reaches the ground.
+/// Every integrator is run over a sweep of dt and its landing state is compared with a
+/// reference run of rk4 with a very small step. The adaptive methods are run over a sweep of
+/// tolerances instead. The wall time is the median of several samples, see bench.h for the
+/// baseline flags
+
+typedef void (*integrator_fn)(simulator_t *, vec3_t, vec3_t(calculate_forces)(const void *));
+
+typedef struct integrator_entry_t {
+  const char *name;
+  integrator_fn fn;
+  bool adaptive;
+
+} integrator_entry_t;
+
+#define RK_ENTRY(name, adaptive) {#name, update_status_##name, adaptive},
+static const integrator_entry_t integrators[] = {
+    {"rk1", update_status_rk1, false},
+    RK_METHODS(RK_ENTRY)
+};
+#undef RK_ENTRY
+
+typedef struct run_t {
+  double time, velocity, fuel_mass; // Landing state
+  long steps, force_evals;
+
+} run_t;
+
+static long force_evals = 0;
+
+static vec3_t counted_forces(const void *r) {
+  force_evals++;
+  return calculate_forces(r);
+}
+
+static void step(rocket_t *r, integrator_fn fn, double dt) {
+  simulator_t scene = {.dt = dt, .object = r, .integrator = fn};
+  fn(&scene, (vec3_t){0, 0, _M_PI_2_}, counted_forces);
+}
+
+/// @brief Finds the landing state by re-integrating the last step with a shorter dt (secant
+/// method on the altitude), so the result isn't limited by linear event interpolation
+static rocket_t land(const rocket_t *prev, const rocket_t *cur, integrator_fn fn, double dt) {
+  double h0 = 0, z0 = prev->coords.z, h1 = dt, z1 = cur->coords.z;
+  rocket_t r = *cur;
+
+  for (int i = 0; i < 50 && fabs(z1) > 1e-10 && z1 != z0; i++) {
+    double h = h1 - z1 * (h1 - h0) / (z1 - z0);
+    r = *prev;
+    step(&r, fn, h);
+
+    h0 = h1;
+    z0 = z1;
+    h1 = h;
+    z1 = r.coords.z;
+  }
+
+  return r;
+}
+
+/// @brief Simulates one landing
+/// @param ignition_steps Number of steps before the engine is ignited, so the ignition
+/// always falls on a step boundary
+/// @return Landing state, time is NAN if the rocket didn't reach the ground
+static run_t simulate(const rocket_t *initial, integrator_fn fn, double dt, long ignition_steps) {
+  rocket_t r = *initial, prev;
+  run_t run = {0};
+  long start_evals = force_evals;
+
+  while (r.coords.z > 0) {
+    if (run.steps == ignition_steps && r.fuel_mass > 0)
+      CHANGE_THRUST(r, 1);
+
+    prev = r;
+    step(&r, fn, dt);
+    run.steps++;
+
+    if (r.velocity.z > 0 || run.steps > 100000000L) {
+      run.time = NAN;
+      return run;
+    }
+  }
+
+  r = land(&prev, &r, fn, dt);
+
+  run.time = r.time;
+  run.velocity = r.velocity.z;
+  run.fuel_mass = r.fuel_mass;
+  run.force_evals = force_evals - start_evals;
+
+  return run;
+}
+
+/// @brief Simulates one landing with an adaptive integrator. Steps are cut short at the
+/// ignition time, so the engine ignites exactly on time
+/// A step which jumps over the whole end of the braking(the velocity turns upwards) is taken
+/// again with half the length
+/// @return Landing state, time is NAN if the rocket didn't reach the ground
+static run_t simulate_adaptive(const rocket_t *initial, integrator_fn fn, double tolerance,
+                               double ignition) {
+  rocket_t r = *initial, prev;
+  simulator_t scene = {.dt = 1e-3, .object = &r, .integrator = fn, .tolerance = tolerance};
+  run_t run = {0};
+  long start_evals = force_evals;
+
+  while (r.coords.z > 0) {
+    if (r.thrust_percent == 0 && r.fuel_mass > 0 && ignition - r.time <= 1e-12 * ignition)
+      CHANGE_THRUST(r, 1);
+    if (r.thrust_percent == 0)
+      scene.dt = MIN(scene.dt, ignition - r.time);
+
+    prev = r;
+    fn(&scene, (vec3_t){0, 0, _M_PI_2_}, counted_forces);
+    run.steps++;
+
+    if (r.velocity.z > 0 && scene.dt > 1e-9) {
+      r = prev;
+      scene.dt /= 2;
+      continue;
+    }
+    scene.dt = scene.next_dt;
+
+    if (r.velocity.z > 0 || run.steps > 100000000L) {
+      run.time = NAN;
+      return run;
+    }
+  }
+
+  r = land(&prev, &r, fn, r.time - prev.time);
+
+  run.time = r.time;
+  run.velocity = r.velocity.z;
+  run.fuel_mass = r.fuel_mass;
+  run.force_evals = force_evals - start_evals;
+
+  return run;
+}
+
+/// @brief Ignition time estimated from the braking distance with a constant mass
+static double ignition_estimate(const rocket_t *r, double mass) {
+  double g = calculate_g(*r), a = r->engine.thrust / mass - g;
+
+  return sqrt(2 * r->coords.z * a / (a + g) / g);
+}
+
+/// @brief Bisects the ignition time which lands the rocket at `speed`. With the full mass the
+/// braking is underestimated(the rocket stops above the ground), with the dry mass it's
+/// overestimated(the rocket crashes)
+static double default_ignition(const rocket_t *r, double speed) {
+  double left = ignition_estimate(r, FULL_MASS(*r)), right = ignition_estimate(r, r->dry_mass);
+
+  for (int i = 0; i < 60; i++) {
+    double mid = (left + right) / 2;
+    run_t run = simulate(r, update_status_rk4, 1e-3, lround(mid / 1e-3));
+    if (isnan(run.time) || -run.velocity < speed)
+      left = mid;
+    else
+      right = mid;
+  }
+
+  return right;
+}
+
+void usage() {
+  puts("OPTIONS:\n"
+       "--rocket <file>\t\tSpecify file with simulation parameters\n"
+       "--ignition <number>\tTime to ignite the engine(default lands at 10 m/s)\n"
+       "--dt-max <number>\tLargest dt of the sweep(default is 1e-1)\n"
+       "--dt-min <number>\tSmallest dt of the sweep(default is 1e-4)\n"
+       "--reference-dt <number>\tdt of the rk4 reference run(default is dt-min / 16)\n"
+       "--tol-max <number>\tLargest tolerance of the adaptive methods(default is 1e-3)\n"
+       "--tol-min <number>\tSmallest tolerance of the adaptive methods(default is 1e-10)\n"
+       "--repeats <number>\tTiming samples of every run(default is 5)\n"
+       "--baseline <file>\tWrite the timings to a JSON baseline\n"
+       "--compare <file>\tCompare the timings with a JSON baseline\n"
+       "--threshold <number>\tRegression threshold in percent(default is 5)\n"
+       "-h\t\t\tPrint this help message");
+}
+
+int main(int argc, char *argv[]) {
+  double ignition = 0, dt_max = 1e-1, dt_min = 1e-4, dt_ref = 0, tol_max = 1e-3,
+         tol_min = 1e-10;
+  char *rocket_file = "rocket.dat";
+  bench_t b = bench_init();
+  int handled;
+
+  for (int i = 1; i < argc; i++) {
+    char *token = argv[i];
+    if ((handled = bench_parse_flag(&b, argc, argv, &i)) != 0) {
+      if (handled < 0)
+        return -1;
+    } else if (strcmp(token, "-h") == 0) {
+      usage();
+      return 0;
+    } else if (strcmp(token, "--rocket") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      rocket_file = argv[++i];
+    } else if (strcmp(token, "--ignition") == 0 || strcmp(token, "--dt-max") == 0 ||
+               strcmp(token, "--dt-min") == 0 || strcmp(token, "--reference-dt") == 0 ||
+               strcmp(token, "--tol-max") == 0 || strcmp(token, "--tol-min") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      double value = atof(argv[++i]);
+      if (value <= 0.0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--ignition") == 0)
+        ignition = value;
+      else if (strcmp(token, "--dt-max") == 0)
+        dt_max = value;
+      else if (strcmp(token, "--dt-min") == 0)
+        dt_min = value;
+      else if (strcmp(token, "--reference-dt") == 0)
+        dt_ref = value;
+      else if (strcmp(token, "--tol-max") == 0)
+        tol_max = value;
+      else
+        tol_min = value;
+    } else {
+      println("Unknown flag: %s", token);
+      return -1;
+    }
+  }
+
+  // The reference has to be finer than every step of the sweep to measure its errors
+  if (dt_ref == 0)
+    dt_ref = dt_min / 16;
+
+  fparser_t fp = fparser_init(rocket_file);
+  if (!fp.file) {
+    fprintln(stderr, "No '%s' file was found!", rocket_file);
+    return -1;
+  }
+
+  fparser_parse(&fp);
+  fparser_free(&fp);
+
+  scenario_params_t params = {0};
+  if (scenario_params_load(&fp, &params) != 0) {
+    fprintln(stderr, "Invalid '%s' file!", rocket_file);
+    return -1;
+  }
+
+  rocket_t *r = start_falling(params.dry_mass, params.fuel_mass, params.altitude, params.eng,
+                              params.pl);
+  double *samples = (double *)malloc(sizeof(double) * b.repeats);
+  if (!r || !samples)
+    return -1;
+
+  if (ignition == 0)
+    ignition = default_ignition(r, 10);
+
+  // dt is adjusted, so that the ignition time is a whole number of steps
+  long ref_ignition = lround(ignition / dt_ref);
+  run_t ref = simulate(r, update_status_rk4, ignition / ref_ignition, ref_ignition);
+  if (isnan(ref.time)) {
+    fprintln(stderr, "The rocket doesn't reach the ground with ignition at %f s", ignition);
+    rocket_free(r);
+    free(samples);
+    return -1;
+  }
+
+  fprintln(stderr, "Reference(rk4, dt = %g): ignition %.6f s, landing at %.9f s, %.9f m/s",
+           ignition / ref_ignition, ignition, ref.time, ref.velocity);
+
+  println("integrator,dt,steps,force_evals,seconds,mad,time_error,velocity_error,fuel_error,"
+          "tolerance");
+  for (size_t k = 0; k < sizeof(integrators) / sizeof(integrators[0]); k++) {
+    // The adaptive methods pick their own steps, dt is then the mean step
+    for (double tol = tol_max; integrators[k].adaptive && tol >= tol_min * (1 - 1e-9);
+         tol /= 10) {
+      run_t run = {0};
+      for (int s = 0; s < b.repeats; s++) {
+        int repeats = 0;
+        double start = bench_now(), elapsed;
+        do {
+          run = simulate_adaptive(r, integrators[k].fn, tol, ignition);
+          repeats++;
+        } while ((elapsed = bench_now() - start) < 0.01);
+        samples[s] = elapsed / repeats;
+      }
+
+      char name[BENCH_NAME_SIZE];
+      snprintf(name, sizeof(name), "%s/tol=%.2e", integrators[k].name, tol);
+      const bench_result_t *res = bench_add(&b, name, samples, b.repeats);
+      if (!res)
+        break;
+
+      println("%s,%.6e,%ld,%ld,%.6e,%.6e,%.6e,%.6e,%.6e,%.2e", integrators[k].name,
+              run.time / run.steps, run.steps, run.force_evals, res->median, res->mad,
+              fabs(run.time - ref.time), fabs(run.velocity - ref.velocity),
+              fabs(run.fuel_mass - ref.fuel_mass), tol);
+    }
+
+    for (double nominal = dt_max; nominal >= dt_min * (1 - 1e-9); nominal /= 2) {
+      long ignition_steps = MAX(1, lround(ignition / nominal));
+      double dt = ignition / ignition_steps;
+
+      // Short runs are repeated within a sample, so it's above the timer resolution
+      run_t run;
+      for (int s = 0; s < b.repeats; s++) {
+        int repeats = 0;
+        double start = bench_now(), elapsed;
+        do {
+          run = simulate(r, integrators[k].fn, dt, ignition_steps);
+          repeats++;
+        } while ((elapsed = bench_now() - start) < 0.01);
+        samples[s] = elapsed / repeats;
+      }
+
+      char name[BENCH_NAME_SIZE];
+      snprintf(name, sizeof(name), "%s/dt=%.2e", integrators[k].name, nominal);
+      const bench_result_t *res = bench_add(&b, name, samples, b.repeats);
+      if (!res)
+        break;
+
+      println("%s,%.6e,%ld,%ld,%.6e,%.6e,%.6e,%.6e,%.6e,0", integrators[k].name, dt, run.steps,
+              run.force_evals, res->median, res->mad, fabs(run.time - ref.time),
+              fabs(run.velocity - ref.velocity), fabs(run.fuel_mass - ref.fuel_mass));
+    }
+  }
+
+  rocket_free(r);
+  free(samples);
+
+  int status = bench_finish(&b);
+  bench_free(&b);
+
+  return status;
+}
@@ -1,6 +1,122 @@
 #include <rocketlib.h>
 
+/**
+ * @struct scenario_params_t
+ * @brief Parameters of the vertical fall scenario read from the config file
+ *
+ */
+typedef struct scenario_params_t {
+  planet_t pl;
+  engine_t eng;
+  double dry_mass, fuel_mass, altitude;
+  double weights[3]; // [pid_weights]: velocity, altitude, fuel
+  double dp[3];      // [pid_start_values]: K_p, K_i, K_d
 
+} scenario_params_t;
+
+/**
+ * @struct flight_log_t
+ * @brief Destination of the flight data: a logger or one shard of a shard_logger_t(decks), and
+ * the online summary of the flight
+ *
+ */
+typedef struct flight_log_t {
+  logger_t *l;
+  shard_logger_t *sl;
+  int shard;
+  uint64_t scenario;
+  aggregate_set_t *stats; // Sampled on every step(see flight_stats_init) or NULL
+
+} flight_log_t;
+
+// Uncertain parameters, in the order of the [uncertainty] keys and of the augmented state of
+// landing_lincov
+#define UNCERTAIN_ALTITUDE 0
+#define UNCERTAIN_VELOCITY 1
+#define UNCERTAIN_FUEL_MASS 2
+#define UNCERTAIN_DRY_MASS 3
+#define UNCERTAIN_THRUST 4
+#define UNCERTAIN_CONSUMPTION 5
+#define UNCERTAIN_PLANET_MASS 6
+#define UNCERTAIN_COUNT 7
+
+/**
+ * @struct scenario_uncertainty_t
+ * @brief Standard deviations of the scenario parameters([uncertainty] section), independent
+ * of each other. The initial velocity is nominally zero
+ *
+ */
+typedef struct scenario_uncertainty_t {
+  double sigma[UNCERTAIN_COUNT];
+
+} scenario_uncertainty_t;
+
+// Landing state reported by the dispersion modes: time, velocity and fuel mass at touchdown
+#define LANDING_TIME 0
+#define LANDING_VELOCITY 1
+#define LANDING_FUEL_MASS 2
+#define LANDING_STATES 3
+
+/**
+ * @struct landing_stats_t
+ * @brief Mean and covariance of the landing state
+ *
+ */
+typedef struct landing_stats_t {
+  double mean[LANDING_STATES];
+  double cov[LANDING_STATES][LANDING_STATES];
+
+} landing_stats_t;
+
+// Inputs of the landing surrogate, in the order of a query
+#define SURROGATE_DRY_MASS 0
+#define SURROGATE_FUEL_MASS 1
+#define SURROGATE_ALTITUDE 2
+#define SURROGATE_THRUST 3
+#define SURROGATE_CONSUMPTION 4
+#define SURROGATE_INPUTS 5
+
+// Outputs of the landing surrogate: time to ignite, velocity and fuel mass at landing
+#define SURROGATE_IGNITION 0
+#define SURROGATE_VELOCITY 1
+#define SURROGATE_FUEL 2
+#define SURROGATE_OUTPUTS 3
+
+/**
+ * @struct landing_surrogate_t
+ * @brief Gaussian-process models of the hoverslam outcome, trained on one planet inside a box
+ * of inputs
+ *
+ */
+typedef struct landing_surrogate_t {
+  planet_t pl;
+  double dt, eps; // Of the training simulations, also used by the fallback
+  double lo[SURROGATE_INPUTS], hi[SURROGATE_INPUTS];
+  gp_t gp[SURROGATE_OUTPUTS]; // Inputs scaled to [0, 1] inside the box
+  // Factors of the standard deviations of the models, so that 2 sigma covers 95% of the errors
+  // on the validation scenarios(1 if there were none)
+  double sigma_scale[SURROGATE_OUTPUTS];
+
+} landing_surrogate_t;
+
+/**
+ * @struct landing_prediction_t
+ * @brief Answer of landing_surrogate_predict
+ *
+ */
+typedef struct landing_prediction_t {
+  bool lands;     // Enough delta-v for a hoverslam
+  bool simulated; // The model wasn't sure(or the inputs were outside of its box)
+  double value[SURROGATE_OUTPUTS];
+  double sigma[SURROGATE_OUTPUTS]; // 0 if simulated
+
+} landing_prediction_t;
+
+// Groups of scenario_params_t, returned by scenario_params_reload
+#define PARAMS_PLANET 1
+#define PARAMS_ENGINE 2
+#define PARAMS_ROCKET 4
+#define PARAMS_PID 8
 
 /// @brief Calculate delta-v of rocket
 double deltav(const rocket_t *r);
@@ -15,15 +131,32 @@ vec3_t calculate_forces(const void *r_ptr);
 void update_status_rk1(simulator_t *scene, vec3_t new_directions,
                        vec3_t(calculate_forces)(const void *));
 
-/// @brief Updates the rocket's state over a single time step using the second-order Runge-Kutta
-/// method(midpoint method)
-void update_status_rk2(simulator_t *scene, vec3_t new_directions,
-                       vec3_t(calculate_forces)(const void *));
+/// Explicit Runge-Kutta methods, X(name, adaptive). Every method has a Butcher tableau in
+/// common.c and an update_status_<name> integrator:
+/// rk2     - second-order midpoint method
+/// rk4     - classic fourth-order method
+/// rk38    - fourth-order 3/8-rule
+/// ralston - second-order Ralston method
+/// ssprk3  - third-order strong stability preserving method
+/// bs23    - Bogacki-Shampine 3(2) pair
+/// dopri5  - Dormand-Prince 5(4) pair
+/// The adaptive(embedded) pairs advance with the higher order. With simulator_t.tolerance set
+/// they shrink scene->dt until the step is accepted and propose the next one in scene->next_dt.
+/// The fixed-step methods assert that simulator_t.tolerance is not set
+#define RK_METHODS(X)                                                                             \
+  X(rk2, false)                                                                                   \
+  X(rk4, false)                                                                                   \
+  X(rk38, false)                                                                                  \
+  X(ralston, false)                                                                               \
+  X(ssprk3, false)                                                                                \
+  X(bs23, true)                                                                                   \
+  X(dopri5, true)
 
-/// @brief Updates the rocket's state over a single time step using the classic fourth-order
-/// Runge-Kutta method
-void update_status_rk4(simulator_t *scene, vec3_t new_directions,
-                       vec3_t(calculate_forces)(const void *));
+#define RK_DECLARE(name, adaptive)                                                                \
+  void update_status_##name(simulator_t *scene, vec3_t new_directions,                           \
+                            vec3_t(calculate_forces)(const void *));
+RK_METHODS(RK_DECLARE)
+#undef RK_DECLARE
 
 /// @brief Event detector for ground contact and other simulation events.
 /// @return Returns the type of event detected.
@@ -36,8 +169,161 @@ void hoverslam_event_interpolator(simulator_t *scene, const void *previous_state
 
 void take_step(simulator_t *scene);
 
+/// @brief Creates the scene of a vertical fall(rk4, ground contact events) for `r`
+simulator_t falling_scene(rocket_t *r, double dt);
+
+/// @brief Simulate a flight where the engine ignites after a specified time
+/// Used for calculating the time of a hoverslam in
+/// golden_search_hoverslam
+/// @return Velocity at landing/crash
+double velocity_at_landing(simulator_t *scene, double ignition_time);
+
+/// @brief Find the best time to ignite the engine using a golden-section
+/// search. Treats velocity_at_landing as a function to be minimized
+/// @param eps Precision
+/// @return Time to start the engine(searched from the current time of the scene)
+double golden_search_hoverslam(simulator_t *scene, double eps);
+
+/// @brief Searches the time to ignite and flies the hoverslam of one scenario
+/// @param inputs SURROGATE_INPUTS values
+/// @param out SURROGATE_OUTPUTS values, set only if the rocket lands
+/// @return If the rocket has enough delta-v and lands
+bool landing_outcome(const planet_t *pl, const double *inputs, double dt, double eps,
+                     double *out);
+
+/// @brief Predicts the outcome of a hoverslam with the surrogate. The delta-v check is exact.
+/// The flight is simulated instead if the inputs are outside of the trained box or the
+/// calibrated standard deviation of the predicted fuel mass is above `max_sigma`(kg)
+landing_prediction_t landing_surrogate_predict(const landing_surrogate_t *s, const double *inputs,
+                                               double max_sigma);
+
+/// @brief Saves the surrogate as text(see gp.h)
+int landing_surrogate_write(const landing_surrogate_t *s, const char *filename);
+/// @return 0 on success or -1 on failure
+int landing_surrogate_read(landing_surrogate_t *s, const char *filename);
+void landing_surrogate_free(landing_surrogate_t *s);
+
 /// @brief Initializes the rocket state for a vertical fall scenario
 rocket_t *start_falling(double dry_mass, double fuel_mass, double height, engine_t engine,
                         planet_t pl);
 
+/// @brief Builds a comma separated list of the log columns enabled (set to non-zero) in the
+/// [log_columns] section of the config
+/// @return Number of columns in the list
+int log_columns_from_config(fparser_t *fp, char *buff, size_t size);
+
+/// @brief Flushes an async logger and prints its write statistics
+void print_writer_stats(logger_t *l);
+
+/// @brief Reads the scenario parameters from a parsed config. [planet], [engine] and [rocket]
+/// keys are required, [pid_weights] and [pid_start_values] have defaults. Problems are reported
+/// to stderr
+/// @return Number of missing required keys or -1 on failure
+int scenario_params_load(fparser_t *fp, scenario_params_t *params);
+
+/// @brief scenario_params_load for one scenario of a deck
+int scenario_params_load_deck(const fparser_deck_t *deck, int scenario, scenario_params_t *params);
+
+/// @brief Applies a reloaded config(see config_watch_take) between two steps. Planet and engine
+/// parameters are copied into the flying rocket, changes of the initial conditions([rocket])
+/// are reported and ignored. `fresh` is freed
+/// @return PARAMS_* groups which changed
+int scenario_params_reload(scenario_params_t *params, fparser_t *fresh, rocket_t *r);
+
+/// @brief Reads the [uncertainty] section. All keys are optional and default to 0
+/// @return 0 on success or -1 on failure
+int scenario_uncertainty_load(fparser_t *fp, scenario_uncertainty_t *u);
+
+/// @brief Linear covariance analysis of a landing with the engine ignited at `ignition_time`.
+/// The state transition matrix of the state augmented with the uncertain parameters is
+/// integrated with RK4 alongside the nominal trajectory, and mapped to the touchdown with the
+/// first-order correction of the landing time
+/// @param out Nominal landing state and its covariance
+/// @return 0 on success or -1 if the nominal flight doesn't land
+int landing_lincov(const scenario_params_t *params, const scenario_uncertainty_t *u,
+                   double ignition_time, double dt, landing_stats_t *out);
+
+/// @brief Prints mean, standard deviation and covariance of the landing state
+void print_landing_stats(const char *title, const landing_stats_t *s);
+
+/// @brief Creates a CSV or binary logger for the flight data
+/// @param async Write through an async_writer_t(Linux, ignored elsewhere)
+logger_t flight_log_open(const char *filename, bool binary, bool async);
+
+/// @brief Writes the state of the rocket into the logger or the shard
+int flight_log_write(flight_log_t *log, rocket_t *r);
+/// @brief Called before the first step: samples the initial state into the summary
+int flight_log_begin(flight_log_t *log, rocket_t *r);
+/// @brief Called after every step: samples the summary and writes the state of the steps in the
+/// last 0.01 s before a whole second(is_almost_integer). The log thus gets a burst of about
+/// 0.01 / dt rows once per second, not a row every 0.01 s. The step which ends the flight is
+/// passed after event_interpolator moved it to the event
+int flight_log_step(flight_log_t *log, rocket_t *r);
+
+/// @brief Sets up the summary of a flight: speed and acceleration(mean, extremes, median and
+/// 95th percentile), altitude extremes, fuel mass at both ends and mean thrust
+void flight_stats_init(aggregate_set_t *s);
+/// @brief Writes a CSV file with the summary records of `count` flights. Flights without
+/// samples(failed scenarios) are left out
+/// @param deck Adds the scenario index and name columns, NULL for a single flight
+/// @return 0 on success or -1 on failure
+int flight_stats_write(const char *filename, const aggregate_set_t *runs, int count,
+                       const fparser_deck_t *deck);
+
+/// @brief Writes the stored trajectory every `step` seconds into a new CSV or binary log and
+/// prints its size
+/// @param r Rocket after the flight(masses, engine and planet for the log)
+/// @param columns Comma separated columns to log or NULL for all of them
+/// @return 0 on success or -1 on failure
+int flight_log_resample(const trajectory_t *tr, const rocket_t *r, double step,
+                        const char *filename, bool binary, const char *columns);
+
+/// @brief Prints "mean" and "std" rows under a deck summary. The values are reduced with a fixed
+/// tree(reduce.h), so the rows are the same bits for any number of threads
+/// @param columns `count` columns, `stride` values apart, of `rows` values stored by scenario
+/// index
+/// @param skip Number of empty fields before the first column
+void print_deck_stats(const double *columns, int count, int stride, int rows, int skip);
+
+#define DECK_MAX_COLUMNS 16
+
+/// @brief Flies one scenario of a deck
+/// @param scene Falling scene of the rocket set up from `params`
+/// @param log Shard and summary of the scenario, NULL if nothing is logged or summarized
+/// @param result Room for deck_sim_t.result_size bytes
+typedef void (*deck_run_fn)(const void *ctx, simulator_t *scene, scenario_params_t *params,
+                            flight_log_t *log, void *result);
+/// @brief Formats the result columns of a landed scenario into `buff`(like sndisplay_rocket)
+/// and stores their values in `row` for the mean and std rows
+typedef int (*deck_columns_fn)(const void *result, char *buff, size_t size, double *row);
+
+/**
+ * @struct deck_sim_t
+ * @brief The simulation run_deck flies for every scenario and the columns of its results
+ *
+ */
+typedef struct deck_sim_t {
+  deck_run_fn run;
+  deck_columns_fn columns;
+  const void *ctx; // Passed to run
+  double dt;
+  size_t result_size;
+  const char *header; // Comma separated names of the result columns
+  int column_count;   // At most DECK_MAX_COLUMNS
+
+} deck_sim_t;
+
+/// @brief Runs every scenario of the deck in `fp` on a pool of worker threads and prints a
+/// summary line per scenario. Logs are written to per-worker shards and merged into `l`
+/// @param threads Number of workers, one per CPU if <= 0
+/// @param processes If > 0, the scenarios run in this many forked worker processes instead of
+/// threads and the results are collected in shared memory
+/// @param topo Placement of the workers, pinned by their index(see topology.h). Every worker
+/// allocates its own rocket, stdio buffer of its shard and malloc arena after pinning
+/// @param summary File for the summary records of the landed scenarios or NULL
+/// @param l Logger for simulation data of all scenarios or NULL
+/// @return 0 if all scenarios landed, -1 otherwise
+int run_deck(fparser_t *fp, const deck_sim_t *sim, int threads, int processes,
+             const topology_t *topo, const char *summary, logger_t *l);
+
 #define rocket_free(r) free(r)
@@ -4,6 +4,7 @@
 #include "common.h"
 
 #include <assert.h>
+#include <stddef.h>
 
 double deltav(const rocket_t *r) {
   double u = calculate_u(r->engine), mass = FULL_MASS(*r), g = calculate_g(*r);
@@ -71,11 +72,15 @@ void hoverslam_event_interpolator(simulator_t *scene, const void *previous_state
 
   // The final altitude is exactly zero
   current_state->coords.z = 0.0;
+
+  if (scene->trajectory)
+    trajectory_truncate(scene->trajectory, current_state->time);
 }
 
 void update_status_rk1(simulator_t *scene, vec3_t new_directions,
                        vec3_t(calculate_forces)(const void *)) {
   rocket_t *r = (rocket_t *)scene->object;
+  rocket_t start = *r;
   double dt = scene->dt;
   r->time += dt;
   r->directions = new_directions;
@@ -86,6 +91,10 @@ void update_status_rk1(simulator_t *scene, vec3_t new_directions,
   r->velocity.y += r->acc.y * dt;
   r->velocity.z += r->acc.z * dt;
 
+  // The coordinates move with the new velocity
+  if (scene->trajectory)
+    trajectory_push(scene->trajectory, &start, dt, &r->velocity, &r->acc, 1);
+
   r->coords.x += r->velocity.x * dt;
   r->coords.y += r->velocity.y * dt;
   r->coords.z += r->velocity.z * dt;
@@ -97,136 +106,265 @@ void update_status_rk1(simulator_t *scene, vec3_t new_directions,
   }
 }
 
-void update_status_rk2(simulator_t *scene, vec3_t new_directions,
-                       vec3_t(calculate_forces)(const void *)) {
-  rocket_t *r = (rocket_t *)scene->object;
-  double dt = scene->dt;
-  r->directions = new_directions;
+// Explicit Runge-Kutta engine. Each method is a tableau below and a line of RK_METHODS(common.h).
+// The step is inlined into every method with its tableau as a constant, so the stage loops are
+// unrolled and the zero coefficients disappear
 
-  // --- Step 1: Calculate derivatives at the initial point (k1) ---
-  vec3_t a1 = calculate_forces(r);
-  vec3_t v1 = r->velocity;
+#if defined(__GNUC__)
+#define RK_INLINE static inline __attribute__((always_inline))
+#else
+#define RK_INLINE static inline
+#endif
 
-  // --- Step 2: Evaluate the state of the system at the middle of the step (t +
-  // dt/2) ---
-  rocket_t k2 = *r;
-  k2.coords.x += v1.x * (dt / 2.0);
-  k2.coords.y += v1.y * (dt / 2.0);
-  k2.coords.z += v1.z * (dt / 2.0);
+#define RK_MAX_STAGES TRAJECTORY_MAX_STAGES
+#define RK_MAX_REJECTS 32
 
-  k2.velocity.x += a1.x * (dt / 2.0);
-  k2.velocity.y += a1.y * (dt / 2.0);
-  k2.velocity.z += a1.z * (dt / 2.0);
+/**
+ * @struct rk_row_t
+ * @brief A row of a tableau: dt / den * sum(a[j] * k_j). With the divisor the classic methods
+ * keep the rounding of their usual form(dt / 6 * (k1 + 2k2 + 2k3 + k4))
+ *
+ */
+typedef struct rk_row_t {
+  double den;
+  double a[RK_MAX_STAGES];
 
-  k2.fuel_mass -= k2.engine.consumption * k2.thrust_percent * (dt / 2.0);
-  k2.time += dt / 2.0;
+} rk_row_t;
 
-  // --- Step 3: Calculate the derivatives at the midpoint (k2) ---
-  vec3_t a2 = calculate_forces(&k2);
-  vec3_t v2 = k2.velocity;
+/**
+ * @struct rk_tableau_t
+ * @brief Butcher tableau of an explicit method
+ *
+ */
+typedef struct rk_tableau_t {
+  int stages;
+  int error_order; // Order of the error estimate + 1, 0 without an embedded method
+  double c[RK_MAX_STAGES];
+  rk_row_t a[RK_MAX_STAGES]; // a[0] is unused
+  rk_row_t b, e;             // Solution and error estimate(b - embedded b)
+  double dense[3][TRAJECTORY_MAX_STAGES]; // Continuous extension, see trajectory_push_dense
 
-  // --- Step 4: Update the state using derivatives from the midpoint ---
-  r->time += dt;
-  r->acc = a2;
-  r->coords.x += v2.x * dt;
-  r->coords.y += v2.y * dt;
-  r->coords.z += v2.z * dt;
+} rk_tableau_t;
 
-  r->velocity.x += a2.x * dt;
-  r->velocity.y += a2.y * dt;
-  r->velocity.z += a2.z * dt;
+// Midpoint method
+static const rk_tableau_t rk_rk2 = {
+    .stages = 2,
+    .c = {0, 0.5},
+    .a = {[1] = {2, {1}}},
+    .b = {1, {0, 1}},
+    .dense = {{1, 0}, {-1, 1}, {0, 0}},
+};
 
-  r->fuel_mass -= r->engine.consumption * r->thrust_percent * dt;
-  if (r->fuel_mass < 0) {
-    r->fuel_mass = 0;
-    CHANGE_THRUST(*r, 0);
+// Classic fourth-order method
+static const rk_tableau_t rk_rk4 = {
+    .stages = 4,
+    .c = {0, 0.5, 0.5, 1},
+    .a = {[1] = {2, {1}}, [2] = {2, {0, 1}}, [3] = {1, {0, 0, 1}}},
+    .b = {6, {1, 2, 2, 1}},
+    .dense = {{1, 0, 0, 0}, {-1.5, 1, 1, -0.5}, {2.0 / 3, -2.0 / 3, -2.0 / 3, 2.0 / 3}},
+};
+
+// Fourth-order 3/8-rule
+static const rk_tableau_t rk_rk38 = {
+    .stages = 4,
+    .c = {0, 1.0 / 3, 2.0 / 3, 1},
+    .a = {[1] = {3, {1}}, [2] = {3, {-1, 3}}, [3] = {1, {1, -1, 1}}},
+    .b = {8, {1, 3, 3, 1}},
+    .dense = {{1, 0, 0, 0}, {-15.0 / 8, 15.0 / 8, 3.0 / 8, -3.0 / 8}, {1, -1.5, 0, 0.5}},
+};
+
+// Ralston's second-order method(smallest error bound of the two-stage methods)
+static const rk_tableau_t rk_ralston = {
+    .stages = 2,
+    .c = {0, 2.0 / 3},
+    .a = {[1] = {3, {2}}},
+    .b = {4, {1, 3}},
+    .dense = {{1, 0}, {-0.75, 0.75}, {0, 0}},
+};
+
+// Third-order strong stability preserving method of Shu and Osher
+static const rk_tableau_t rk_ssprk3 = {
+    .stages = 3,
+    .c = {0, 1, 0.5},
+    .a = {[1] = {1, {1}}, [2] = {4, {1, 1}}},
+    .b = {6, {1, 1, 4}},
+    .dense = {{1, 0, 0}, {-5.0 / 6, 1.0 / 6, 2.0 / 3}, {0, 0, 0}},
+};
+
+// Bogacki-Shampine 3(2) pair. The last stage is the derivative at the end of the step, which
+// gives a cubic Hermite extension
+static const rk_tableau_t rk_bs23 = {
+    .stages = 4,
+    .error_order = 3,
+    .c = {0, 0.5, 0.75, 1},
+    .a = {[1] = {2, {1}}, [2] = {4, {0, 3}}, [3] = {9, {2, 3, 4}}},
+    .b = {9, {2, 3, 4, 0}},
+    .e = {72, {-5, 6, 8, -9}},
+    .dense = {{1, 0, 0, 0}, {-4.0 / 3, 1, 4.0 / 3, -1}, {5.0 / 9, -2.0 / 3, -8.0 / 9, 1}},
+};
+
+// Dormand-Prince 5(4) pair, with the same Hermite extension as bs23
+static const rk_tableau_t rk_dopri5 = {
+    .stages = 7,
+    .error_order = 5,
+    .c = {0, 0.2, 0.3, 0.8, 8.0 / 9, 1, 1},
+    .a =
+        {
+            [1] = {5, {1}},
+            [2] = {40, {3, 9}},
+            [3] = {45, {44, -168, 160}},
+            [4] = {6561, {19372, -76080, 64448, -1908}},
+            [5] = {1,
+                   {9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656}},
+            [6] = {1, {35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84}},
+        },
+    .b = {1, {35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84, 0}},
+    .e = {1,
+          {71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525,
+           -1.0 / 40}},
+    .dense =
+        {
+            {1},
+            {3 * 35.0 / 384 - 2, 0, 3 * 500.0 / 1113, 3 * 125.0 / 192, -3 * 2187.0 / 6784,
+             3 * 11.0 / 84, -1},
+            {1 - 2 * 35.0 / 384, 0, -2 * 500.0 / 1113, -2 * 125.0 / 192, 2 * 2187.0 / 6784,
+             -2 * 11.0 / 84, 1},
+        },
+};
+
+// sum(w[j] * k_j) over the first `count` stages, terms with a zero weight are skipped
+RK_INLINE vec3_t rk_combine(const double *w, const vec3_t *k, int count) {
+  vec3_t sum = VEC3_ZERO;
+
+#pragma GCC unroll 8
+  for (int j = 0; j < RK_MAX_STAGES; j++) {
+    if (j < count && w[j] != 0) {
+      sum.x += w[j] * k[j].x;
+      sum.y += w[j] * k[j].y;
+      sum.z += w[j] * k[j].z;
+    }
   }
+
+  return sum;
 }
 
-void update_status_rk4(simulator_t *scene, vec3_t new_directions,
-                       vec3_t(calculate_forces)(const void *)) {
+// Largest error of the coordinates and velocity relative to tolerance * (1 + |state|)
+static double rk_error(const rocket_t *start, const rocket_t *end, vec3_t ex, vec3_t ev,
+                       double tolerance) {
+  const double e[6] = {ex.x, ex.y, ex.z, ev.x, ev.y, ev.z};
+  const double y0[6] = {start->coords.x,   start->coords.y,   start->coords.z,
+                        start->velocity.x, start->velocity.y, start->velocity.z};
+  const double y1[6] = {end->coords.x,   end->coords.y,   end->coords.z,
+                        end->velocity.x, end->velocity.y, end->velocity.z};
+  double error = 0;
+
+  for (int i = 0; i < 6; i++)
+    error = MAX(error, fabs(e[i]) / (tolerance * (1 + MAX(fabs(y0[i]), fabs(y1[i])))));
+
+  return error;
+}
+
+RK_INLINE void rk_step(simulator_t *scene, vec3_t new_directions,
+                       vec3_t(calculate_forces)(const void *), const rk_tableau_t *t,
+                       bool dense) {
   rocket_t *r = (rocket_t *)scene->object;
-  double dt = scene->dt;
   r->directions = new_directions;
 
-  rocket_t initial_state = *r;
-
-  // --- k1: Derivatives at the initial point ---
-  vec3_t v1 = initial_state.velocity;
-  vec3_t a1 = calculate_forces(&initial_state);
-
-  // --- k2: Derivatives at the midpoint (t + dt/2) using k1 ---
-  rocket_t r_k2 = initial_state;
-  r_k2.coords.x += v1.x * (dt / 2.0);
-  r_k2.coords.y += v1.y * (dt / 2.0);
-  r_k2.coords.z += v1.z * (dt / 2.0);
-  r_k2.velocity.x += a1.x * (dt / 2.0);
-  r_k2.velocity.y += a1.y * (dt / 2.0);
-  r_k2.velocity.z += a1.z * (dt / 2.0);
-  r_k2.fuel_mass -= initial_state.engine.consumption * initial_state.thrust_percent * (dt / 2.0);
-  if (r_k2.fuel_mass < 0)
-    r_k2.fuel_mass = 0;
-
-  vec3_t v2 = r_k2.velocity;
-  vec3_t a2 = calculate_forces(&r_k2);
-
-  // --- k3: Derivatives at the midpoint (t + dt/2) using k2 ---
-  rocket_t r_k3 = initial_state;
-  r_k3.coords.x += v2.x * (dt / 2.0);
-  r_k3.coords.y += v2.y * (dt / 2.0);
-  r_k3.coords.z += v2.z * (dt / 2.0);
-  r_k3.velocity.x += a2.x * (dt / 2.0);
-  r_k3.velocity.y += a2.y * (dt / 2.0);
-  r_k3.velocity.z += a2.z * (dt / 2.0);
-  r_k3.fuel_mass -= initial_state.engine.consumption * initial_state.thrust_percent * (dt / 2.0);
-  if (r_k3.fuel_mass < 0)
-    r_k3.fuel_mass = 0;
-
-  vec3_t v3 = r_k3.velocity;
-  vec3_t a3 = calculate_forces(&r_k3);
-
-  // --- k4: Derivatives at the endpoint (t + dt) using k3 ---
-  rocket_t r_k4 = initial_state;
-  r_k4.coords.x += v3.x * dt;
-  r_k4.coords.y += v3.y * dt;
-  r_k4.coords.z += v3.z * dt;
-  r_k4.velocity.x += a3.x * dt;
-  r_k4.velocity.y += a3.y * dt;
-  r_k4.velocity.z += a3.z * dt;
-  r_k4.fuel_mass -= initial_state.engine.consumption * initial_state.thrust_percent * dt;
-  if (r_k4.fuel_mass < 0)
-    r_k4.fuel_mass = 0;
-
-  vec3_t v4 = r_k4.velocity;
-  vec3_t a4 = calculate_forces(&r_k4);
-
-  // --- Combine derivatives to update the state ---
-  r->time += dt;
+  const rocket_t start = *r;
+  const double rate = start.engine.consumption * start.thrust_percent;
+  vec3_t v[RK_MAX_STAGES], a[RK_MAX_STAGES];
+  double dt = scene->dt, factor = 1;
+
+  v[0] = start.velocity;
+  a[0] = calculate_forces(&start);
+
+  for (int attempt = 0;; attempt++) {
+#pragma GCC unroll 8
+    for (int i = 1; i < RK_MAX_STAGES; i++) {
+      if (i >= t->stages)
+        break;
+
+      rocket_t s = start;
+      double h = dt / t->a[i].den;
+      vec3_t dx = rk_combine(t->a[i].a, v, i), dv = rk_combine(t->a[i].a, a, i);
+      s.time += dt * t->c[i];
+      s.coords.x += dx.x * h;
+      s.coords.y += dx.y * h;
+      s.coords.z += dx.z * h;
+      s.velocity.x += dv.x * h;
+      s.velocity.y += dv.y * h;
+      s.velocity.z += dv.z * h;
+      s.fuel_mass -= rate * (dt * t->c[i]);
+      if (s.fuel_mass < 0)
+        s.fuel_mass = 0;
+
+      v[i] = s.velocity;
+      a[i] = calculate_forces(&s);
+    }
+
+    vec3_t dx = rk_combine(t->b.a, v, t->stages), dv = rk_combine(t->b.a, a, t->stages);
+    double h = dt / t->b.den;
+    r->coords.x = start.coords.x + h * dx.x;
+    r->coords.y = start.coords.y + h * dx.y;
+    r->coords.z = start.coords.z + h * dx.z;
+    r->velocity.x = start.velocity.x + h * dv.x;
+    r->velocity.y = start.velocity.y + h * dv.y;
+    r->velocity.z = start.velocity.z + h * dv.z;
 
-  // Update position using weighted average of velocities
-  r->coords.x += (dt / 6.0) * (v1.x + 2.0 * v2.x + 2.0 * v3.x + v4.x);
-  r->coords.y += (dt / 6.0) * (v1.y + 2.0 * v2.y + 2.0 * v3.y + v4.y);
-  r->coords.z += (dt / 6.0) * (v1.z + 2.0 * v2.z + 2.0 * v3.z + v4.z);
+    // Acceleration for logging, the weighted average of the stages
+    r->acc.x = dv.x / t->b.den;
+    r->acc.y = dv.y / t->b.den;
+    r->acc.z = dv.z / t->b.den;
 
-  // Update velocity using weighted average of accelerations
-  r->velocity.x += (dt / 6.0) * (a1.x + 2.0 * a2.x + 2.0 * a3.x + a4.x);
-  r->velocity.y += (dt / 6.0) * (a1.y + 2.0 * a2.y + 2.0 * a3.y + a4.y);
-  r->velocity.z += (dt / 6.0) * (a1.z + 2.0 * a2.z + 2.0 * a3.z + a4.z);
+    if (!t->error_order || scene->tolerance <= 0)
+      break;
 
-  // Update acceleration (for logging) as the weighted average
-  r->acc.x = (a1.x + 2.0 * a2.x + 2.0 * a3.x + a4.x) / 6.0;
-  r->acc.y = (a1.y + 2.0 * a2.y + 2.0 * a3.y + a4.y) / 6.0;
-  r->acc.z = (a1.z + 2.0 * a2.z + 2.0 * a3.z + a4.z) / 6.0;
+    double he = dt / t->e.den;
+    vec3_t ex = rk_combine(t->e.a, v, t->stages), ev = rk_combine(t->e.a, a, t->stages);
+    ex = (vec3_t){ex.x * he, ex.y * he, ex.z * he};
+    ev = (vec3_t){ev.x * he, ev.y * he, ev.z * he};
+    double error = rk_error(&start, r, ex, ev, scene->tolerance);
 
-  // Update fuel mass (simple Euler is correct as consumption rate is constant
-  // over the step)
-  r->fuel_mass -= initial_state.engine.consumption * initial_state.thrust_percent * dt;
+    factor = error > 0 ? 0.9 * pow(error, -1.0 / t->error_order) : 5;
+    factor = MIN(5, MAX(0.2, factor));
+    if (error <= 1 || attempt == RK_MAX_REJECTS)
+      break;
+
+    dt *= factor;
+  }
+
+  if (t->error_order && scene->tolerance > 0) {
+    scene->dt = dt;
+    scene->next_dt = dt * factor;
+  }
+
+  if (dense)
+    trajectory_push_dense(scene->trajectory, &start, dt, v, a, t->stages, t->dense);
+
+  r->time += dt;
+  r->fuel_mass -= rate * dt;
   if (r->fuel_mass < 0) {
     r->fuel_mass = 0;
     CHANGE_THRUST(*r, 0);
   }
 }
 
+// A fixed-step method has no error estimate, so a tolerance given to it would be silently ignored.
+// The step is instantiated with and without dense output: the stages are only stored in memory
+// when a trajectory takes them, otherwise they stay in registers
+#define RK_DEFINE(name, adaptive)                                                                 \
+  void update_status_##name(simulator_t *scene, vec3_t new_directions,                           \
+                            vec3_t(calculate_forces)(const void *)) {                            \
+    assert((adaptive) == (rk_##name.error_order != 0));                                          \
+    assert((adaptive) || scene->tolerance <= 0);                                                 \
+    if (scene->trajectory)                                                                        \
+      rk_step(scene, new_directions, calculate_forces, &rk_##name, true);                         \
+    else                                                                                          \
+      rk_step(scene, new_directions, calculate_forces, &rk_##name, false);                        \
+  }
+RK_METHODS(RK_DEFINE)
+#undef RK_DEFINE
+
 rocket_t *start_falling(double dry_mass, double fuel_mass, double height, engine_t engine,
                         planet_t pl) {
   rocket_t *r = (rocket_t *)malloc(sizeof(rocket_t));
@@ -254,6 +392,804 @@ rocket_t *start_falling(double dry_mass, double fuel_mass, double height, engine
 }
 
 void take_step(simulator_t *scene) {
-  scene->time += scene->dt;
   scene->integrator(scene, (vec3_t){0, 0, _M_PI_2_}, calculate_forces);
+  scene->time += scene->dt; // The step that was taken, an adaptive integrator may shrink it
+}
+
+simulator_t falling_scene(rocket_t *r, double dt) {
+  simulator_t scene = {0};
+  scene.dt = dt;
+  scene.integrator = update_status_rk4;
+  scene.event_detector = ground_contact_detector;
+  scene.event_interpolator = hoverslam_event_interpolator;
+  scene.object = r;
+  scene.take_step = take_step;
+
+  return scene;
+}
+
+double velocity_at_landing(simulator_t *scene, double ignition_time) {
+  event_type_t event = EV_NONE;
+  rocket_t prev;
+  rocket_t *r = (rocket_t *)scene->object;
+
+  while (event != EV_GROUND_CONTACT) {
+    if (scene->time >= ignition_time && r->thrust_percent == 0)
+      CHANGE_THRUST(*r, 1);
+
+    prev = *r;
+    scene->take_step(scene);
+    event = scene->event_detector(scene, &prev);
+
+    if (event == EV_UNSTABLE || r->coords.z <= 0)
+      break;
+  }
+
+  scene->event_interpolator(scene, &prev, event);
+
+  double result = fabs(r->velocity.z);
+
+  scene->time = 0;
+
+  return result;
+}
+
+double golden_search_hoverslam(simulator_t *scene, double eps) {
+  rocket_t r = *(rocket_t *)scene->object;
+  double time = scene->time, dt = scene->dt;
+  trajectory_t *trajectory = scene->trajectory; // Trial flights aren't recorded
+  scene->trajectory = NULL;
+
+  double g = calculate_g(r), phi = (1 + sqrt(5)) / 2; // φ ≈ 1.618
+  double right = time + sqrt((r.coords.z * 2) / g), left = time;
+  double m1 = right - (right - left) / phi, m2 = left + (right - left) / phi;
+  double f_m1 = velocity_at_landing(scene, m1);
+  scene->dt = dt;
+  scene->time = time;
+  *(rocket_t *)scene->object = r;
+
+  double f_m2 = velocity_at_landing(scene, m2);
+  scene->dt = dt;
+  scene->time = time;
+  *(rocket_t *)scene->object = r;
+
+  while (right - left > eps) {
+    scene->dt = dt;
+    scene->time = time;
+    *(rocket_t *)scene->object = r;
+
+    if (f_m1 < f_m2) {
+      right = m2;
+      m2 = m1;
+      m1 = right - (right - left) / phi;
+
+      f_m2 = f_m1;
+      f_m1 = velocity_at_landing(scene, m1);
+
+    } else {
+      left = m1;
+      m1 = m2;
+      m2 = left + (right - left) / phi;
+
+      f_m1 = f_m2;
+      f_m2 = velocity_at_landing(scene, m2);
+    }
+  }
+
+  scene->dt = dt;
+  scene->time = time;
+  scene->trajectory = trajectory;
+  *(rocket_t *)scene->object = r;
+
+  return (left + right) / 2;
+}
+
+bool landing_outcome(const planet_t *pl, const double *inputs, double dt, double eps,
+                     double *out) {
+  engine_t eng = {inputs[SURROGATE_THRUST], inputs[SURROGATE_CONSUMPTION]};
+  rocket_t *r = start_falling(inputs[SURROGATE_DRY_MASS], inputs[SURROGATE_FUEL_MASS],
+                              inputs[SURROGATE_ALTITUDE], eng, *pl);
+  if (!r)
+    return false;
+
+  bool lands = is_enough_deltav(r);
+  if (lands) {
+    simulator_t scene = falling_scene(r, dt);
+    double ignition = golden_search_hoverslam(&scene, eps);
+    velocity_at_landing(&scene, ignition);
+
+    lands = isfinite(r->velocity.z);
+    out[SURROGATE_IGNITION] = ignition;
+    out[SURROGATE_VELOCITY] = r->velocity.z;
+    out[SURROGATE_FUEL] = r->fuel_mass;
+  }
+
+  rocket_free(r);
+
+  return lands;
+}
+
+landing_prediction_t landing_surrogate_predict(const landing_surrogate_t *s, const double *inputs,
+                                               double max_sigma) {
+  landing_prediction_t p = {0};
+  if (!s || !inputs)
+    return p;
+
+  rocket_t r = {.engine = {inputs[SURROGATE_THRUST], inputs[SURROGATE_CONSUMPTION]},
+                .pl = s->pl,
+                .coords = {0, 0, inputs[SURROGATE_ALTITUDE]},
+                .dry_mass = inputs[SURROGATE_DRY_MASS],
+                .fuel_mass = inputs[SURROGATE_FUEL_MASS]};
+  if (!is_enough_deltav(&r))
+    return p;
+  p.lands = true;
+
+  double u[SURROGATE_INPUTS];
+  bool inside = true;
+  for (int k = 0; k < SURROGATE_INPUTS; k++) {
+    u[k] = (inputs[k] - s->lo[k]) / (s->hi[k] - s->lo[k]);
+    inside = inside && u[k] >= 0 && u[k] <= 1;
+  }
+
+  if (inside) {
+    for (int o = 0; o < SURROGATE_OUTPUTS; o++) {
+      p.value[o] = gp_predict(&s->gp[o], u, &p.sigma[o]);
+      p.sigma[o] *= s->sigma_scale[o];
+    }
+    if (p.sigma[SURROGATE_FUEL] <= max_sigma)
+      return p;
+  }
+
+  memset(p.sigma, 0, sizeof(p.sigma));
+  p.simulated = true;
+  p.lands = landing_outcome(&s->pl, inputs, s->dt, s->eps, p.value);
+
+  return p;
+}
+
+int landing_surrogate_write(const landing_surrogate_t *s, const char *filename) {
+  if (!s || !filename)
+    return -1;
+
+  FILE *file = fopen(filename, "w");
+  if (!file)
+    return -1;
+
+  fprintf(file, "landing_surrogate %d %d\n%a %a %a %a\n", SURROGATE_INPUTS, SURROGATE_OUTPUTS,
+          s->pl.mass, s->pl.radius, s->dt, s->eps);
+  for (int k = 0; k < SURROGATE_INPUTS; k++)
+    fprintf(file, "%a %a\n", s->lo[k], s->hi[k]);
+  for (int o = 0; o < SURROGATE_OUTPUTS; o++)
+    fprintf(file, o + 1 < SURROGATE_OUTPUTS ? "%a " : "%a\n", s->sigma_scale[o]);
+
+  int result = 0;
+  for (int o = 0; o < SURROGATE_OUTPUTS && result == 0; o++)
+    result = gp_write(&s->gp[o], file);
+
+  return fclose(file) == 0 ? result : -1;
+}
+
+int landing_surrogate_read(landing_surrogate_t *s, const char *filename) {
+  if (!s || !filename)
+    return -1;
+
+  FILE *file = fopen(filename, "r");
+  if (!file)
+    return -1;
+
+  *s = (landing_surrogate_t){0};
+  int inputs = 0, outputs = 0, result = 0;
+  char values[6][64];
+  if (fscanf(file, " landing_surrogate %d %d %63s %63s %63s %63s", &inputs, &outputs, values[0],
+             values[1], values[2], values[3]) != 6 ||
+      inputs != SURROGATE_INPUTS || outputs != SURROGATE_OUTPUTS)
+    result = -1;
+  else {
+    s->pl.mass = strtod(values[0], NULL);
+    s->pl.radius = strtod(values[1], NULL);
+    s->dt = strtod(values[2], NULL);
+    s->eps = strtod(values[3], NULL);
+  }
+
+  for (int k = 0; k < SURROGATE_INPUTS && result == 0; k++) {
+    if (fscanf(file, "%63s %63s", values[4], values[5]) != 2)
+      result = -1;
+    s->lo[k] = strtod(values[4], NULL);
+    s->hi[k] = strtod(values[5], NULL);
+  }
+
+  for (int o = 0; o < SURROGATE_OUTPUTS && result == 0; o++) {
+    if (fscanf(file, "%63s", values[4]) != 1)
+      result = -1;
+    s->sigma_scale[o] = strtod(values[4], NULL);
+    if (!(s->sigma_scale[o] > 0))
+      result = -1;
+  }
+
+  for (int o = 0; o < SURROGATE_OUTPUTS && result == 0; o++)
+    if ((result = gp_read(&s->gp[o], file)) == 0 && s->gp[o].dim != SURROGATE_INPUTS)
+      result = -1;
+
+  fclose(file);
+  if (result != 0)
+    landing_surrogate_free(s);
+
+  return result;
+}
+
+void landing_surrogate_free(landing_surrogate_t *s) {
+  if (!s)
+    return;
+
+  for (int o = 0; o < SURROGATE_OUTPUTS; o++)
+    gp_free(&s->gp[o]);
+}
+
+int log_columns_from_config(fparser_t *fp, char *buff, size_t size) {
+  if (!fp || !buff || size == 0)
+    return -1;
+
+  fparser_section_t section = fparser_get_section(fp, "log_columns");
+  size_t len = 0;
+  int count = 0;
+  buff[0] = '\0';
+
+  for (int i = 0; i < section.var_count; i++) {
+    if (section.vars[i].value == 0)
+      continue;
+
+    int n = snprintf(buff + len, size - len, count ? ",%s" : "%s", section.vars[i].name);
+    if (n < 0 || (size_t)n >= size - len)
+      return -1;
+    len += n;
+    count++;
+  }
+
+  return count;
+}
+
+void print_writer_stats(logger_t *l) {
+#ifdef __linux__
+  if (!l || !l->writer)
+    return;
+
+  logger_flush(l);
+  async_writer_stats_t st = async_writer_stats(l->writer);
+  display_println("Log writer(%s): %llu/%llu writes completed, %llu bytes, %llu stalls(%.6f s)",
+                  st.backend == ASYNC_WRITER_IO_URING ? "io_uring" : "writer thread",
+                  (unsigned long long)st.writes_completed, (unsigned long long)st.writes_submitted,
+                  (unsigned long long)st.bytes_completed, (unsigned long long)st.stalls,
+                  st.stall_seconds);
+#else
+  (void)l;
+#endif
+}
+
+#define P(field) offsetof(scenario_params_t, field)
+
+static const fparser_binding_t scenario_params_bindings[] = {
+    {"planet", "mass", P(pl.mass), FPARSER_DOUBLE, 0, true},
+    {"planet", "radius", P(pl.radius), FPARSER_DOUBLE, 0, true},
+    {"engine", "thrust", P(eng.thrust), FPARSER_DOUBLE, 0, true},
+    {"engine", "consumption", P(eng.consumption), FPARSER_DOUBLE, 0, true},
+    {"rocket", "dry_mass", P(dry_mass), FPARSER_DOUBLE, 0, true},
+    {"rocket", "fuel_mass", P(fuel_mass), FPARSER_DOUBLE, 0, true},
+    {"rocket", "altitude", P(altitude), FPARSER_DOUBLE, 0, true},
+    {"pid_weights", "velocity", P(weights[0]), FPARSER_DOUBLE, 1.0, false},
+    {"pid_weights", "altitude", P(weights[1]), FPARSER_DOUBLE, 1.0, false},
+    {"pid_weights", "fuel", P(weights[2]), FPARSER_DOUBLE, 0.1, false},
+    {"pid_start_values", "K_p", P(dp[0]), FPARSER_DOUBLE, 10.0, false},
+    {"pid_start_values", "K_i", P(dp[1]), FPARSER_DOUBLE, 5.0, false},
+    {"pid_start_values", "K_d", P(dp[2]), FPARSER_DOUBLE, 1.0, false},
+};
+
+#undef P
+
+int scenario_params_load(fparser_t *fp, scenario_params_t *params) {
+  return fparser_bind(fp, scenario_params_bindings,
+                      sizeof(scenario_params_bindings) / sizeof(scenario_params_bindings[0]),
+                      params, stderr);
+}
+
+int scenario_params_load_deck(const fparser_deck_t *deck, int scenario, scenario_params_t *params) {
+  return fparser_deck_bind(deck, scenario, scenario_params_bindings,
+                           sizeof(scenario_params_bindings) / sizeof(scenario_params_bindings[0]),
+                           params, stderr);
+}
+
+int scenario_params_reload(scenario_params_t *params, fparser_t *fresh, rocket_t *r) {
+  if (!params || !fresh || !r) {
+    free(fresh);
+    return 0;
+  }
+
+  scenario_params_t next = *params;
+  int missing = scenario_params_load(fresh, &next);
+  free(fresh);
+  if (missing != 0) // Keep flying with the old parameters
+    return 0;
+
+  int changed = 0;
+  if (next.pl.mass > 0 && next.pl.radius > 0 &&
+      (next.pl.mass != params->pl.mass || next.pl.radius != params->pl.radius)) {
+    params->pl = r->pl = next.pl;
+    changed |= PARAMS_PLANET;
+  }
+  if (next.eng.thrust > 0 && next.eng.consumption > 0 &&
+      (next.eng.thrust != params->eng.thrust ||
+       next.eng.consumption != params->eng.consumption)) {
+    params->eng = r->engine = next.eng;
+    changed |= PARAMS_ENGINE;
+  }
+  if (next.dry_mass != params->dry_mass || next.fuel_mass != params->fuel_mass ||
+      next.altitude != params->altitude) {
+    params->dry_mass = next.dry_mass;
+    params->fuel_mass = next.fuel_mass;
+    params->altitude = next.altitude;
+    changed |= PARAMS_ROCKET;
+    display_fprintln(stderr, "[rocket] is ignored: initial conditions can't change during flight");
+  }
+  if (memcmp(next.weights, params->weights, sizeof(next.weights)) != 0 ||
+      memcmp(next.dp, params->dp, sizeof(next.dp)) != 0) {
+    memcpy(params->weights, next.weights, sizeof(next.weights));
+    memcpy(params->dp, next.dp, sizeof(next.dp));
+    changed |= PARAMS_PID;
+  }
+
+  if (changed & ~PARAMS_ROCKET)
+    display_fprintln(stderr, "Config reloaded at %.3f s:%s%s%s", r->time,
+                     changed & PARAMS_PLANET ? " planet" : "",
+                     changed & PARAMS_ENGINE ? " engine" : "", changed & PARAMS_PID ? " pid" : "");
+
+  return changed;
+}
+
+#define U(i) offsetof(scenario_uncertainty_t, sigma[i])
+
+static const fparser_binding_t scenario_uncertainty_bindings[] = {
+    {"uncertainty", "altitude", U(UNCERTAIN_ALTITUDE), FPARSER_DOUBLE, 0, false},
+    {"uncertainty", "velocity", U(UNCERTAIN_VELOCITY), FPARSER_DOUBLE, 0, false},
+    {"uncertainty", "fuel_mass", U(UNCERTAIN_FUEL_MASS), FPARSER_DOUBLE, 0, false},
+    {"uncertainty", "dry_mass", U(UNCERTAIN_DRY_MASS), FPARSER_DOUBLE, 0, false},
+    {"uncertainty", "thrust", U(UNCERTAIN_THRUST), FPARSER_DOUBLE, 0, false},
+    {"uncertainty", "consumption", U(UNCERTAIN_CONSUMPTION), FPARSER_DOUBLE, 0, false},
+    {"uncertainty", "planet_mass", U(UNCERTAIN_PLANET_MASS), FPARSER_DOUBLE, 0, false},
+};
+
+#undef U
+
+int scenario_uncertainty_load(fparser_t *fp, scenario_uncertainty_t *u) {
+  if (fparser_bind(fp, scenario_uncertainty_bindings,
+                   sizeof(scenario_uncertainty_bindings) /
+                       sizeof(scenario_uncertainty_bindings[0]),
+                   u, stderr) != 0)
+    return -1;
+
+  for (int i = 0; i < UNCERTAIN_COUNT; i++)
+    if (u->sigma[i] < 0) {
+      display_fprintln(stderr, "%s: negative uncertainty '%s'", fp->filename,
+                       scenario_uncertainty_bindings[i].key);
+      return -1;
+    }
+
+  return 0;
+}
+
+// Augmented state of landing_lincov: altitude, velocity, fuel mass and the constant parameters
+// (UNCERTAIN_* order), followed by the state transition matrix ∂y/∂y0 in row-major order
+#define LINCOV_PHI(i, j) (UNCERTAIN_COUNT + (i) * UNCERTAIN_COUNT + (j))
+#define LINCOV_SIZE LINCOV_PHI(UNCERTAIN_COUNT, 0)
+
+// Derivative of the augmented state: the equations of motion of calculate_forces and their
+// Jacobian A times the state transition matrix
+static void lincov_derivative(const double *s, double thrust, double radius, double *d) {
+  double rz = radius + s[UNCERTAIN_ALTITUDE];
+  double mass = s[UNCERTAIN_DRY_MASS] + s[UNCERTAIN_FUEL_MASS];
+  double g = G * (s[UNCERTAIN_PLANET_MASS] * 1e24 / (rz * rz));
+  double a[UNCERTAIN_COUNT][UNCERTAIN_COUNT] = {{0}};
+
+  for (int i = 0; i < UNCERTAIN_COUNT; i++)
+    d[i] = 0;
+  d[UNCERTAIN_ALTITUDE] = s[UNCERTAIN_VELOCITY];
+  d[UNCERTAIN_VELOCITY] = s[UNCERTAIN_THRUST] * thrust / mass - g;
+  d[UNCERTAIN_FUEL_MASS] = -s[UNCERTAIN_CONSUMPTION] * thrust;
+
+  a[UNCERTAIN_ALTITUDE][UNCERTAIN_VELOCITY] = 1;
+  a[UNCERTAIN_VELOCITY][UNCERTAIN_ALTITUDE] = 2 * g / rz;
+  a[UNCERTAIN_VELOCITY][UNCERTAIN_FUEL_MASS] = -s[UNCERTAIN_THRUST] * thrust / (mass * mass);
+  a[UNCERTAIN_VELOCITY][UNCERTAIN_DRY_MASS] = a[UNCERTAIN_VELOCITY][UNCERTAIN_FUEL_MASS];
+  a[UNCERTAIN_VELOCITY][UNCERTAIN_THRUST] = thrust / mass;
+  a[UNCERTAIN_VELOCITY][UNCERTAIN_PLANET_MASS] = -g / s[UNCERTAIN_PLANET_MASS];
+  a[UNCERTAIN_FUEL_MASS][UNCERTAIN_CONSUMPTION] = -thrust;
+
+  for (int i = 0; i < UNCERTAIN_COUNT; i++)
+    for (int j = 0; j < UNCERTAIN_COUNT; j++) {
+      double sum = 0;
+      for (int k = 0; k < UNCERTAIN_COUNT; k++)
+        sum += a[i][k] * s[LINCOV_PHI(k, j)];
+      d[LINCOV_PHI(i, j)] = sum;
+    }
+}
+
+static void lincov_rk4(double *s, double thrust, double radius, double dt) {
+  double k[4][LINCOV_SIZE], stage[LINCOV_SIZE];
+  static const double c[4] = {0, 0.5, 0.5, 1};
+
+  lincov_derivative(s, thrust, radius, k[0]);
+  for (int n = 1; n < 4; n++) {
+    for (int i = 0; i < LINCOV_SIZE; i++)
+      stage[i] = s[i] + c[n] * dt * k[n - 1][i];
+    lincov_derivative(stage, thrust, radius, k[n]);
+  }
+
+  for (int i = 0; i < LINCOV_SIZE; i++)
+    s[i] += (dt / 6.0) * (k[0][i] + 2.0 * k[1][i] + 2.0 * k[2][i] + k[3][i]);
+}
+
+int landing_lincov(const scenario_params_t *params, const scenario_uncertainty_t *u,
+                   double ignition_time, double dt, landing_stats_t *out) {
+  if (!params || !u || !out || dt <= 0)
+    return -1;
+
+  double s[LINCOV_SIZE] = {0}, prev[LINCOV_SIZE];
+  s[UNCERTAIN_ALTITUDE] = params->altitude;
+  s[UNCERTAIN_FUEL_MASS] = params->fuel_mass;
+  s[UNCERTAIN_DRY_MASS] = params->dry_mass;
+  s[UNCERTAIN_THRUST] = params->eng.thrust;
+  s[UNCERTAIN_CONSUMPTION] = params->eng.consumption;
+  s[UNCERTAIN_PLANET_MASS] = params->pl.mass;
+  for (int i = 0; i < UNCERTAIN_COUNT; i++)
+    s[LINCOV_PHI(i, i)] = 1;
+
+  // Same control and stepping as hoverslam_simulation
+  double radius = params->pl.radius * 1e3, time = 0, thrust = 0;
+  while (s[UNCERTAIN_ALTITUDE] > 0) {
+    if (time >= ignition_time && thrust == 0 && s[UNCERTAIN_FUEL_MASS] > 0)
+      thrust = 1;
+
+    memcpy(prev, s, sizeof(s));
+    lincov_rk4(s, thrust, radius, dt);
+    time += dt;
+
+    if (s[UNCERTAIN_FUEL_MASS] <= 0) {
+      s[UNCERTAIN_FUEL_MASS] = 0;
+      thrust = 0;
+    }
+    if (s[UNCERTAIN_VELOCITY] > 0 && time > 1.0) // Flying away
+      return -1;
+  }
+
+  // Touchdown inside the last step, as in hoverslam_event_interpolator
+  double alpha = prev[UNCERTAIN_ALTITUDE] / (prev[UNCERTAIN_ALTITUDE] - s[UNCERTAIN_ALTITUDE]);
+  for (int i = 0; i < LINCOV_SIZE; i++)
+    s[i] = prev[i] + alpha * (s[i] - prev[i]);
+  time += (alpha - 1) * dt;
+
+  double f[LINCOV_SIZE];
+  lincov_derivative(s, thrust, radius, f);
+  if (f[UNCERTAIN_ALTITUDE] >= 0)
+    return -1;
+
+  // A dispersion moves the touchdown by dt = -dz / vz, the landing state moves along f with it
+  double j[LANDING_STATES][UNCERTAIN_COUNT];
+  for (int k = 0; k < UNCERTAIN_COUNT; k++) {
+    j[LANDING_TIME][k] = -s[LINCOV_PHI(UNCERTAIN_ALTITUDE, k)] / f[UNCERTAIN_ALTITUDE];
+    j[LANDING_VELOCITY][k] =
+        s[LINCOV_PHI(UNCERTAIN_VELOCITY, k)] + f[UNCERTAIN_VELOCITY] * j[LANDING_TIME][k];
+    j[LANDING_FUEL_MASS][k] =
+        s[LINCOV_PHI(UNCERTAIN_FUEL_MASS, k)] + f[UNCERTAIN_FUEL_MASS] * j[LANDING_TIME][k];
+  }
+
+  out->mean[LANDING_TIME] = time;
+  out->mean[LANDING_VELOCITY] = s[UNCERTAIN_VELOCITY];
+  out->mean[LANDING_FUEL_MASS] = s[UNCERTAIN_FUEL_MASS];
+  for (int a = 0; a < LANDING_STATES; a++)
+    for (int b = 0; b < LANDING_STATES; b++) {
+      double sum = 0;
+      for (int k = 0; k < UNCERTAIN_COUNT; k++)
+        sum += j[a][k] * j[b][k] * u->sigma[k] * u->sigma[k];
+      out->cov[a][b] = sum;
+    }
+
+  return 0;
+}
+
+void print_landing_stats(const char *title, const landing_stats_t *s) {
+  static const char *names[LANDING_STATES] = {"time", "velocity", "fuel_mass"};
+
+  display_println("%s", title);
+  display_println("state,mean,sigma");
+  for (int i = 0; i < LANDING_STATES; i++)
+    display_println("%s,%f,%f", names[i], s->mean[i], sqrt(s->cov[i][i]));
+
+  display_println("covariance,time,velocity,fuel_mass");
+  for (int i = 0; i < LANDING_STATES; i++)
+    display_println("%s,%e,%e,%e", names[i], s->cov[i][0], s->cov[i][1], s->cov[i][2]);
+}
+
+logger_t flight_log_open(const char *filename, bool binary, bool async) {
+  logger_format_t format = binary ? LOGGER_FORMAT_BINARY : LOGGER_FORMAT_CSV;
+
+#ifdef __linux__
+  if (async)
+    return logger_init_async(filename, format, 0);
+#else
+  (void)async;
+#endif
+
+  return logger_init_format(filename, format);
+}
+
+int flight_log_write(flight_log_t *log, rocket_t *r) {
+  if (!log)
+    return -1;
+
+  if (log->sl)
+    return shard_logger_write_rocket(log->sl, log->shard, log->scenario, r);
+
+  return logger_write_rocket(log->l, r);
+}
+
+int flight_log_begin(flight_log_t *log, rocket_t *r) {
+  if (!log)
+    return -1;
+
+  rocket_t start = *r; // No step has set the acceleration yet
+  start.acc = calculate_forces(&start);
+  aggregate_set_sample(log->stats, start.time, &start);
+
+  return 0;
+}
+
+int flight_log_step(flight_log_t *log, rocket_t *r) {
+  if (!log)
+    return -1;
+
+  aggregate_set_sample(log->stats, r->time, r);
+  if ((log->l || log->sl) && is_almost_integer(r->time, 0.01))
+    return flight_log_write(log, r);
+
+  return 0;
+}
+
+static double stats_speed(const void *obj) {
+  const rocket_t *r = (const rocket_t *)obj;
+  return sqrt(r->velocity.x * r->velocity.x + r->velocity.y * r->velocity.y +
+              r->velocity.z * r->velocity.z);
+}
+
+static double stats_acceleration(const void *obj) {
+  const rocket_t *r = (const rocket_t *)obj;
+  return sqrt(r->acc.x * r->acc.x + r->acc.y * r->acc.y + r->acc.z * r->acc.z);
+}
+
+static double stats_altitude(const void *obj) { return ((const rocket_t *)obj)->coords.z; }
+static double stats_fuel_mass(const void *obj) { return ((const rocket_t *)obj)->fuel_mass; }
+static double stats_thrust(const void *obj) { return ((const rocket_t *)obj)->thrust_percent; }
+
+void flight_stats_init(aggregate_set_t *s) {
+  static const double quantiles[] = {0.5, 0.95};
+
+  *s = (aggregate_set_t){0};
+  aggregate_set_add(s, "speed", stats_speed, AGGREGATE_MEAN | AGGREGATE_EXTREMES, quantiles, 2);
+  aggregate_set_add(s, "acceleration", stats_acceleration, AGGREGATE_MEAN | AGGREGATE_EXTREMES,
+                    quantiles, 2);
+  aggregate_set_add(s, "altitude", stats_altitude, AGGREGATE_EXTREMES, NULL, 0);
+  aggregate_set_add(s, "fuel_mass", stats_fuel_mass, AGGREGATE_ENDS, NULL, 0);
+  aggregate_set_add(s, "thrust", stats_thrust, AGGREGATE_MEAN, NULL, 0);
+  aggregate_set_reset(s);
+}
+
+int flight_stats_write(const char *filename, const aggregate_set_t *runs, int count,
+                       const fparser_deck_t *deck) {
+  if (!filename || !runs || count <= 0)
+    return -1;
+
+  // Any configured set gives the columns
+  const aggregate_set_t *layout = NULL;
+  for (int i = 0; i < count && !layout; i++)
+    if (runs[i].samples)
+      layout = &runs[i];
+  if (!layout)
+    return -1;
+
+  FILE *file = fopen(filename, "w");
+  if (!file)
+    return -1;
+
+  if (deck)
+    fprintf(file, "scenario,name,");
+  aggregate_set_write_header(layout, file);
+  fprintf(file, "\n");
+  for (int i = 0; i < count; i++) {
+    if (!runs[i].samples)
+      continue;
+    if (deck)
+      fprintf(file, "%d,%s,", i, deck->scenarios[i].name);
+    aggregate_set_write(&runs[i], file);
+    fprintf(file, "\n");
+  }
+
+  return ferror(file) | fclose(file) ? -1 : 0;
+}
+
+int flight_log_resample(const trajectory_t *tr, const rocket_t *r, double step,
+                        const char *filename, bool binary, const char *columns) {
+  if (!tr || !r || !filename)
+    return -1;
+
+  logger_t l = flight_log_open(filename, binary, false);
+  if (!l.file)
+    return -1;
+
+  long written = -1;
+  if (logger_select_columns(&l, rocket_log_columns, ROCKET_LOG_COLUMNS, columns) == 0)
+    written = trajectory_resample(tr, r, step, &l);
+  logger_free(&l);
+
+  if (written < 0)
+    return -1;
+
+  display_println("Trajectory: %zu steps(%.1f KiB), %ld states every %g s written to %s",
+                  tr->count, tr->count * sizeof(trajectory_step_t) / 1024.0, written, step,
+                  filename);
+
+  return 0;
+}
+
+void print_deck_stats(const double *columns, int count, int stride, int rows, int skip) {
+  if (!columns || rows <= 0)
+    return;
+
+  char mean[MAX_LINE] = "mean", std[MAX_LINE] = "std";
+  size_t m = strlen(mean), s = strlen(std);
+  for (int i = 0; i < skip; i++) {
+    m += snprintf(mean + m, sizeof(mean) - MIN(m, sizeof(mean)), ",");
+    s += snprintf(std + s, sizeof(std) - MIN(s, sizeof(std)), ",");
+  }
+
+  for (int c = 0; c < count; c++) {
+    const double *values = columns + (size_t)c * stride;
+    double mu = reduce_mean(values, rows);
+    m += snprintf(mean + m, sizeof(mean) - MIN(m, sizeof(mean)), ",%f", mu);
+    s += snprintf(std + s, sizeof(std) - MIN(s, sizeof(std)), ",%f",
+                  sqrt(reduce_variance(values, rows, mu)));
+  }
+
+  display_println("%s", mean);
+  display_println("%s", std);
+}
+
+typedef struct deck_job_t {
+  const fparser_deck_t *deck;
+  const deck_sim_t *sim;
+  shard_logger_t *sl; // NULL if not logging
+  char *results;
+  const char **errors;        // NULL if the scenario landed
+  aggregate_set_t *summaries; // NULL if not summarizing
+
+} deck_job_t;
+
+static void deck_scenario(void *ctx, size_t i, int worker) {
+  deck_job_t *job = (deck_job_t *)ctx;
+  scenario_params_t params = {0};
+
+  if (scenario_params_load_deck(job->deck, (int)i, &params) != 0) {
+    job->errors[i] = "invalid parameters";
+    return;
+  }
+
+  rocket_t *r = start_falling(params.dry_mass, params.fuel_mass, params.altitude, params.eng,
+                              params.pl);
+  if (!r) {
+    job->errors[i] = "out of memory";
+    return;
+  }
+
+  if (!is_enough_deltav(r)) {
+    job->errors[i] = "not enough delta-v";
+    rocket_free(r);
+    return;
+  }
+
+  simulator_t scene = falling_scene(r, job->sim->dt);
+  flight_log_t log = {.sl = job->sl, .shard = worker, .scenario = i};
+  if (job->summaries) {
+    flight_stats_init(&job->summaries[i]);
+    log.stats = &job->summaries[i];
+  }
+  job->sim->run(job->sim->ctx, &scene, &params, job->sl || job->summaries ? &log : NULL,
+                job->results + i * job->sim->result_size);
+
+  rocket_free(r);
+}
+
+int run_deck(fparser_t *fp, const deck_sim_t *sim, int threads, int processes,
+             const topology_t *topo, const char *summary, logger_t *l) {
+  if (!sim || sim->column_count <= 0 || sim->column_count > DECK_MAX_COLUMNS)
+    return -1;
+
+  fparser_deck_t deck = fparser_deck_init(fp, stderr);
+  if (deck.scenario_count == 0)
+    return -1;
+
+  int n = deck.scenario_count, columns = sim->column_count, result = 0, landed = 0;
+  bool shared = processes > 0; // Tables written by the workers
+  char *results = shared ? (char *)procs_alloc(n * sim->result_size)
+                         : (char *)calloc(n, sim->result_size);
+  const char **errors = shared ? (const char **)procs_alloc(n * sizeof(char *))
+                               : (const char **)calloc(n, sizeof(char *));
+  aggregate_set_t *summaries =
+      !summary ? NULL
+      : shared ? (aggregate_set_t *)procs_alloc(n * sizeof(aggregate_set_t))
+               : (aggregate_set_t *)calloc(n, sizeof(aggregate_set_t));
+  bool *completed = (bool *)calloc(n, sizeof(bool));
+  double *stats = (double *)malloc(columns * n * sizeof(double)); // Summary columns
+  pool_t *pool = shared ? NULL : pool_create_pinned(threads, topo);
+  int workers = shared ? processes : pool ? pool_threads(pool) : 0;
+  shard_logger_t sl = {0};
+  if (l && workers)
+    sl = shard_logger_init(workers, ROCKET_LOG_HEADER);
+
+  if (!results || !errors || !completed || !stats || !workers || (l && !sl.shards) ||
+      (summary && !summaries)) {
+    result = -1;
+    goto cleanup;
+  }
+
+  deck_job_t job = {&deck, sim, l ? &sl : NULL, results, errors, summaries};
+  if (shared) {
+    procs_for(processes, n, deck_scenario, &job, topo, completed);
+    for (int i = 0; i < n; i++)
+      if (!completed[i])
+        errors[i] = "worker process died";
+  } else
+    pool_for(pool, n, deck_scenario, &job);
+
+  if (l && shard_logger_merge(&sl, l) < 0)
+    display_fprintln(stderr, "Failed to merge the logs of the scenarios");
+
+  char line[MAX_LINE], empty[DECK_MAX_COLUMNS + 1] = {0}; // Result columns of a failed scenario
+  double row[DECK_MAX_COLUMNS];
+  memset(empty, ',', columns);
+
+  display_println("scenario,name,status,%s", sim->header);
+  for (int i = 0; i < n; i++) {
+    if (errors[i]) {
+      if (summaries)
+        summaries[i].samples = 0; // A worker may have died during the flight
+      display_println("%d,%s,%s%s", i, deck.scenarios[i].name, errors[i], empty);
+      result = -1;
+      continue;
+    }
+    sim->columns(results + i * sim->result_size, line, sizeof(line), row);
+    display_println("%d,%s,ok,%s", i, deck.scenarios[i].name, line);
+
+    // Columns of the landed scenarios, in scenario order
+    for (int c = 0; c < columns; c++)
+      stats[c * n + landed] = row[c];
+    landed++;
+  }
+  print_deck_stats(stats, columns, n, landed, 2);
+
+  if (summary && flight_stats_write(summary, summaries, n, &deck) != 0)
+    display_fprintln(stderr, "Failed to write the summary of the scenarios");
+
+cleanup:
+  if (sl.shards)
+    shard_logger_free(&sl);
+  pool_free(pool);
+  if (shared) {
+    procs_free(results);
+    procs_free(errors);
+    procs_free(summaries);
+  } else {
+    free(results);
+    free(errors);
+    free(summaries);
+  }
+  free(completed);
+  free(stats);
+
+  return result;
 }
@@ -0,0 +1,154 @@
+#define _POSIX_C_SOURCE 200809L
+#define DISPLAY_IMPLEMENTATION
+#define DISPLAY_STRIP_PREFIX
+#include "common.h"
+
+/// Reduces a binary log to the rows worth drawing for one column(log_reader_downsample) and
+/// writes them as a smaller log with all columns, which plot and stats.py read as usual
+
+// Index of a column given by its header name or its key(rocket and PID columns), -1 if none
+static int find_column(const log_reader_t *lr, const char *name) {
+  int index = log_reader_column_index(lr, name);
+  for (int i = 0; index < 0 && i < ROCKET_LOG_COLUMNS; i++)
+    if (strcmp(rocket_log_columns[i].key, name) == 0)
+      index = log_reader_column_index(lr, rocket_log_columns[i].header);
+  for (int i = 0; index < 0 && i < PID_LOG_COLUMNS; i++)
+    if (strcmp(pid_log_columns[i].key, name) == 0)
+      index = log_reader_column_index(lr, pid_log_columns[i].header);
+
+  return index;
+}
+
+static int write_rows(logger_t *out, const log_reader_t *lr, const size_t *rows, long count) {
+  if (out->format == LOGGER_FORMAT_BINARY) {
+    if (logger_write_binary_header(out, lr->column_names) != 0)
+      return -1;
+    for (long i = 0; i < count; i++)
+      if (logger_write_binary_row(out, log_reader_row(lr, rows[i])) < 0)
+        return -1;
+    return 0;
+  }
+
+  if (fprintf(out->file, "%s\n", lr->column_names) < 0)
+    return -1;
+  for (long i = 0; i < count; i++) {
+    const double *row = log_reader_row(lr, rows[i]);
+    for (size_t k = 0; k < lr->cols; k++)
+      if (fprintf(out->file, k ? ",%.3f" : "%.3f", row[k]) < 0)
+        return -1;
+    if (putc('\n', out->file) == EOF)
+      return -1;
+  }
+
+  return 0;
+}
+
+void usage() {
+  puts("Usage: downsample [OPTIONS] <log.rlog>\n"
+       "OPTIONS:\n"
+       "--column <name>\t\tColumn whose plot is kept, a header name or a key like\n"
+       "\t\t\taltitude(default is altitude)\n"
+       "--x <name>\t\tColumn it is plotted against(default is time)\n"
+       "--points <number>\tRows to keep(default is 1000)\n"
+       "--method <name>\t\tlttb or minmax(default is lttb)\n"
+       "--output <file>\t\tFile to write(default is <log>_downsampled.csv)\n"
+       "--binary\t\tWrite the output in binary format(.rlog)\n"
+       "-h\t\t\tPrint this help message");
+}
+
+int main(int argc, char *argv[]) {
+  char *column = "altitude", *x_column = "time", *output = NULL, *input = NULL;
+  int points = 1000;
+  bool to_binary = false;
+  log_downsample_t method = LOG_DOWNSAMPLE_LTTB;
+
+  // Parsing cmd args
+  for (int i = 1; i < argc; i++) {
+    char *token = argv[i];
+    if (strcmp(token, "-h") == 0) {
+      usage();
+      return 0;
+    } else if (strcmp(token, "--column") == 0 || strcmp(token, "--x") == 0 ||
+               strcmp(token, "--output") == 0 || strcmp(token, "--method") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      char *value = argv[++i];
+      if (strcmp(token, "--column") == 0)
+        column = value;
+      else if (strcmp(token, "--x") == 0)
+        x_column = value;
+      else if (strcmp(token, "--output") == 0)
+        output = value;
+      else if (strcmp(value, "lttb") == 0)
+        method = LOG_DOWNSAMPLE_LTTB;
+      else if (strcmp(value, "minmax") == 0)
+        method = LOG_DOWNSAMPLE_MINMAX;
+      else {
+        fprintln(stderr, "Invalid value : %s", value);
+        return -1;
+      }
+    } else if (strcmp(token, "--points") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      if ((points = atoi(argv[++i])) < 3) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+    } else if (strcmp(token, "--binary") == 0)
+      to_binary = true;
+    else if (strncmp(token, "--", 2) == 0 || input) {
+      println("Unknown flag: %s", token);
+      return -1;
+    } else
+      input = token;
+  }
+
+  if (!input) {
+    usage();
+    return -1;
+  }
+
+  log_reader_t lr = log_reader_open(input);
+  if (!lr.map) {
+    fprintln(stderr, "'%s' isn't a binary log(write it with --binary)", input);
+    return -1;
+  }
+
+  int x = find_column(&lr, x_column), y = find_column(&lr, column);
+  if (x < 0 || y < 0) {
+    fprintln(stderr, "No column '%s' in '%s'", x < 0 ? x_column : column, input);
+    log_reader_close(&lr);
+    return -1;
+  }
+
+  char name[MAX_LINE];
+  if (!output) {
+    const char *dot = strrchr(input, '.');
+    int length = dot ? (int)(dot - input) : (int)strlen(input);
+    snprintf(name, sizeof(name), "%.*s_downsampled%s", length, input,
+             to_binary ? ".rlog" : ".csv");
+    output = name;
+  }
+
+  size_t *rows = (size_t *)malloc(sizeof(size_t) * points);
+  long count = rows ? log_reader_downsample(&lr, x, y, points, method, rows) : -1;
+  logger_t out =
+      logger_init_format(output, to_binary ? LOGGER_FORMAT_BINARY : LOGGER_FORMAT_CSV);
+  int result = count >= 0 && out.file ? write_rows(&out, &lr, rows, count) : -1;
+
+  if (out.file && logger_free(&out) != 0)
+    result = -1;
+  if (result == 0)
+    println("Kept %ld of %zu rows in %s", count, lr.rows, output);
+  else
+    fprintln(stderr, "Can't write '%s'", output);
+
+  free(rows);
+  log_reader_close(&lr);
+
+  return result;
+}
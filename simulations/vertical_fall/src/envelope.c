@@ -0,0 +1,516 @@
+#define _POSIX_C_SOURCE 200809L
+#define DISPLAY_IMPLEMENTATION
+#define DISPLAY_STRIP_PREFIX
+#include "common.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Maps which (altitude, fuel_mass, thrust) combinations land safely. The box is split into a
+/// coarse grid of cells and only the cells whose corners disagree are split again(octree), so
+/// the scenarios are flown near the border of the envelope only. A corner which lacks the
+/// delta-v for a hoverslam(is_enough_deltav) fails without a flight
+
+#define AXES 3
+
+static const int axis_inputs[AXES] = {SURROGATE_ALTITUDE, SURROGATE_FUEL_MASS, SURROGATE_THRUST};
+static const char *axis_names[AXES] = {"altitude", "fuel_mass", "thrust"};
+
+typedef struct box_t {
+  double lo[AXES], hi[AXES];
+
+} box_t;
+
+#define B(field) offsetof(box_t, field)
+
+// [envelope] section: range of every axis, 0.1 to 2 times [rocket] and [engine] if not set
+static const fparser_binding_t box_bindings[] = {
+    {"envelope", "altitude_min", B(lo[0]), FPARSER_DOUBLE, 0, false},
+    {"envelope", "altitude_max", B(hi[0]), FPARSER_DOUBLE, 0, false},
+    {"envelope", "fuel_mass_min", B(lo[1]), FPARSER_DOUBLE, 0, false},
+    {"envelope", "fuel_mass_max", B(hi[1]), FPARSER_DOUBLE, 0, false},
+    {"envelope", "thrust_min", B(lo[2]), FPARSER_DOUBLE, 0, false},
+    {"envelope", "thrust_max", B(hi[2]), FPARSER_DOUBLE, 0, false},
+};
+
+#undef B
+
+/// @brief Reads the box to map
+/// @return 0 on success or -1 on failure
+int load_box(fparser_t *fp, const scenario_params_t *params, box_t *box) {
+  if (fparser_bind(fp, box_bindings, sizeof(box_bindings) / sizeof(box_bindings[0]), box,
+                   stderr) != 0)
+    return -1;
+
+  double base[AXES] = {params->altitude, params->fuel_mass, params->eng.thrust};
+  for (int k = 0; k < AXES; k++) {
+    if (box->lo[k] == 0 && box->hi[k] == 0) {
+      box->lo[k] = 0.1 * base[k];
+      box->hi[k] = 2 * base[k];
+    }
+    if (box->lo[k] <= 0 || box->hi[k] <= box->lo[k]) {
+      fprintln(stderr, "Invalid range of %s: [%f, %f]", axis_names[k], box->lo[k], box->hi[k]);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+// Outcomes of a corner
+#define CORNER_NO_DELTAV 0 // Decided by the bound, not flown
+#define CORNER_CRASH 1     // Flown, landed faster than --max-velocity or flew away
+#define CORNER_SAFE 2
+
+/**
+ * @struct lattice_t
+ * @brief Corners evaluated so far. Corners are points of the finest grid, `n` per axis, and are
+ * found by an open addressing hash table of their packed indices
+ *
+ */
+typedef struct lattice_t {
+  uint64_t n;
+  uint64_t *keys; // Packed index + 1, 0 if the slot is empty
+  int *slots;     // Index into the arrays below
+  size_t capacity;
+
+  uint64_t *points; // Packed indices in the order of evaluation
+  signed char *outcomes;
+  size_t count, allocated;
+
+} lattice_t;
+
+static uint64_t pack(const lattice_t *lt, const uint64_t *index) {
+  return (index[0] * lt->n + index[1]) * lt->n + index[2];
+}
+
+static void unpack(const lattice_t *lt, uint64_t key, uint64_t *index) {
+  index[2] = key % lt->n;
+  index[1] = key / lt->n % lt->n;
+  index[0] = key / lt->n / lt->n;
+}
+
+static size_t slot_of(const lattice_t *lt, uint64_t key) {
+  uint64_t h = (key + 1) * 0x9E3779B97F4A7C15u; // Fibonacci hashing
+  size_t i = (size_t)(h >> 20) & (lt->capacity - 1);
+  while (lt->keys[i] && lt->keys[i] != key + 1)
+    i = (i + 1) & (lt->capacity - 1);
+
+  return i;
+}
+
+static int lattice_grow(lattice_t *lt) {
+  lattice_t bigger = *lt;
+  bigger.capacity = lt->capacity ? 2 * lt->capacity : 1024;
+  bigger.keys = (uint64_t *)calloc(bigger.capacity, sizeof(uint64_t));
+  bigger.slots = (int *)malloc(sizeof(int) * bigger.capacity);
+  if (!bigger.keys || !bigger.slots) {
+    free(bigger.keys);
+    free(bigger.slots);
+    return -1;
+  }
+
+  for (size_t i = 0; i < lt->capacity; i++)
+    if (lt->keys[i]) {
+      size_t s = slot_of(&bigger, lt->keys[i] - 1);
+      bigger.keys[s] = lt->keys[i];
+      bigger.slots[s] = lt->slots[i];
+    }
+  free(lt->keys);
+  free(lt->slots);
+  *lt = bigger;
+
+  return 0;
+}
+
+/// @return Index of the corner, added to the pending ones if it is new, or -1 on failure
+static int lattice_find(lattice_t *lt, const uint64_t *index) {
+  if (2 * (lt->count + 1) > lt->capacity && lattice_grow(lt) != 0)
+    return -1;
+
+  uint64_t key = pack(lt, index);
+  size_t s = slot_of(lt, key);
+  if (lt->keys[s])
+    return lt->slots[s];
+
+  if (lt->count == lt->allocated) {
+    size_t allocated = lt->allocated ? 2 * lt->allocated : 1024;
+    uint64_t *points = (uint64_t *)realloc(lt->points, sizeof(uint64_t) * allocated);
+    if (points)
+      lt->points = points;
+    signed char *outcomes = (signed char *)realloc(lt->outcomes, allocated);
+    if (outcomes)
+      lt->outcomes = outcomes;
+    if (!points || !outcomes)
+      return -1;
+    lt->allocated = allocated;
+  }
+
+  lt->keys[s] = key + 1;
+  lt->slots[s] = (int)lt->count;
+  lt->points[lt->count] = key;
+  lt->outcomes[lt->count] = -1;
+
+  return (int)lt->count++;
+}
+
+static void lattice_free(lattice_t *lt) {
+  free(lt->keys);
+  free(lt->slots);
+  free(lt->points);
+  free(lt->outcomes);
+  *lt = (lattice_t){0};
+}
+
+/**
+ * @struct cell_t
+ * @brief Cube of the octree: lowest corner and edge in points of the finest grid
+ *
+ */
+typedef struct cell_t {
+  uint64_t corner[AXES];
+  uint64_t size;
+  int corners[8]; // Indices into the lattice, bit k of the position is the upper side of axis k
+
+} cell_t;
+
+typedef struct corner_job_t {
+  const scenario_params_t *params;
+  const box_t *box;
+  const lattice_t *lt;
+  double dt, eps, max_velocity;
+
+} corner_job_t;
+
+static double coordinate(const corner_job_t *job, int axis, uint64_t index) {
+  return job->box->lo[axis] +
+         (job->box->hi[axis] - job->box->lo[axis]) * (double)index / (double)(job->lt->n - 1);
+}
+
+static void evaluate_corner(void *ctx, size_t i, int worker) {
+  (void)worker;
+  corner_job_t *job = (corner_job_t *)ctx;
+  const lattice_t *lt = job->lt;
+
+  uint64_t index[AXES];
+  unpack(lt, lt->points[i], index);
+
+  double in[SURROGATE_INPUTS] = {0};
+  in[SURROGATE_DRY_MASS] = job->params->dry_mass;
+  in[SURROGATE_CONSUMPTION] = job->params->eng.consumption;
+  for (int k = 0; k < AXES; k++)
+    in[axis_inputs[k]] = coordinate(job, k, index[k]);
+
+  rocket_t r = {.engine = {in[SURROGATE_THRUST], in[SURROGATE_CONSUMPTION]},
+                .pl = job->params->pl,
+                .coords = {0, 0, in[SURROGATE_ALTITUDE]},
+                .dry_mass = in[SURROGATE_DRY_MASS],
+                .fuel_mass = in[SURROGATE_FUEL_MASS]};
+  if (!is_enough_deltav(&r)) {
+    lt->outcomes[i] = CORNER_NO_DELTAV;
+    return;
+  }
+
+  double out[SURROGATE_OUTPUTS];
+  bool lands = landing_outcome(&job->params->pl, in, job->dt, job->eps, out);
+  lt->outcomes[i] = lands && fabs(out[SURROGATE_VELOCITY]) <= job->max_velocity ? CORNER_SAFE
+                                                                                 : CORNER_CRASH;
+}
+
+/// @brief Finds the corners of the cells, flies the new ones and counts the safe corners
+/// @return 0 on success or -1 on failure
+static int evaluate_cells(pool_t *pool, corner_job_t *job, lattice_t *lt, cell_t *cells,
+                          size_t count, int *safe) {
+  size_t first = lt->count;
+  for (size_t c = 0; c < count; c++)
+    for (int b = 0; b < 8; b++) {
+      uint64_t index[AXES];
+      for (int k = 0; k < AXES; k++)
+        index[k] = cells[c].corner[k] + ((b >> k) & 1) * cells[c].size;
+      if ((cells[c].corners[b] = lattice_find(lt, index)) < 0)
+        return -1;
+    }
+
+  // Only the corners added by this level are pending, the rest are shared with earlier cells
+  corner_job_t pending = *job;
+  lattice_t view = *lt;
+  view.points += first;
+  view.outcomes += first;
+  pending.lt = &view;
+  pool_for(pool, lt->count - first, evaluate_corner, &pending);
+
+  for (size_t c = 0; c < count; c++) {
+    safe[c] = 0;
+    for (int b = 0; b < 8; b++)
+      safe[c] += lt->outcomes[cells[c].corners[b]] == CORNER_SAFE;
+  }
+
+  return 0;
+}
+
+/// @brief Writes the cells left on the border after the last level, with their number of safe
+/// corners
+static int write_cells(const char *filename, const corner_job_t *job, const cell_t *cells,
+                       const int *safe, size_t count) {
+  FILE *file = fopen(filename, "w");
+  if (!file)
+    return -1;
+
+  fprintf(file, "altitude_min,altitude_max,fuel_mass_min,fuel_mass_max,thrust_min,thrust_max,"
+                "safe_corners\n");
+  for (size_t c = 0; c < count; c++) {
+    for (int k = 0; k < AXES; k++)
+      fprintf(file, "%.6f,%.6f,", coordinate(job, k, cells[c].corner[k]),
+              coordinate(job, k, cells[c].corner[k] + cells[c].size));
+    fprintf(file, "%d\n", safe[c]);
+  }
+
+  return ferror(file) | fclose(file) ? -1 : 0;
+}
+
+/// @brief Writes the boundary surface as points: the middle of every edge of a border cell whose
+/// ends disagree(each edge once), with the side of the lower end
+static int write_surface(const char *filename, const corner_job_t *job, const lattice_t *lt,
+                         const cell_t *cells, size_t count) {
+  FILE *file = fopen(filename, "w");
+  if (!file)
+    return -1;
+
+  // Edges are found by their middle, a point of a grid twice as fine
+  lattice_t edges = {.n = 2 * lt->n - 1};
+  int result = 0, points = 0;
+
+  fprintf(file, "altitude,fuel_mass,thrust,safe_below\n");
+  for (size_t c = 0; c < count && result == 0; c++)
+    for (int b = 0; b < 8 && result == 0; b++)
+      for (int k = 0; k < AXES; k++) {
+        if ((b >> k) & 1)
+          continue;
+        bool lower = lt->outcomes[cells[c].corners[b]] == CORNER_SAFE;
+        bool upper = lt->outcomes[cells[c].corners[b | (1 << k)]] == CORNER_SAFE;
+        if (lower == upper)
+          continue;
+
+        uint64_t middle[AXES];
+        for (int m = 0; m < AXES; m++)
+          middle[m] = 2 * (cells[c].corner[m] + ((b >> m) & 1) * cells[c].size) +
+                      (m == k ? cells[c].size : 0);
+        size_t before = edges.count;
+        if (lattice_find(&edges, middle) < 0) {
+          result = -1;
+          break;
+        }
+        if (edges.count == before)
+          continue;
+
+        double x[AXES];
+        for (int m = 0; m < AXES; m++)
+          x[m] = job->box->lo[m] +
+                 (job->box->hi[m] - job->box->lo[m]) * (double)middle[m] / (double)(edges.n - 1);
+        fprintf(file, "%.6f,%.6f,%.6f,%d\n", x[0], x[1], x[2], lower);
+        points++;
+      }
+
+  lattice_free(&edges);
+  if (ferror(file) | fclose(file))
+    result = -1;
+
+  return result == 0 ? points : -1;
+}
+
+void usage() {
+  puts("OPTIONS:\n"
+       "--rocket <file>\t\tSpecify file with simulation parameters and [envelope] ranges\n"
+       "--grid <number>\t\tCells per axis of the coarse grid(default is 4)\n"
+       "--depth <number>\tTimes a border cell is split in eight(default is 3)\n"
+       "--max-velocity <number>\tFastest safe landing(m/s, default is 10)\n"
+       "--threads <number>\tWorker threads(default is one per CPU)\n"
+       "--no-pin\t\tDon't pin the workers to CPUs\n"
+       "--dt <number>\t\tChange dt variable(default is 2e-3)\n"
+       "--eps <number>\t\tChange eps variable(default is 1e-4)\n"
+       "-h\t\t\tPrint this help message");
+}
+
+int main(int argc, char *argv[]) {
+  double dt = 2e-3, eps = 1e-4, max_velocity = 10;
+  int grid = 4, depth = 3, threads = 0;
+  bool to_pin = true;
+  char *rocket_file = "rocket.dat";
+
+  // Parsing cmd args
+  for (int i = 1; i < argc; i++) {
+    char *token = argv[i];
+    if (strcmp(token, "-h") == 0) {
+      usage();
+      return 0;
+    } else if (strcmp(token, "--dt") == 0 || strcmp(token, "--eps") == 0 ||
+               strcmp(token, "--max-velocity") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      double value = atof(argv[++i]);
+      if (value <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--dt") == 0)
+        dt = value;
+      else if (strcmp(token, "--eps") == 0)
+        eps = value;
+      else
+        max_velocity = value;
+    } else if (strcmp(token, "--grid") == 0 || strcmp(token, "--depth") == 0 ||
+               strcmp(token, "--threads") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      int value = atoi(argv[++i]);
+      if (value <= 0 || (strcmp(token, "--threads") != 0 && value > 16)) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--grid") == 0)
+        grid = value;
+      else if (strcmp(token, "--depth") == 0)
+        depth = value;
+      else
+        threads = value;
+    } else if (strcmp(token, "--rocket") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      rocket_file = argv[++i];
+    } else if (strcmp(token, "--no-pin") == 0)
+      to_pin = false;
+    else {
+      println("Unknown flag: %s", token);
+      return -1;
+    }
+  }
+
+  // Parsing 'rocket_file' file
+  fparser_t fp = fparser_init(rocket_file);
+  if (!fp.file) {
+    fprintln(stderr, "No '%s' file was found!", rocket_file);
+    return -1;
+  }
+
+  fparser_parse(&fp);
+  fparser_free(&fp);
+
+  scenario_params_t params = {0};
+  box_t box = {0};
+  if (scenario_params_load(&fp, &params) != 0 || load_box(&fp, &params, &box) != 0) {
+    fprintln(stderr, "Invalid '%s' file!", rocket_file);
+    return -1;
+  }
+
+  uint64_t size = 1ull << depth; // Coarse cell in points of the finest grid
+  lattice_t lt = {.n = (uint64_t)grid * size + 1};
+  corner_job_t job = {&params, &box, &lt, dt, eps, max_velocity};
+
+  size_t count = (size_t)grid * grid * grid;
+  cell_t *cells = (cell_t *)malloc(sizeof(cell_t) * count);
+  int *safe = (int *)malloc(sizeof(int) * count);
+  topology_t topo = to_pin ? topology_detect() : (topology_t){0};
+  pool_t *pool = pool_create_pinned(threads, &topo);
+  assert(cells && safe && pool);
+
+  for (size_t c = 0; c < count; c++)
+    cells[c] = (cell_t){.corner = {c / grid / grid * size, c / grid % grid * size, c % grid * size},
+                        .size = size};
+
+  // Volume of the box in finest cells that is safe: whole cells, and the safe share of the
+  // corners of the border cells after the last level
+  double safe_volume = 0;
+  int result = 0;
+  double start = bench_now();
+
+  println("level,cells,border_cells,new_corners");
+  for (int level = 0; level <= depth; level++) {
+    size_t before = lt.count;
+    if (evaluate_cells(pool, &job, &lt, cells, count, safe) != 0) {
+      result = -1;
+      break;
+    }
+
+    // Border cells are kept in place, or split into the cells of the next level
+    size_t border = 0;
+    for (size_t c = 0; c < count; c++) {
+      double volume = (double)cells[c].size * cells[c].size * cells[c].size;
+      if (safe[c] == 8)
+        safe_volume += volume;
+      else if (safe[c] > 0) {
+        if (level == depth)
+          safe_volume += volume * safe[c] / 8;
+        cells[border] = cells[c];
+        safe[border++] = safe[c];
+      }
+    }
+    println("%d,%zu,%zu,%zu", level, count, border, lt.count - before);
+
+    count = border;
+    if (level == depth || border == 0)
+      break;
+
+    cell_t *next = (cell_t *)malloc(sizeof(cell_t) * 8 * border);
+    int *next_safe = (int *)realloc(safe, sizeof(int) * 8 * border);
+    if (next_safe)
+      safe = next_safe;
+    if (!next || !next_safe) {
+      free(next);
+      result = -1;
+      break;
+    }
+    for (size_t c = 0; c < border; c++)
+      for (int b = 0; b < 8; b++) {
+        uint64_t half = cells[c].size / 2;
+        next[8 * c + b] = (cell_t){.corner = {cells[c].corner[0] + (b & 1) * half,
+                                              cells[c].corner[1] + ((b >> 1) & 1) * half,
+                                              cells[c].corner[2] + ((b >> 2) & 1) * half},
+                                   .size = half};
+      }
+    free(cells);
+    cells = next;
+    count = 8 * border;
+  }
+  double elapsed = bench_now() - start;
+
+  pool_free(pool);
+  topology_free(&topo);
+
+  if (result == 0) {
+    size_t flown = 0;
+    for (size_t i = 0; i < lt.count; i++)
+      flown += lt.outcomes[i] != CORNER_NO_DELTAV;
+    double uniform = (double)lt.n * lt.n * lt.n;
+    double finest = (double)(lt.n - 1) * (lt.n - 1) * (lt.n - 1);
+
+    println("%zu corners in %.3f s on %d threads: %zu flown, %zu ruled out by delta-v", lt.count,
+            elapsed, threads > 0 ? threads : pool_default_threads(), flown, lt.count - flown);
+    println("A uniform grid of the same resolution has %.0f corners(%.1f%% evaluated)", uniform,
+            100 * lt.count / uniform);
+    println("Safe share of the box: %.2f%%", 100 * safe_volume / finest);
+
+    int points = -1;
+    if (write_cells("envelope_cells.csv", &job, cells, safe, count) != 0 ||
+        (points = write_surface("envelope_surface.csv", &job, &lt, cells, count)) < 0) {
+      fprintln(stderr, "Failed to write the envelope");
+      result = -1;
+    } else
+      println("%zu border cells written to envelope_cells.csv, %d surface points to "
+              "envelope_surface.csv",
+              count, points);
+  } else
+    fprintln(stderr, "Out of memory");
+
+  lattice_free(&lt);
+  free(cells);
+  free(safe);
+
+  return result;
+}
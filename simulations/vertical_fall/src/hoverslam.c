@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include <rocketlib/logger.h>
 #include <rocketlib/simulator.h>
 #define DISPLAY_IMPLEMENTATION
@@ -13,102 +14,17 @@ typedef struct result_t {
 
 } result_t;
 
-/// @brief Simulate a flight where the engine ignites after a specified time
-/// Used for calculating the time of a hoverslam in
-/// golden_search_hoverslam
-/// @return Velocity at landing/crash
-double velocity_at_landing(simulator_t *scene, double ignition_time) {
-  event_type_t event = EV_NONE;
-  rocket_t prev;
-  rocket_t *r = (rocket_t *)scene->object;
-
-  while (event != EV_GROUND_CONTACT) {
-    if (scene->time >= ignition_time && r->thrust_percent == 0)
-      CHANGE_THRUST(*r, 1);
-
-    prev = *r;
-    scene->take_step(scene);
-    event = scene->event_detector(scene, &prev);
-
-    if (event == EV_UNSTABLE || r->coords.z <= 0)
-      break;
-  }
-
-  scene->event_interpolator(scene, &prev, event);
-
-  double result = fabs(r->velocity.z);
-
-  scene->time = 0;
-
-  return result;
-}
-
-/// @brief Find the best time to ignite the engine using a golden-section
-/// search. Treats velocity_at_landing as a function to be minimized
-/// @param eps Precision
-/// @return Time to start the engine
-double golden_search_hoverslam(simulator_t *scene, double eps) {
-  rocket_t r = *(rocket_t *)scene->object;
-  double time = scene->time, dt = scene->dt;
-
-  double g = calculate_g(r), phi = (1 + sqrt(5)) / 2; // φ ≈ 1.618
-  double right = sqrt((r.coords.z * 2) / g), left = 0;
-  double m1 = right - (right - left) / phi, m2 = left + (right - left) / phi;
-  double f_m1 = velocity_at_landing(scene, m1);
-  scene->dt = dt;
-  scene->time = time;
-  *(rocket_t *)scene->object = r;
-
-  double f_m2 = velocity_at_landing(scene, m2);
-  scene->dt = dt;
-  scene->time = time;
-  *(rocket_t *)scene->object = r;
-
-  while (right - left > eps) {
-    scene->dt = dt;
-    scene->time = time;
-    *(rocket_t *)scene->object = r;
-
-    if (f_m1 < f_m2) {
-      right = m2;
-      m2 = m1;
-      m1 = right - (right - left) / phi;
-
-      f_m2 = f_m1;
-      f_m1 = velocity_at_landing(scene, m1);
-
-    } else {
-      left = m1;
-      m1 = m2;
-      m2 = left + (right - left) / phi;
-
-      f_m1 = f_m2;
-      f_m2 = velocity_at_landing(scene, m2);
-    }
-  }
-
-  scene->dt = dt;
-  scene->time = time;
-  *(rocket_t *)scene->object = r;
-
-  return (left + right) / 2;
-}
-
 /// @brief Simulate landing with a hoverslam.
 /// The time to ignite is found by the golden_search_hoverslam function
 /// @param eps Precision for the search algorithm
 /// @param print Print data during flight?
-/// @param log Log simulation data to a file?
+/// @param log Destination of simulation data or NULL
+/// @param watch Config watcher or NULL. Planet and engine changes are applied between steps,
+/// and the time to ignite is searched again if the engine is still off
 /// @return The struct of time to start the burn, rocket stats after land and
 /// number of iterations during simulation
-result_t hoverslam_simulation(simulator_t *scene, double eps, bool print, bool log) {
-  logger_t l = (logger_t){NULL, NULL};
-  if (log) {
-    l = logger_init("hoverslam_sim.csv");
-    assert(l.file);
-    fprintln(l.file, ROCKET_LOG_HEADER);
-  }
-
+result_t hoverslam_simulation(simulator_t *scene, double eps, bool print, flight_log_t *log,
+                              config_watch_t *watch, scenario_params_t *params) {
   double time_to_burn = golden_search_hoverslam(scene, eps);
 
   int it = 0;
@@ -116,8 +32,17 @@ result_t hoverslam_simulation(simulator_t *scene, double eps, bool print, bool l
   rocket_t *r = (rocket_t *)scene->object;
   rocket_t prev;
 
+  if (log)
+    flight_log_begin(log, r);
+
   while (event != EV_GROUND_CONTACT) {
     it++;
+
+    fparser_t *fresh = watch ? config_watch_take(watch) : NULL;
+    if (fresh && scenario_params_reload(params, fresh, r) & (PARAMS_PLANET | PARAMS_ENGINE) &&
+        r->thrust_percent == 0)
+      time_to_burn = golden_search_hoverslam(scene, eps);
+
     prev = *r;
 
     if (r->time >= time_to_burn && r->thrust_percent == 0 && r->fuel_mass > 0)
@@ -126,27 +51,172 @@ result_t hoverslam_simulation(simulator_t *scene, double eps, bool print, bool l
     scene->take_step(scene);
     event = scene->event_detector(scene, &prev);
 
-    if (log && is_almost_integer(r->time, 0.01))
-      logger_write_rocket(&l, r);
     if (print)
       PRINT_ROCKET(*r);
 
     if (event == EV_UNSTABLE || r->coords.z <= 0)
       break;
+    if (log)
+      flight_log_step(log, r);
   }
 
   scene->event_interpolator(scene, &prev, event);
-
-  if (l.file)
-    logger_free(&l);
+  if (log)
+    flight_log_step(log, r); // The last step ends at the event, not below the ground
 
   return (result_t){*r, time_to_burn, it};
 }
 
+static void deck_flight(const void *ctx, simulator_t *scene, scenario_params_t *params,
+                        flight_log_t *log, void *result) {
+  *(result_t *)result =
+      hoverslam_simulation(scene, *(const double *)ctx, false, log, NULL, params);
+}
+
+static int deck_columns(const void *result, char *buff, size_t size, double *row) {
+  const result_t *res = (const result_t *)result;
+  row[0] = res->time_to_burn;
+  row[1] = res->r.velocity.z;
+  row[2] = res->r.fuel_mass;
+  row[3] = res->it;
+
+  return snprintf(buff, size, "%f,%f,%f,%d", res->time_to_burn, res->r.velocity.z,
+                  res->r.fuel_mass, res->it);
+}
+
+// Scaling of the sigma points(Julier & Uhlmann, Wan & van der Merwe): points lie at
+// sqrt(n + lambda) standard deviations, lambda = alpha^2 (n + kappa) - n. beta = 2 is optimal for
+// Gaussian parameters
+#define UNSCENTED_ALPHA 1.0
+#define UNSCENTED_BETA 2.0
+#define UNSCENTED_KAPPA 0.0
+
+typedef struct unscented_job_t {
+  const scenario_params_t *params;
+  double dt, ignition_time;
+  double (*deviations)[UNCERTAIN_COUNT]; // Of the parameters, one row per sigma point
+  double (*landing)[LANDING_STATES];
+  bool *failed;
+
+} unscented_job_t;
+
+static void unscented_point(void *ctx, size_t i, int worker) {
+  (void)worker;
+  unscented_job_t *job = (unscented_job_t *)ctx;
+  const scenario_params_t *p = job->params;
+  const double *dev = job->deviations[i];
+
+  engine_t eng = {p->eng.thrust + dev[UNCERTAIN_THRUST],
+                  p->eng.consumption + dev[UNCERTAIN_CONSUMPTION]};
+  planet_t pl = {p->pl.mass + dev[UNCERTAIN_PLANET_MASS], p->pl.radius};
+  rocket_t *r = start_falling(p->dry_mass + dev[UNCERTAIN_DRY_MASS],
+                              p->fuel_mass + dev[UNCERTAIN_FUEL_MASS],
+                              p->altitude + dev[UNCERTAIN_ALTITUDE], eng, pl);
+  if (!r) {
+    job->failed[i] = true;
+    return;
+  }
+  r->velocity.z = dev[UNCERTAIN_VELOCITY];
+
+  simulator_t scene = falling_scene(r, job->dt);
+  velocity_at_landing(&scene, job->ignition_time);
+
+  job->failed[i] = !isfinite(r->velocity.z) || r->coords.z > 0;
+  job->landing[i][LANDING_TIME] = r->time;
+  job->landing[i][LANDING_VELOCITY] = r->velocity.z;
+  job->landing[i][LANDING_FUEL_MASS] = r->fuel_mass;
+
+  rocket_free(r);
+}
+
+/// @brief Unscented transform of the parameter uncertainty to the landing state. 2n+1 sigma
+/// points(n parameters with a non-zero deviation) are flown in parallel with the engine ignited
+/// at `ignition_time`, and the mean and covariance of their landing states are weighted
+/// @param threads Number of workers, one per CPU if <= 0
+/// @param topo Placement of the workers or NULL
+/// @return Number of sigma points or -1 if one of them doesn't land
+int landing_unscented(const scenario_params_t *params, const scenario_uncertainty_t *u,
+                      double ignition_time, double dt, int threads, const topology_t *topo,
+                      landing_stats_t *out) {
+  double deviations[2 * UNCERTAIN_COUNT + 1][UNCERTAIN_COUNT] = {{0}};
+  double landing[2 * UNCERTAIN_COUNT + 1][LANDING_STATES];
+  bool failed[2 * UNCERTAIN_COUNT + 1] = {false};
+
+  int n = 0;
+  for (int k = 0; k < UNCERTAIN_COUNT; k++)
+    n += u->sigma[k] > 0;
+
+  double lambda = UNSCENTED_ALPHA * UNSCENTED_ALPHA * (n + UNSCENTED_KAPPA) - n;
+  double spread = n ? sqrt(n + lambda) : 0;
+
+  // Row 0 is the nominal point, then a pair of points per uncertain parameter
+  int points = 1;
+  for (int k = 0; k < UNCERTAIN_COUNT; k++)
+    if (u->sigma[k] > 0) {
+      deviations[points++][k] = spread * u->sigma[k];
+      deviations[points++][k] = -spread * u->sigma[k];
+    }
+
+  pool_t *pool =
+      pool_create_pinned(MIN(threads > 0 ? threads : pool_default_threads(), points), topo);
+  if (!pool)
+    return -1;
+
+  unscented_job_t job = {params, dt, ignition_time, deviations, landing, failed};
+  pool_for(pool, points, unscented_point, &job);
+  pool_free(pool);
+
+  int failures = 0;
+  for (int i = 0; i < points; i++)
+    if (failed[i]) {
+      fprintln(stderr, "Sigma point %d doesn't land", i);
+      failures++;
+    }
+  if (failures)
+    return -1;
+
+  double wm0 = n ? lambda / (n + lambda) : 1;
+  double wc0 = n ? wm0 + 1 - UNSCENTED_ALPHA * UNSCENTED_ALPHA + UNSCENTED_BETA : 1;
+  double wi = n ? 1 / (2 * (n + lambda)) : 0;
+
+  for (int a = 0; a < LANDING_STATES; a++) {
+    out->mean[a] = wm0 * landing[0][a];
+    for (int i = 1; i < points; i++)
+      out->mean[a] += wi * landing[i][a];
+  }
+
+  for (int a = 0; a < LANDING_STATES; a++)
+    for (int b = 0; b < LANDING_STATES; b++) {
+      double sum = 0;
+      for (int i = 0; i < points; i++)
+        sum += (i ? wi : wc0) * (landing[i][a] - out->mean[a]) * (landing[i][b] - out->mean[b]);
+      out->cov[a][b] = sum;
+    }
+
+  return points;
+}
+
 void usage() {
   puts("OPTIONS:\n"
        "--print\t\t\tPrint simulation\n"
        "--log\t\t\tLog simulation into cvs file\n"
+       "--binary\t\tWrite the log in binary format(.rlog)\n"
+       "--columns <list>\tComma separated columns to log(default is all of them)\n"
+       "--async\t\t\tWrite the log asynchronously(io_uring or a writer thread)\n"
+       "--watch\t\t\tReload the parameters file when it changes(Linux)\n"
+       "--resample <number>\tStore the trajectory and write its state every <number> s after\n"
+       "\t\t\tthe flight\n"
+       "--lincov\t\tPropagate the [uncertainty] of the parameters to the landing state\n"
+       "\t\t\t(linear covariance)\n"
+       "--unscented\t\tPropagate the [uncertainty] of the parameters to the landing state\n"
+       "\t\t\t(unscented transform, 2n+1 flights on --threads workers)\n"
+       "--deck\t\t\tRun every scenario of the parameters file\n"
+       "--threads <number>\tWorker threads for --deck(default is one per CPU)\n"
+       "--processes <number>\tRun --deck in <number> worker processes instead of threads(POSIX)\n"
+       "--summary\t\tWrite speed, acceleration, altitude, fuel and thrust statistics of\n"
+       "\t\t\tthe flight(of every scenario with --deck), computed while flying\n"
+       "--no-pin\t\tDon't pin the workers to CPUs(see --topology)\n"
+       "--topology\t\tPrint the NUMA nodes and the CPU of every worker\n"
        "--rocket <file>\t\tSpecify file with simulation parameters\n"
        "--dt <number>\t\tChange dt variable(default is 2e-3)\n"
        "--eps <number>\tChange eps variable(default is 1e-4)\n"
@@ -155,12 +225,15 @@ void usage() {
 
 int main(int argc, char *argv[]) {
   double dt = 0.002, eps = 1e-4;
-  bool to_print = false, to_log = false;
-  double fuel_mass = 0.0, dry_mass = 0.0, altitude = 0.0;
-  simulator_t scene = {0};
-  engine_t eng = {0};
-  planet_t pl = {0};
+  bool to_print = false, to_log = false, to_binary = false, to_async = false, to_watch = false;
+  bool to_deck = false, to_lincov = false, to_unscented = false, to_pin = true;
+  bool to_topology = false, to_summary = false;
+  int threads = 0, processes = 0;
+  double resample = 0;
+  scenario_params_t params = {0};
   char *rocket_file = "rocket.dat";
+  char *log_columns = NULL;
+  char config_columns[MAX_LINE];
 
   // Parsing cmd args
   for (int i = 1; i < argc; i++) {
@@ -192,16 +265,79 @@ int main(int argc, char *argv[]) {
         return -1;
       }
       rocket_file = argv[++i];
+    } else if (strcmp(token, "--threads") == 0 || strcmp(token, "--processes") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      int value = atoi(argv[++i]);
+      if (value <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--threads") == 0)
+        threads = value;
+      else {
+#if !defined(__unix__) && !defined(__APPLE__)
+        fprintln(stderr, "'%s' needs fork(POSIX), use --threads!", token);
+        return -1;
+#endif
+        processes = value;
+      }
+    } else if (strcmp(token, "--resample") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      if ((resample = atof(argv[++i])) <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+    } else if (strcmp(token, "--columns") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      log_columns = argv[++i];
     } else if (strcmp(token, "--print") == 0)
       to_print = true;
     else if (strcmp(token, "--log") == 0)
       to_log = true;
+    else if (strcmp(token, "--binary") == 0)
+      to_binary = true;
+    else if (strcmp(token, "--async") == 0)
+      to_async = true;
+    else if (strcmp(token, "--watch") == 0) {
+#ifndef __linux__
+      fprintln(stderr, "'%s' needs inotify(Linux)!", token);
+      return -1;
+#endif
+      to_watch = true;
+    } else if (strcmp(token, "--deck") == 0)
+      to_deck = true;
+    else if (strcmp(token, "--summary") == 0)
+      to_summary = true;
+    else if (strcmp(token, "--no-pin") == 0)
+      to_pin = false;
+    else if (strcmp(token, "--topology") == 0)
+      to_topology = true;
+    else if (strcmp(token, "--lincov") == 0)
+      to_lincov = true;
+    else if (strcmp(token, "--unscented") == 0)
+      to_unscented = true;
     else {
       println("Unknown flag: %s", token);
       return -1;
     }
   }
 
+  if (to_topology) {
+    topology_t topo = topology_detect();
+    topology_print(&topo, stdout);
+    topology_free(&topo);
+    return 0;
+  }
+
   // Parsing 'rocket_file' file
   fparser_t fp = fparser_init(rocket_file);
   if (!fp.file) {
@@ -212,17 +348,44 @@ int main(int argc, char *argv[]) {
   fparser_parse(&fp);
   fparser_free(&fp);
 
-  pl.mass = fparser_get_var(&fp, "planet", "mass").value;
-  pl.radius = fparser_get_var(&fp, "planet", "radius").value;
+  if (to_deck) {
+    logger_t l = (logger_t){0};
+    if (to_log) {
+      l = flight_log_open(to_binary ? "hoverslam_deck.rlog" : "hoverslam_deck.csv", to_binary,
+                          to_async);
+      assert(l.file);
+    }
+
+    topology_t topo = to_pin ? topology_detect() : (topology_t){0};
+    deck_sim_t sim = {.run = deck_flight, .columns = deck_columns, .ctx = &eps, .dt = dt,
+                      .result_size = sizeof(result_t),
+                      .header = "time_to_burn,landing_velocity,fuel_mass,iterations",
+                      .column_count = 4};
+    int result = run_deck(&fp, &sim, threads, processes, &topo,
+                          to_summary ? "hoverslam_deck_summary.csv" : NULL, to_log ? &l : NULL);
+
+    if (l.writer)
+      print_writer_stats(&l);
+    if (l.file)
+      logger_free(&l);
+    topology_free(&topo);
+
+    return result;
+  }
 
-  eng.thrust = fparser_get_var(&fp, "engine", "thrust").value;
-  eng.consumption = fparser_get_var(&fp, "engine", "consumption").value;
+  if (scenario_params_load(&fp, &params) != 0) {
+    fprintln(stderr, "Invalid '%s' file!", rocket_file);
+    return -1;
+  }
 
-  fuel_mass = fparser_get_var(&fp, "rocket", "fuel_mass").value;
-  dry_mass = fparser_get_var(&fp, "rocket", "dry_mass").value;
-  altitude = fparser_get_var(&fp, "rocket", "altitude").value;
+  scenario_uncertainty_t uncertainty = {0};
+  if ((to_lincov || to_unscented) && scenario_uncertainty_load(&fp, &uncertainty) != 0) {
+    fprintln(stderr, "Invalid [uncertainty] in '%s' file!", rocket_file);
+    return -1;
+  }
 
-  rocket_t *r = start_falling(dry_mass, fuel_mass, altitude, eng, pl);
+  rocket_t *r = start_falling(params.dry_mass, params.fuel_mass, params.altitude, params.eng,
+                              params.pl);
   assert(r);
   r->d.self = r;
 
@@ -232,20 +395,77 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
-  scene.dt = dt;
-  scene.integrator = update_status_rk4;
-  scene.event_detector = ground_contact_detector;
-  scene.event_interpolator = hoverslam_event_interpolator;
-  scene.object = r;
-  scene.take_step = take_step;
+  simulator_t scene = falling_scene(r, dt);
+  trajectory_t tr = trajectory_init();
+  if (resample > 0)
+    scene.trajectory = &tr;
 
-  result_t result = hoverslam_simulation(&scene, eps, to_print, to_log);
+  if (!log_columns && log_columns_from_config(&fp, config_columns, sizeof(config_columns)) > 0)
+    log_columns = config_columns;
+
+  aggregate_set_t summary;
+  flight_stats_init(&summary);
+
+  logger_t l = (logger_t){0};
+  flight_log_t log = {.l = to_log ? &l : NULL, .stats = to_summary ? &summary : NULL};
+  if (to_log) {
+    l = flight_log_open(to_binary ? "hoverslam_sim.rlog" : "hoverslam_sim.csv", to_binary,
+                        to_async);
+    assert(l.file);
+    if (logger_select_columns(&l, rocket_log_columns, ROCKET_LOG_COLUMNS, log_columns) != 0) {
+      fprintln(stderr, "Invalid log columns: %s", log_columns);
+      logger_free(&l);
+      rocket_free(r);
+      return -1;
+    }
+  }
+
+  config_watch_t *watch = to_watch ? config_watch_open(rocket_file) : NULL;
+  if (to_watch && !watch)
+    fprintln(stderr, "Can't watch '%s', continuing without reloading", rocket_file);
+
+  result_t result =
+      hoverslam_simulation(&scene, eps, to_print, to_log || to_summary ? &log : NULL, watch,
+                           &params);
+  config_watch_close(watch);
+
+  if (to_summary && flight_stats_write("hoverslam_summary.csv", &summary, 1, NULL) != 0)
+    fprintln(stderr, "Failed to write the summary");
 
   result.r.d.self = &result.r;
   println("Rocket stats after land:\n{}\nTime to start hoverslam:%f\nTotal "
           "iterations during simulation:%d",
           &result.r, result.time_to_burn, result.it);
 
+  landing_stats_t stats;
+  if (to_lincov && landing_lincov(&params, &uncertainty, result.time_to_burn, dt, &stats) == 0)
+    print_landing_stats("Landing state(linear covariance):", &stats);
+  else if (to_lincov)
+    fprintln(stderr, "The nominal flight doesn't land, no linear covariance");
+
+  topology_t topo = to_unscented && to_pin ? topology_detect() : (topology_t){0};
+  int points = to_unscented ? landing_unscented(&params, &uncertainty, result.time_to_burn, dt,
+                                                threads, &topo, &stats)
+                            : 0;
+  topology_free(&topo);
+  if (points > 0) {
+    char title[MAX_LINE];
+    snprintf(title, sizeof(title), "Landing state(unscented transform, %d sigma points):", points);
+    print_landing_stats(title, &stats);
+  } else if (to_unscented)
+    fprintln(stderr, "No unscented transform");
+
+  if (resample > 0 &&
+      flight_log_resample(&tr, &result.r, resample,
+                          to_binary ? "hoverslam_resampled.rlog" : "hoverslam_resampled.csv",
+                          to_binary, log_columns) != 0)
+    fprintln(stderr, "Failed to write the resampled trajectory");
+  trajectory_free(&tr);
+
+  if (l.writer)
+    print_writer_stats(&l);
+  if (l.file)
+    logger_free(&l);
   rocket_free(r);
 
   return 0;
@@ -1,9 +1,13 @@
+#define _POSIX_C_SOURCE 200809L
 #define DISPLAY_IMPLEMENTATION
 #define DISPLAY_STRIP_PREFIX
 #include "common.h"
 #include <rocketlib/PID.h>
 
 #include <assert.h>
+#include <signal.h>
+#include <stddef.h>
+#include <time.h>
 
 typedef struct result_t {
   rocket_t r;
@@ -36,7 +40,11 @@ double pid_calculate_thrust(PID *pid, rocket_t *r, double dt) {
 
   pid->prev_err = err;
 
-  return (thrust) / r->engine.thrust;
+  pid->time = r->time;
+  pid->err = err;
+  pid->output = thrust / r->engine.thrust;
+
+  return pid->output;
 }
 
 /// @brief Calculate the cost for the PID tuning algorithm
@@ -77,61 +85,240 @@ double evaluate_pid_cost(PID *pid, simulator_t scene, double weights[3]) {
   return weights[0] * fabs(r->velocity.z) + weights[1] * fabs(r->coords.z) + weights[2] * fuel_used;
 }
 
+/**
+ * @struct twiddle_checkpoint_t
+ * @brief Checkpoints of a tune_pid_twiddle run
+ *
+ */
+typedef struct twiddle_checkpoint_t {
+  const char *filename;
+  double interval; // Seconds between two checkpoints
+  bool resume;     // Continue from the state in `filename`
+  bool stopped;    // Set if the tuning didn't finish(interrupted or the state can't be resumed)
+
+} twiddle_checkpoint_t;
+
+// Inputs of a tuning(the [problem] section), a checkpoint is only resumed for the same problem
+#define TWIDDLE_PROBLEM 15
+
+/**
+ * @struct twiddle_t
+ * @brief State of tune_pid_twiddle between two cost evaluations
+ *
+ */
+typedef struct twiddle_t {
+  double p[3], dp[3];
+  double best_err;
+  int started;     // best_err is known
+  int index;       // Coefficient of the next trial
+  int phase;       // 0: p + dp is tried next, 1: p - dp(p[index] still holds p + dp)
+  int iterations;  // Completed sweeps over the coefficients
+  int evaluations; // Flights simulated so far
+  double problem[TWIDDLE_PROBLEM];
+
+} twiddle_t;
+
+#define T(field) offsetof(twiddle_t, field)
+#define TP(i, key) {"problem", key, T(problem[i]), FPARSER_DOUBLE, 0, true}
+
+static const fparser_binding_t twiddle_bindings[] = {
+    {"twiddle", "k_p", T(p[0]), FPARSER_DOUBLE, 0, true},
+    {"twiddle", "k_i", T(p[1]), FPARSER_DOUBLE, 0, true},
+    {"twiddle", "k_d", T(p[2]), FPARSER_DOUBLE, 0, true},
+    {"twiddle", "dp_p", T(dp[0]), FPARSER_DOUBLE, 0, true},
+    {"twiddle", "dp_i", T(dp[1]), FPARSER_DOUBLE, 0, true},
+    {"twiddle", "dp_d", T(dp[2]), FPARSER_DOUBLE, 0, true},
+    {"twiddle", "best_err", T(best_err), FPARSER_DOUBLE, 0, true},
+    {"twiddle", "started", T(started), FPARSER_INT, 0, true},
+    {"twiddle", "index", T(index), FPARSER_INT, 0, true},
+    {"twiddle", "phase", T(phase), FPARSER_INT, 0, true},
+    {"twiddle", "iterations", T(iterations), FPARSER_INT, 0, true},
+    {"twiddle", "evaluations", T(evaluations), FPARSER_INT, 0, true},
+    TP(0, "dt"),
+    TP(1, "tolerance"),
+    TP(2, "weight_velocity"),
+    TP(3, "weight_altitude"),
+    TP(4, "weight_fuel"),
+    TP(5, "dry_mass"),
+    TP(6, "fuel_mass"),
+    TP(7, "altitude"),
+    TP(8, "thrust"),
+    TP(9, "consumption"),
+    TP(10, "planet_mass"),
+    TP(11, "planet_radius"),
+    TP(12, "start_dp_p"),
+    TP(13, "start_dp_i"),
+    TP(14, "start_dp_d"),
+};
+
+#undef TP
+#undef T
+
+#define TWIDDLE_BINDINGS (sizeof(twiddle_bindings) / sizeof(twiddle_bindings[0]))
+
+static void twiddle_problem(const simulator_t *scene, double tolerance, const double weights[3],
+                            const double dp[3], double problem[TWIDDLE_PROBLEM]) {
+  const rocket_t *r = (const rocket_t *)scene->object;
+  const double values[TWIDDLE_PROBLEM] = {
+      scene->dt,   tolerance,    weights[0],  weights[1],       weights[2],
+      r->dry_mass, r->fuel_mass, r->coords.z, r->engine.thrust, r->engine.consumption,
+      r->pl.mass,  r->pl.radius, dp[0],       dp[1],            dp[2],
+  };
+
+  memcpy(problem, values, sizeof(values));
+}
+
+static int twiddle_save(const twiddle_t *t, const char *filename) {
+  checkpoint_t c = checkpoint_begin(filename);
+
+  const char *section = NULL;
+
+  for (size_t k = 0; k < TWIDDLE_BINDINGS; k++) {
+    const fparser_binding_t *b = &twiddle_bindings[k];
+    const void *field = (const char *)t + b->offset;
+    if (!section || strcmp(section, b->section) != 0)
+      checkpoint_section(&c, section = b->section);
+    checkpoint_value(&c, b->key,
+                     b->type == FPARSER_INT ? *(const int *)field : *(const double *)field);
+  }
+
+  return checkpoint_commit(&c);
+}
+
+/// @return 0 on success, -1 if the file can't be read or belongs to another problem
+static int twiddle_load(twiddle_t *t, const char *filename) {
+  fparser_t fp = fparser_init(filename);
+  if (!fp.file)
+    return -1;
+  fparser_parse(&fp);
+  fparser_free(&fp);
+
+  twiddle_t loaded = {0};
+  if (fparser_bind(&fp, twiddle_bindings, TWIDDLE_BINDINGS, &loaded, stderr) != 0 ||
+      loaded.index < 0 || loaded.index > 2 || loaded.phase < 0 || loaded.phase > 1)
+    return -1;
+
+  for (int i = 0; i < TWIDDLE_PROBLEM; i++)
+    if (loaded.problem[i] != t->problem[i]) {
+      fprintln(stderr, "'%s' was saved for a different %s", filename,
+               twiddle_bindings[TWIDDLE_BINDINGS - TWIDDLE_PROBLEM + i].key);
+      return -1;
+    }
+
+  *t = loaded;
+
+  return 0;
+}
+
+static volatile sig_atomic_t twiddle_interrupted = 0;
+
+static void twiddle_on_signal(int sig) {
+  (void)sig;
+  twiddle_interrupted = 1;
+}
+
 /// @brief An implementation of the Twiddle algorithm for auto-tuning PID
 /// coefficients
 /// It systematically adjusts the Kp, Ki, and Kd values to minimize the cost
 /// returned by evaluate_pid_cost
+/// @param ck Checkpoints of the tuning or NULL. The state is saved every ck->interval seconds,
+/// at the end and when SIGINT or SIGTERM arrives(the tuning then stops with ck->stopped set).
+/// With ck->resume the tuning continues from the saved state, no finished flight is simulated
+/// again
 /// @return Optimized PID
-PID tune_pid_twiddle(simulator_t scene, double tolerance, double weights[3], double dp[3]) {
+PID tune_pid_twiddle(simulator_t scene, double tolerance, double weights[3], double dp[3],
+                     twiddle_checkpoint_t *ck) {
   PID pid = {0};
   pid.d.display_fn = display_pid;
   pid.d.self = &pid;
 
-  double p[] = {pid.K_p, pid.K_i, pid.K_d};
+  twiddle_t t = {.p = {pid.K_p, pid.K_i, pid.K_d}, .dp = {dp[0], dp[1], dp[2]}};
+  twiddle_problem(&scene, tolerance, weights, dp, t.problem);
+
+  if (ck && ck->resume) {
+    if (twiddle_load(&t, ck->filename) != 0) {
+      fprintln(stderr, "Can't resume the tuning from '%s'", ck->filename);
+      ck->stopped = true;
+      return pid;
+    }
+    fprintln(stderr, "Resuming the tuning from '%s' after %d flights", ck->filename,
+             t.evaluations);
+  }
+
+  void (*prev_sigint)(int) = SIG_DFL, (*prev_sigterm)(int) = SIG_DFL;
+  if (ck) {
+    twiddle_interrupted = 0;
+    prev_sigint = signal(SIGINT, twiddle_on_signal);
+    prev_sigterm = signal(SIGTERM, twiddle_on_signal);
+  }
+  time_t last_save = time(NULL);
 
   rocket_t initial_rocket_state = *(rocket_t *)scene.object;
   double initial_scene_time = scene.time;
+  scene.trajectory = NULL; // Trial flights aren't recorded
+
+  double *p = t.p, *step = t.dp;
+
+  while (!t.started || t.index != 0 || t.phase != 0 || (step[0] + step[1] + step[2]) > tolerance) {
+    int i = t.index;
+    if (t.started && t.phase == 0)
+      p[i] += step[i];
+    else if (t.started)
+      p[i] -= 2 * step[i];
+
+    pid.K_p = p[0];
+    pid.K_i = p[1];
+    pid.K_d = p[2];
+    double err = evaluate_pid_cost(&pid, scene, weights);
+    t.evaluations++;
+
+    *(rocket_t *)scene.object = initial_rocket_state;
+    scene.time = initial_scene_time;
+
+    if (!t.started) {
+      t.best_err = err;
+      t.started = true;
+    } else if (err < t.best_err) {
+      t.best_err = err;
+      step[i] *= 1.1;
+      t.phase = 0;
+      t.index++;
+    } else if (t.phase == 0) {
+      t.phase = 1;
+    } else {
+      p[i] += step[i];
+      step[i] *= 0.9;
+      t.phase = 0;
+      t.index++;
+    }
+
+    if (t.index == 3) {
+      t.index = 0;
+      t.iterations++;
+    }
 
-  double best_err = evaluate_pid_cost(&pid, scene, weights);
-
-  *(rocket_t *)scene.object = initial_rocket_state;
-  scene.time = initial_scene_time;
-
-  while ((dp[0] + dp[1] + dp[2]) > tolerance) {
-    for (int i = 0; i < 3; i++) {
-      p[i] += dp[i];
-      pid.K_p = p[0];
-      pid.K_i = p[1];
-      pid.K_d = p[2];
-      double err = evaluate_pid_cost(&pid, scene, weights);
-
-      *(rocket_t *)scene.object = initial_rocket_state;
-      scene.time = initial_scene_time;
-
-      if (err < best_err) {
-        best_err = err;
-        dp[i] *= 1.1;
-      } else {
-        p[i] -= 2 * dp[i];
-        pid.K_p = p[0];
-        pid.K_i = p[1];
-        pid.K_d = p[2];
-        err = evaluate_pid_cost(&pid, scene, weights);
-
-        *(rocket_t *)scene.object = initial_rocket_state;
-        scene.time = initial_scene_time;
-
-        if (err < best_err) {
-          best_err = err;
-          dp[i] *= 1.1;
-        } else {
-          p[i] += dp[i];
-          dp[i] *= 0.9;
-        }
+    if (ck && (twiddle_interrupted || difftime(time(NULL), last_save) >= ck->interval)) {
+      if (twiddle_save(&t, ck->filename) != 0)
+        fprintln(stderr, "Failed to write the checkpoint '%s'", ck->filename);
+      last_save = time(NULL);
+
+      if (twiddle_interrupted) {
+        fprintln(stderr, "Tuning interrupted after %d flights, resume it with --resume",
+                 t.evaluations);
+        ck->stopped = true;
+        break;
       }
     }
   }
 
+  if (ck) {
+    if (!ck->stopped && twiddle_save(&t, ck->filename) != 0) // The finished tuning
+      fprintln(stderr, "Failed to write the checkpoint '%s'", ck->filename);
+    signal(SIGINT, prev_sigint);
+    signal(SIGTERM, prev_sigterm);
+  }
+
+  memcpy(dp, step, sizeof(t.dp));
   pid.K_p = p[0];
   pid.K_i = p[1];
   pid.K_d = p[2];
@@ -144,19 +331,22 @@ PID tune_pid_twiddle(simulator_t scene, double tolerance, double weights[3], dou
 /// tune_pid_twiddle
 /// @param tolerance Precision for the tuning algorithm
 /// @param print Print data during flight?
-/// @param log Log simulation data to a file?
+/// @param log Destination of simulation data or NULL
+/// @param tl Logger for per-tick controller telemetry or NULL
+/// @param watch Config watcher or NULL. Planet and engine changes are applied between steps,
+/// the controller is tuned again from the current state if [pid_weights] or
+/// [pid_start_values] change
+/// @param ck Checkpoints of the first tuning or NULL. Nothing is flown if it stopped
 /// @return The struct of tuned PID controller, rocket stats after land and
 /// number of iterations during simulation
-result_t pid_landing_simulation(simulator_t *scene, double tolerance, double weights[3],
-                                double dp[3], bool print, bool log) {
-  logger_t l = (logger_t){NULL, NULL};
-  if (log) {
-    l = logger_init("pid_flight_sim.csv");
-    assert(l.file);
-    fprintln(l.file, ROCKET_LOG_HEADER);
-  }
+result_t pid_landing_simulation(simulator_t *scene, double tolerance, scenario_params_t *params,
+                                bool print, flight_log_t *log, logger_t *tl,
+                                config_watch_t *watch, twiddle_checkpoint_t *ck) {
+  double dp[3] = {params->dp[0], params->dp[1], params->dp[2]};
+  PID pid = tune_pid_twiddle(*scene, tolerance, params->weights, dp, ck);
+  if (ck && ck->stopped)
+    return (result_t){*(rocket_t *)scene->object, pid, 0};
 
-  PID pid = tune_pid_twiddle(*scene, tolerance, weights, dp);
   pid.integral = 0;
   pid.prev_err = 0;
 
@@ -165,11 +355,25 @@ result_t pid_landing_simulation(simulator_t *scene, double tolerance, double wei
   int it = 0;
   event_type_t event = EV_NONE;
   rocket_t prev_state;
+  if (log)
+    flight_log_begin(log, r);
   while (event != EV_GROUND_CONTACT) {
     it++;
+
+    fparser_t *fresh = watch ? config_watch_take(watch) : NULL;
+    if (fresh && scenario_params_reload(params, fresh, r) & PARAMS_PID) {
+      PID prev_pid = pid;
+      memcpy(dp, params->dp, sizeof(dp));
+      pid = tune_pid_twiddle(*scene, tolerance, params->weights, dp, NULL);
+      pid.integral = prev_pid.integral;
+      pid.prev_err = prev_pid.prev_err;
+    }
+
     prev_state = *r;
 
     double desired_thrust = pid_calculate_thrust(&pid, r, scene->dt);
+    if (tl)
+      logger_write_pid(tl, &pid);
 
     if (desired_thrust > 0 && r->fuel_mass > 0)
       CHANGE_THRUST(*r, MIN(1, desired_thrust));
@@ -179,43 +383,81 @@ result_t pid_landing_simulation(simulator_t *scene, double tolerance, double wei
     scene->take_step(scene);
     event = scene->event_detector(scene, &prev_state);
 
-    if (log && is_almost_integer(r->time, 0.01))
-      logger_write_rocket(&l, r);
-
     if (print)
       PRINT_ROCKET(*r);
 
     if (event == EV_UNSTABLE || r->coords.z <= 0)
       break;
+    if (log)
+      flight_log_step(log, r);
   }
 
   scene->event_interpolator(scene, &prev_state, event);
-
-  if (l.file)
-    logger_free(&l);
+  if (log)
+    flight_log_step(log, r); // The last step ends at the event, not below the ground
 
   return (result_t){*r, pid, it};
 }
 
+static void deck_flight(const void *ctx, simulator_t *scene, scenario_params_t *params,
+                        flight_log_t *log, void *result) {
+  *(result_t *)result = pid_landing_simulation(scene, *(const double *)ctx, params, false, log,
+                                               NULL, NULL, NULL);
+}
+
+static int deck_columns(const void *result, char *buff, size_t size, double *row) {
+  const result_t *res = (const result_t *)result;
+  row[0] = res->pid.K_p;
+  row[1] = res->pid.K_i;
+  row[2] = res->pid.K_d;
+  row[3] = res->r.velocity.z;
+  row[4] = res->r.fuel_mass;
+  row[5] = res->it;
+
+  return snprintf(buff, size, "%f,%f,%f,%f,%f,%d", res->pid.K_p, res->pid.K_i, res->pid.K_d,
+                  res->r.velocity.z, res->r.fuel_mass, res->it);
+}
+
 void usage() {
   puts("OPTIONS:\n"
        "--print\t\t\tPrint simulation\n"
        "--log\t\t\tLog simulation into cvs file\n"
+       "--binary\t\tWrite the log in binary format(.rlog)\n"
+       "--columns <list>\tComma separated columns to log(default is all of them)\n"
+       "--async\t\t\tWrite the log asynchronously(io_uring or a writer thread)\n"
+       "--telemetry\t\tLog PID controller state on every tick\n"
+       "--watch\t\t\tReload the parameters file when it changes(Linux)\n"
+       "--resample <number>\tStore the trajectory and write its state every <number> s after\n"
+       "\t\t\tthe flight\n"
+       "--deck\t\t\tRun every scenario of the parameters file\n"
+       "--threads <number>\tWorker threads for --deck(default is one per CPU)\n"
+       "--processes <number>\tRun --deck in <number> worker processes instead of threads(POSIX)\n"
+       "--summary\t\tWrite speed, acceleration, altitude, fuel and thrust statistics of\n"
+       "\t\t\tthe flight(of every scenario with --deck), computed while flying\n"
+       "--no-pin\t\tDon't pin the workers to CPUs(see --topology)\n"
+       "--topology\t\tPrint the NUMA nodes and the CPU of every worker\n"
        "--rocket <file>\t\tSpecify file with simulation parameters\n"
        "--dt <number>\t\tChange dt variable(default is 2e-3)\n"
        "--tolerance <number>\tChange tolerance variable(default is 1e-4)\n"
+       "--checkpoint <file>\tSave the state of the tuning to <file>(default is\n"
+       "\t\t\tpid_twiddle.chk with --resume)\n"
+       "--checkpoint-interval <number>\tSeconds between two checkpoints(default is 30)\n"
+       "--resume\t\tContinue the tuning saved in the checkpoint file\n"
        "-h\t\t\tPrint this help message");
 }
 
 int main(int argc, char *argv[]) {
   double dt = 2e-3, tolerance = 1e-4;
-  double dp[3], weights[3];
-  bool to_print = false, to_log = false;
-  double fuel_mass = 0.0, dry_mass = 0.0, altitude = 0.0;
-  simulator_t scene = {0};
-  engine_t eng = {0};
-  planet_t pl = {0};
+  bool to_print = false, to_log = false, to_binary = false, to_async = false;
+  bool to_telemetry = false, to_watch = false, to_deck = false, to_pin = true;
+  bool to_topology = false, to_summary = false;
+  int threads = 0, processes = 0;
+  twiddle_checkpoint_t checkpoint = {.interval = 30};
+  double resample = 0;
+  scenario_params_t params = {0};
   char *rocket_file = "rocket.dat";
+  char *log_columns = NULL;
+  char config_columns[MAX_LINE];
 
   // Parsing cmd args
   for (int i = 1; i < argc; i++) {
@@ -247,16 +489,94 @@ int main(int argc, char *argv[]) {
         return -1;
       }
       rocket_file = argv[++i];
+    } else if (strcmp(token, "--threads") == 0 || strcmp(token, "--processes") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      int value = atoi(argv[++i]);
+      if (value <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--threads") == 0)
+        threads = value;
+      else {
+#if !defined(__unix__) && !defined(__APPLE__)
+        fprintln(stderr, "'%s' needs fork(POSIX), use --threads!", token);
+        return -1;
+#endif
+        processes = value;
+      }
+    } else if (strcmp(token, "--resample") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      if ((resample = atof(argv[++i])) <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+    } else if (strcmp(token, "--checkpoint") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      checkpoint.filename = argv[++i];
+    } else if (strcmp(token, "--checkpoint-interval") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      if ((checkpoint.interval = atof(argv[++i])) < 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+    } else if (strcmp(token, "--columns") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      log_columns = argv[++i];
     } else if (strcmp(token, "--print") == 0)
       to_print = true;
     else if (strcmp(token, "--log") == 0)
       to_log = true;
+    else if (strcmp(token, "--binary") == 0)
+      to_binary = true;
+    else if (strcmp(token, "--async") == 0)
+      to_async = true;
+    else if (strcmp(token, "--telemetry") == 0)
+      to_telemetry = true;
+    else if (strcmp(token, "--watch") == 0) {
+#ifndef __linux__
+      fprintln(stderr, "'%s' needs inotify(Linux)!", token);
+      return -1;
+#endif
+      to_watch = true;
+    } else if (strcmp(token, "--deck") == 0)
+      to_deck = true;
+    else if (strcmp(token, "--summary") == 0)
+      to_summary = true;
+    else if (strcmp(token, "--no-pin") == 0)
+      to_pin = false;
+    else if (strcmp(token, "--topology") == 0)
+      to_topology = true;
+    else if (strcmp(token, "--resume") == 0)
+      checkpoint.resume = true;
     else {
       println("Unknown flag: %s", token);
       return -1;
     }
   }
 
+  if (to_topology) {
+    topology_t topo = topology_detect();
+    topology_print(&topo, stdout);
+    topology_free(&topo);
+    return 0;
+  }
+
   // Parsing 'rocket_file' file
   fparser_t fp = fparser_init(rocket_file);
   if (!fp.file) {
@@ -267,43 +587,37 @@ int main(int argc, char *argv[]) {
   fparser_parse(&fp);
   fparser_free(&fp);
 
-  pl.mass = fparser_get_var(&fp, "planet", "mass").value;
-  pl.radius = fparser_get_var(&fp, "planet", "radius").value;
-
-  eng.thrust = fparser_get_var(&fp, "engine", "thrust").value;
-  eng.consumption = fparser_get_var(&fp, "engine", "consumption").value;
-
-  fuel_mass = fparser_get_var(&fp, "rocket", "fuel_mass").value;
-  dry_mass = fparser_get_var(&fp, "rocket", "dry_mass").value;
-  altitude = fparser_get_var(&fp, "rocket", "altitude").value;
-
-  weights[0] = fparser_get_var(&fp, "pid_weights", "velocity").value;
-  weights[1] = fparser_get_var(&fp, "pid_weights", "altitude").value;
-  weights[2] = fparser_get_var(&fp, "pid_weights", "fuel").value;
+  if (to_deck) {
+    logger_t l = (logger_t){0};
+    if (to_log) {
+      l = flight_log_open(to_binary ? "pid_deck.rlog" : "pid_deck.csv", to_binary, to_async);
+      assert(l.file);
+    }
 
-  if (weights[0] == 0 && weights[1] == 0 && weights[2] == 0) {
-    weights[0] = 1.0;
-    weights[1] = 1.0;
-    weights[2] = 0.1;
-    println("Invalid pid_weights! Setting default ones:\nVelocity: "
-            "%f\nAltitude: %f\nFuel: %f",
-            weights[0], weights[1], weights[2]);
+    topology_t topo = to_pin ? topology_detect() : (topology_t){0};
+    deck_sim_t sim = {.run = deck_flight, .columns = deck_columns, .ctx = &tolerance, .dt = dt,
+                      .result_size = sizeof(result_t),
+                      .header = "K_p,K_i,K_d,landing_velocity,fuel_mass,iterations",
+                      .column_count = 6};
+    int result = run_deck(&fp, &sim, threads, processes, &topo,
+                          to_summary ? "pid_deck_summary.csv" : NULL, to_log ? &l : NULL);
+
+    if (l.writer)
+      print_writer_stats(&l);
+    if (l.file)
+      logger_free(&l);
+    topology_free(&topo);
+
+    return result;
   }
 
-  dp[0] = fparser_get_var(&fp, "pid_start_values", "K_p").value;
-  dp[1] = fparser_get_var(&fp, "pid_start_values", "K_i").value;
-  dp[2] = fparser_get_var(&fp, "pid_start_values", "K_d").value;
-
-  if (dp[0] == 0 && dp[1] == 0 && dp[2] == 0) {
-    dp[0] = 10.;
-    dp[1] = 5.0;
-    dp[2] = 1.0;
-    println("Invalid pid_start_values! Setting default ones:\nK_p: %f\nK_i: "
-            "%f\nK_d: %f",
-            dp[0], dp[1], dp[2]);
+  if (scenario_params_load(&fp, &params) != 0) {
+    fprintln(stderr, "Invalid '%s' file!", rocket_file);
+    return -1;
   }
 
-  rocket_t *r = start_falling(dry_mass, fuel_mass, altitude, eng, pl);
+  rocket_t *r = start_falling(params.dry_mass, params.fuel_mass, params.altitude, params.eng,
+                              params.pl);
   assert(r);
   r->d.self = r;
 
@@ -313,14 +627,64 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
-  scene.dt = dt;
-  scene.integrator = update_status_rk4;
-  scene.event_detector = ground_contact_detector;
-  scene.event_interpolator = hoverslam_event_interpolator;
-  scene.object = r;
-  scene.take_step = take_step;
+  simulator_t scene = falling_scene(r, dt);
+  trajectory_t tr = trajectory_init();
+  if (resample > 0)
+    scene.trajectory = &tr;
 
-  result_t result = pid_landing_simulation(&scene, tolerance, weights, dp, to_print, to_log);
+  if (!log_columns && log_columns_from_config(&fp, config_columns, sizeof(config_columns)) > 0)
+    log_columns = config_columns;
+
+  aggregate_set_t summary;
+  flight_stats_init(&summary);
+
+  logger_t l = (logger_t){0};
+  flight_log_t log = {.l = to_log ? &l : NULL, .stats = to_summary ? &summary : NULL};
+  if (to_log) {
+    l = flight_log_open(to_binary ? "pid_flight_sim.rlog" : "pid_flight_sim.csv", to_binary,
+                        to_async);
+    assert(l.file);
+    if (logger_select_columns(&l, rocket_log_columns, ROCKET_LOG_COLUMNS, log_columns) != 0) {
+      fprintln(stderr, "Invalid log columns: %s", log_columns);
+      logger_free(&l);
+      rocket_free(r);
+      return -1;
+    }
+  }
+
+  logger_t tl = (logger_t){0};
+  if (to_telemetry) {
+    tl = flight_log_open(to_binary ? "pid_telemetry.rlog" : "pid_telemetry.csv", to_binary,
+                         to_async);
+    assert(tl.file);
+  }
+
+  config_watch_t *watch = to_watch ? config_watch_open(rocket_file) : NULL;
+  if (to_watch && !watch)
+    fprintln(stderr, "Can't watch '%s', continuing without reloading", rocket_file);
+
+  if (checkpoint.resume && !checkpoint.filename)
+    checkpoint.filename = "pid_twiddle.chk";
+
+  result_t result =
+      pid_landing_simulation(&scene, tolerance, &params, to_print,
+                             to_log || to_summary ? &log : NULL,
+                             to_telemetry ? &tl : NULL, watch,
+                             checkpoint.filename ? &checkpoint : NULL);
+  config_watch_close(watch);
+
+  if (checkpoint.stopped) {
+    trajectory_free(&tr);
+    if (l.file)
+      logger_free(&l);
+    if (tl.file)
+      logger_free(&tl);
+    rocket_free(r);
+    return 1;
+  }
+
+  if (to_summary && flight_stats_write("pid_summary.csv", &summary, 1, NULL) != 0)
+    fprintln(stderr, "Failed to write the summary");
 
   result.r.d.self = &result.r;
   result.pid.d.self = &result.pid;
@@ -328,6 +692,21 @@ int main(int argc, char *argv[]) {
           "iterations during simulation:%d",
           &result.r, &result.pid, result.it);
 
+  if (resample > 0 &&
+      flight_log_resample(&tr, &result.r, resample,
+                          to_binary ? "pid_resampled.rlog" : "pid_resampled.csv", to_binary,
+                          log_columns) != 0)
+    fprintln(stderr, "Failed to write the resampled trajectory");
+  trajectory_free(&tr);
+
+  if (l.writer)
+    print_writer_stats(&l);
+  if (l.file)
+    logger_free(&l);
+  if (tl.writer)
+    print_writer_stats(&tl);
+  if (tl.file)
+    logger_free(&tl);
   rocket_free(r);
 
   return 0;
@@ -0,0 +1,836 @@
+#define _POSIX_C_SOURCE 200809L
+#define DISPLAY_IMPLEMENTATION
+#define DISPLAY_STRIP_PREFIX
+#include "common.h"
+
+#include <stdint.h>
+
+/// Renders flight logs(CSV or .rlog) into the 7-panel figure of stats.py, as SVG and
+/// optionally PNG. A log is read in one pass and every series is reduced on the fly to the
+/// first, last, lowest and highest point of every pixel column, so the memory and the drawing
+/// time don't depend on the length of the log
+
+#define FIGURE_WIDTH 1600
+#define FIGURE_HEIGHT 1200
+#define PANEL_COLUMNS 3
+#define PANEL_WIDTH (FIGURE_WIDTH / PANEL_COLUMNS)
+#define PANEL_HEIGHT (FIGURE_HEIGHT / 3)
+
+// Plot area of a panel
+#define MARGIN_LEFT 80
+#define MARGIN_RIGHT 20
+#define MARGIN_TOP 35
+#define MARGIN_BOTTOM 50
+#define AREA_WIDTH (PANEL_WIDTH - MARGIN_LEFT - MARGIN_RIGHT)
+#define AREA_HEIGHT (PANEL_HEIGHT - MARGIN_TOP - MARGIN_BOTTOM)
+
+// Two buckets per pixel column: the time span fills between half and all of them
+#define BUCKETS (2 * AREA_WIDTH)
+#define BUCKET_WIDTH_MIN 1e-6 // s, doubled until the log fits
+#define AXIS_PADDING 0.05     // Of the data range on both sides, like matplotlib
+#define AXIS_TICKS 5          // Approximate count
+
+#define PLOT_MAX_COLUMNS 64
+#define PLOT_MAX_LINE 4096
+
+enum { C_WHITE, C_BLACK, C_GRID, C_RED, C_GREEN, C_BLUE, C_PURPLE, C_ORANGE, C_DARKBLUE, C_COUNT };
+
+static const struct {
+  const char *name;
+  uint8_t rgb[3];
+} colors[C_COUNT] = {
+    {"white", {255, 255, 255}}, {"black", {0, 0, 0}},     {"#d9d9d9", {217, 217, 217}},
+    {"red", {255, 0, 0}},       {"green", {0, 128, 0}},   {"blue", {0, 0, 255}},
+    {"purple", {128, 0, 128}},  {"orange", {255, 165, 0}}, {"darkblue", {0, 0, 139}},
+};
+
+enum {
+  S_ALTITUDE,
+  S_VX,
+  S_VY,
+  S_VZ,
+  S_AX,
+  S_AY,
+  S_AZ,
+  S_THRUST,
+  S_FUEL,
+  S_SPEED,        // |velocity| of the logged components
+  S_ACCELERATION, // |acceleration|
+  S_COUNT
+};
+
+static const struct {
+  const char *column; // NULL for the magnitudes
+  const char *label;
+  int color;
+} series_info[S_COUNT] = {
+    {"CoordinateOz(m)", "Altitude", C_BLUE},
+    {"velocityOx(m/s)", "Velocity X", C_RED},
+    {"velocityOy(m/s)", "Velocity Y", C_GREEN},
+    {"velocityOz(m/s)", "Velocity Z", C_BLUE},
+    {"accOx(m/s^2)", "Acceleration X", C_RED},
+    {"accOy(m/s^2)", "Acceleration Y", C_GREEN},
+    {"accOz(m/s^2)", "Acceleration Z", C_BLUE},
+    {"thrust_percent(%)", "Thrust", C_PURPLE},
+    {"fuel_mass(kg)", "Fuel Mass", C_ORANGE},
+    {NULL, "Total Velocity", C_RED},
+    {NULL, "Total Acceleration", C_DARKBLUE},
+};
+
+typedef struct panel_t {
+  const char *title, *ylabel;
+  int first, count; // Series
+  bool legend;
+
+} panel_t;
+
+// Same order as the subplots of stats.py
+static const panel_t panels[] = {
+    {"Altitude vs. Time", "Altitude (m)", S_ALTITUDE, 1, false},
+    {"Velocity Components vs. Time", "Velocity (m/s)", S_VX, 3, true},
+    {"Acceleration Components vs. Time", "Acceleration (m/s^2)", S_AX, 3, true},
+    {"Engine Thrust vs. Time", "Thrust (%)", S_THRUST, 1, false},
+    {"Fuel Mass vs. Time", "Fuel Mass (kg)", S_FUEL, 1, false},
+    {"Total Velocity vs. Time", "Velocity (m/s)", S_SPEED, 1, false},
+    {"Total Acceleration vs. Time", "Acceleration (m/s^2)", S_ACCELERATION, 1, false},
+};
+#define PANEL_COUNT (int)(sizeof(panels) / sizeof(panels[0]))
+
+typedef struct point_t {
+  double t, v;
+
+} point_t;
+
+// The points of a bucket which decide how its pixel column looks
+typedef struct bucket_t {
+  point_t first, last, min, max;
+  bool used;
+
+} bucket_t;
+
+/**
+ * @struct plot_t
+ * @brief Downsampled series of one log. Bucket k of every series covers
+ * [t0 + k * width, t0 + (k + 1) * width)
+ *
+ */
+typedef struct plot_t {
+  bool present[S_COUNT];
+  bucket_t buckets[S_COUNT][BUCKETS];
+  double t0, t_end, width;
+  size_t rows;
+
+} plot_t;
+
+static void bucket_add(bucket_t *b, point_t p) {
+  if (!b->used) {
+    *b = (bucket_t){p, p, p, p, true};
+    return;
+  }
+
+  b->last = p;
+  if (p.v < b->min.v)
+    b->min = p;
+  if (p.v > b->max.v)
+    b->max = p;
+}
+
+static bucket_t bucket_merge(bucket_t a, bucket_t b) {
+  if (!a.used)
+    return b;
+  if (!b.used)
+    return a;
+
+  return (bucket_t){a.first, b.last, b.min.v < a.min.v ? b.min : a.min,
+                    b.max.v > a.max.v ? b.max : a.max, true};
+}
+
+// Doubles the width of the buckets, merging them pairwise
+static void plot_coarsen(plot_t *p) {
+  p->width *= 2;
+  for (int s = 0; s < S_COUNT; s++) {
+    bucket_t *b = p->buckets[s];
+    for (int k = 0; k < BUCKETS / 2; k++)
+      b[k] = bucket_merge(b[2 * k], b[2 * k + 1]);
+    for (int k = BUCKETS / 2; k < BUCKETS; k++)
+      b[k] = (bucket_t){0};
+  }
+}
+
+static void plot_add(plot_t *p, double t, const double *values) {
+  if (!isfinite(t))
+    return;
+
+  if (p->rows++ == 0) {
+    p->t0 = p->t_end = t;
+    p->width = BUCKET_WIDTH_MIN;
+  }
+  p->t_end = MAX(p->t_end, t);
+
+  double offset = MAX(t - p->t0, 0); // A log should be in time order, earlier rows go first
+  if (!isfinite(offset))
+    return;
+  while (offset >= p->width * BUCKETS)
+    plot_coarsen(p);
+
+  int k = MIN((int)(offset / p->width), BUCKETS - 1);
+  for (int s = 0; s < S_COUNT; s++)
+    if (p->present[s] && isfinite(values[s]))
+      bucket_add(&p->buckets[s][k], (point_t){t, values[s]});
+}
+
+// Index of the log column of every series, -1 if it isn't logged
+typedef struct columns_t {
+  int time;
+  int series[S_COUNT];
+
+} columns_t;
+
+static void plot_columns(plot_t *p, columns_t *c) {
+  for (int s = 0; s < S_COUNT; s++)
+    p->present[s] = c->series[s] >= 0;
+  p->present[S_SPEED] = p->present[S_VX] || p->present[S_VY] || p->present[S_VZ];
+  p->present[S_ACCELERATION] = p->present[S_AX] || p->present[S_AY] || p->present[S_AZ];
+}
+
+static void plot_row(plot_t *p, const columns_t *c, const double *row) {
+  double values[S_COUNT] = {0};
+  for (int s = 0; s < S_COUNT; s++)
+    if (c->series[s] >= 0)
+      values[s] = row[c->series[s]];
+
+  for (int k = 0; k < 3; k++) {
+    values[S_SPEED] += values[S_VX + k] * values[S_VX + k];
+    values[S_ACCELERATION] += values[S_AX + k] * values[S_AX + k];
+  }
+  values[S_SPEED] = sqrt(values[S_SPEED]);
+  values[S_ACCELERATION] = sqrt(values[S_ACCELERATION]);
+
+  plot_add(p, row[c->time], values);
+}
+
+static int read_rlog(plot_t *p, const char *filename) {
+  log_reader_t lr = log_reader_open(filename);
+  if (!lr.map)
+    return -1;
+
+  columns_t c = {log_reader_column_index(&lr, "time(s)"), {0}};
+  for (int s = 0; s < S_COUNT; s++)
+    c.series[s] = series_info[s].column ? log_reader_column_index(&lr, series_info[s].column) : -1;
+  if (c.time < 0) {
+    log_reader_close(&lr);
+    return -1;
+  }
+
+  plot_columns(p, &c);
+  for (size_t i = 0; i < lr.rows; i++)
+    plot_row(p, &c, log_reader_row(&lr, i));
+
+  return log_reader_close(&lr);
+}
+
+static int read_csv(plot_t *p, FILE *file) {
+  char line[PLOT_MAX_LINE];
+  if (!fgets(line, sizeof(line), file))
+    return -1;
+
+  columns_t c = {-1, {0}};
+  for (int s = 0; s < S_COUNT; s++)
+    c.series[s] = -1;
+
+  line[strcspn(line, "\r\n")] = '\0';
+  int cols = 0;
+  for (char *name = line, *next; name; name = next, cols++) { // strtok isn't thread-safe
+    if ((next = strchr(name, ',')))
+      *next++ = '\0';
+    if (cols == PLOT_MAX_COLUMNS)
+      return -1;
+    if (strcmp(name, "time(s)") == 0)
+      c.time = cols;
+    for (int s = 0; s < S_COUNT; s++)
+      if (series_info[s].column && strcmp(name, series_info[s].column) == 0)
+        c.series[s] = cols;
+  }
+  if (c.time < 0)
+    return -1;
+
+  plot_columns(p, &c);
+  double row[PLOT_MAX_COLUMNS];
+  while (fgets(line, sizeof(line), file)) {
+    char *s = line, *end = NULL;
+    int n = 0;
+    while (n < cols) {
+      row[n++] = strtod(s, &end);
+      if (end == s || *end != ',')
+        break;
+      s = end + 1;
+    }
+    if (n == cols && end != s) // Skips short and malformed rows
+      plot_row(p, &c, row);
+  }
+
+  return ferror(file) ? -1 : 0;
+}
+
+/// @brief Reads a CSV or binary log into `p`
+/// @return 0 on success or -1 on failure
+static int plot_read(plot_t *p, const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return -1;
+
+  char magic[sizeof(LOGGER_BINARY_MAGIC)] = {0};
+  bool binary = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                memcmp(magic, LOGGER_BINARY_MAGIC, sizeof(magic)) == 0;
+  rewind(file);
+
+  int result = binary ? read_rlog(p, filename) : read_csv(p, file);
+  fclose(file);
+
+  return result == 0 && p->rows > 0 ? 0 : -1;
+}
+
+// 5x7 font of the printable ASCII characters, one byte per column, top row in the lowest bit
+static const uint8_t font[95][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00},
+    {0x00, 0x40, 0x34, 0x00, 0x00}, {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, {0x3E, 0x41, 0x5D, 0x59, 0x4E},
+    {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x73}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x26, 0x49, 0x49, 0x49, 0x32}, {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40},
+    {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, {0x38, 0x44, 0x44, 0x28, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00},
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0xFC, 0x18, 0x24, 0x24, 0x18},
+    {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24},
+    {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x77, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},
+};
+
+// Text sizes, the PNG scales the font by size / TEXT_SCALE
+enum { TEXT_TICK = 10, TEXT_LABEL = 12, TEXT_TITLE = 14 };
+#define TEXT_SCALE 7
+#define GLYPH_ADVANCE 6
+
+/**
+ * @struct figure_t
+ * @brief Destinations of the drawing: an SVG file and a palette image, either may be unused
+ *
+ */
+typedef struct figure_t {
+  FILE *svg;
+  uint8_t *pixels; // FIGURE_WIDTH x FIGURE_HEIGHT color indices or NULL
+
+} figure_t;
+
+static void raster_dot(figure_t *f, int x, int y, int size, int color) {
+  for (int dy = 0; dy < size; dy++)
+    for (int dx = 0; dx < size; dx++) {
+      int px = x - size / 2 + dx, py = y - size / 2 + dy;
+      if (px >= 0 && px < FIGURE_WIDTH && py >= 0 && py < FIGURE_HEIGHT)
+        f->pixels[py * FIGURE_WIDTH + px] = (uint8_t)color;
+    }
+}
+
+static void raster_line(figure_t *f, double x0, double y0, double x1, double y1, int size,
+                        int color) {
+  int ax = (int)lround(x0), ay = (int)lround(y0), bx = (int)lround(x1), by = (int)lround(y1);
+  int dx = abs(bx - ax), dy = -abs(by - ay), sx = ax < bx ? 1 : -1, sy = ay < by ? 1 : -1;
+
+  for (int err = dx + dy;;) {
+    raster_dot(f, ax, ay, size, color);
+    if (ax == bx && ay == by)
+      break;
+    int e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      ax += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      ay += sy;
+    }
+  }
+}
+
+static void figure_line(figure_t *f, double x0, double y0, double x1, double y1, double width,
+                        int color) {
+  if (f->svg)
+    fprintf(f->svg,
+            "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"%s\" "
+            "stroke-width=\"%g\"/>\n",
+            x0, y0, x1, y1, colors[color].name, width);
+  if (f->pixels)
+    raster_line(f, x0, y0, x1, y1, (int)width, color);
+}
+
+static void figure_polyline(figure_t *f, const point_t *points, size_t count, double width,
+                            int color) {
+  if (count == 0)
+    return;
+
+  if (f->svg) {
+    fprintf(f->svg,
+            "<polyline fill=\"none\" stroke=\"%s\" stroke-width=\"%g\" "
+            "stroke-linejoin=\"round\" points=\"",
+            colors[color].name, width);
+    for (size_t i = 0; i < count; i++)
+      fprintf(f->svg, i ? " %.1f,%.1f" : "%.1f,%.1f", points[i].t, points[i].v);
+    fprintf(f->svg, "\"/>\n");
+  }
+
+  if (f->pixels)
+    for (size_t i = 0; i + 1 < MAX(count, 2); i++) {
+      const point_t *b = &points[MIN(i + 1, count - 1)];
+      raster_line(f, points[i].t, points[i].v, b->t, b->v, (int)width, color);
+    }
+}
+
+/// @param anchor -1 if (x, y) is the start of the text, 0 its middle and 1 its end
+/// @param vertical Text runs upwards
+static void figure_text(figure_t *f, double x, double y, const char *text, int size, int anchor,
+                        bool vertical) {
+  if (f->svg) {
+    static const char *anchors[] = {"start", "middle", "end"};
+    fprintf(f->svg, "<text x=\"%.1f\" y=\"%.1f\" font-size=\"%d\" text-anchor=\"%s\"", x, y,
+            size, anchors[anchor + 1]);
+    if (vertical)
+      fprintf(f->svg, " transform=\"rotate(-90 %.1f %.1f)\"", x, y);
+    fprintf(f->svg, ">%s</text>\n", text);
+  }
+
+  if (!f->pixels)
+    return;
+
+  // (x, y) is on the baseline, like in SVG
+  int scale = MAX(size / TEXT_SCALE, 1), length = (int)strlen(text) * GLYPH_ADVANCE * scale;
+  int start = -(anchor + 1) * length / 2;
+  for (int i = 0; text[i]; i++) {
+    int c = (unsigned char)text[i];
+    const uint8_t *glyph = font[c >= 32 && c < 127 ? c - 32 : '?' - 32];
+    for (int col = 0; col < 5; col++)
+      for (int row = 0; row < 8; row++) {
+        if (!(glyph[col] >> row & 1))
+          continue;
+        // Offsets along and across the text, from the baseline
+        int along = start + (i * GLYPH_ADVANCE + col) * scale, across = (row - 7) * scale;
+        for (int sy = 0; sy < scale; sy++)
+          for (int sx = 0; sx < scale; sx++) {
+            int px = vertical ? (int)x + across + sy : (int)x + along + sx;
+            int py = vertical ? (int)y - along - sx : (int)y + across + sy;
+            raster_dot(f, px, py, 1, C_BLACK);
+          }
+      }
+  }
+}
+
+static double tick_step(double range) {
+  double raw = range / AXIS_TICKS, magnitude = pow(10, floor(log10(raw))), norm = raw / magnitude;
+
+  return (norm < 1.5 ? 1 : norm < 3 ? 2 : norm < 7 ? 5 : 10) * magnitude;
+}
+
+// Padded range of the data
+static void axis_range(double lo, double hi, double *from, double *to) {
+  double pad = hi > lo ? (hi - lo) * AXIS_PADDING : MAX(fabs(lo) * AXIS_PADDING, 1);
+  *from = lo - pad;
+  *to = hi + pad;
+}
+
+static void draw_panel(figure_t *f, const plot_t *p, const panel_t *panel, int index) {
+  double left = (index % PANEL_COLUMNS) * PANEL_WIDTH + MARGIN_LEFT;
+  double top = (index / PANEL_COLUMNS) * PANEL_HEIGHT + MARGIN_TOP;
+  double right = left + AREA_WIDTH, bottom = top + AREA_HEIGHT;
+
+  double lo = INFINITY, hi = -INFINITY;
+  for (int s = panel->first; s < panel->first + panel->count; s++)
+    for (int k = 0; p->present[s] && k < BUCKETS; k++)
+      if (p->buckets[s][k].used) {
+        lo = MIN(lo, p->buckets[s][k].min.v);
+        hi = MAX(hi, p->buckets[s][k].max.v);
+      }
+  if (lo > hi) // Columns are logged, but without a finite value
+    lo = hi = 0;
+
+  double t_from, t_to, v_from, v_to;
+  axis_range(p->t0, p->t_end, &t_from, &t_to);
+  axis_range(lo, hi, &v_from, &v_to);
+#define X(t) (left + ((t) - t_from) / (t_to - t_from) * AREA_WIDTH)
+#define Y(v) (bottom - ((v) - v_from) / (v_to - v_from) * AREA_HEIGHT)
+
+  char label[32];
+  double step = tick_step(t_to - t_from);
+  for (double t = ceil(t_from / step) * step; t <= t_to; t += step) {
+    figure_line(f, X(t), top, X(t), bottom, 1, C_GRID);
+    snprintf(label, sizeof(label), "%g", fabs(t) < step * 1e-9 ? 0 : t);
+    figure_text(f, X(t), bottom + 16, label, TEXT_TICK, 0, false);
+  }
+  step = tick_step(v_to - v_from);
+  for (double v = ceil(v_from / step) * step; v <= v_to; v += step) {
+    figure_line(f, left, Y(v), right, Y(v), 1, C_GRID);
+    snprintf(label, sizeof(label), "%g", fabs(v) < step * 1e-9 ? 0 : v);
+    figure_text(f, left - 6, Y(v) + 4, label, TEXT_TICK, 1, false);
+  }
+
+  // Every bucket becomes its distinct points in time order
+  static const size_t capacity = 4 * BUCKETS;
+  point_t *points = (point_t *)malloc(capacity * sizeof(point_t));
+  for (int s = panel->first; points && s < panel->first + panel->count; s++) {
+    if (!p->present[s])
+      continue;
+
+    size_t n = 0;
+    for (int k = 0; k < BUCKETS; k++) {
+      const bucket_t *b = &p->buckets[s][k];
+      if (!b->used)
+        continue;
+
+      point_t q[4] = {b->first, b->min, b->max, b->last};
+      for (int i = 1; i < 4; i++)
+        for (int j = i; j > 0 && q[j].t < q[j - 1].t; j--) {
+          point_t tmp = q[j];
+          q[j] = q[j - 1];
+          q[j - 1] = tmp;
+        }
+      for (int i = 0; i < 4; i++)
+        if (i == 0 || q[i].t != q[i - 1].t || q[i].v != q[i - 1].v)
+          points[n++] = (point_t){X(q[i].t), Y(q[i].v)};
+    }
+    figure_polyline(f, points, n, 2, series_info[s].color);
+  }
+  free(points);
+#undef X
+#undef Y
+
+  figure_line(f, left, top, right, top, 1, C_BLACK);
+  figure_line(f, right, top, right, bottom, 1, C_BLACK);
+  figure_line(f, right, bottom, left, bottom, 1, C_BLACK);
+  figure_line(f, left, bottom, left, top, 1, C_BLACK);
+
+  figure_text(f, (left + right) / 2, top - 10, panel->title, TEXT_TITLE, 0, false);
+  figure_text(f, (left + right) / 2, bottom + 38, "Time (s)", TEXT_LABEL, 0, false);
+  figure_text(f, left - MARGIN_LEFT + 20, (top + bottom) / 2, panel->ylabel, TEXT_LABEL, 0, true);
+
+  if (panel->legend)
+    for (int s = panel->first, row = 0; s < panel->first + panel->count; s++) {
+      if (!p->present[s])
+        continue;
+      double y = top + 14 + 16 * row++;
+      figure_line(f, right - 150, y - 4, right - 125, y - 4, 2, series_info[s].color);
+      figure_text(f, right - 118, y, series_info[s].label, TEXT_TICK, -1, false);
+    }
+}
+
+typedef struct bits_t {
+  uint8_t *data;
+  size_t size;
+  uint32_t buffer;
+  int count;
+
+} bits_t;
+
+// Appends the `n` lowest bits of `value`, least significant first
+static void bits_put(bits_t *b, uint32_t value, int n) {
+  b->buffer |= value << b->count;
+  for (b->count += n; b->count >= 8; b->count -= 8, b->buffer >>= 8)
+    b->data[b->size++] = (uint8_t)b->buffer;
+}
+
+// Symbol of the fixed Huffman code of deflate, codes are stored most significant bit first
+static void deflate_symbol(bits_t *b, int symbol) {
+  uint32_t code;
+  int length;
+  if (symbol < 144)
+    code = 0x30 + symbol, length = 8;
+  else if (symbol < 256)
+    code = 0x190 + symbol - 144, length = 9;
+  else if (symbol < 280)
+    code = symbol - 256, length = 7;
+  else
+    code = 0xC0 + symbol - 280, length = 8;
+
+  uint32_t reversed = 0;
+  for (int i = 0; i < length; i++)
+    reversed |= (code >> i & 1) << (length - 1 - i);
+  bits_put(b, reversed, length);
+}
+
+// Repeats the previous byte `length`(3..258) times: a match at distance 1
+static void deflate_run(bits_t *b, int length) {
+  static const int base[] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                             31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static const int extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                              2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  int k = 28;
+  while (base[k] > length)
+    k--;
+
+  deflate_symbol(b, 257 + k);
+  bits_put(b, length - base[k], extra[k]);
+  bits_put(b, 0, 5); // Distance code 0
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size) {
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; k++)
+      crc = crc >> 1 ^ (0xEDB88320u & -(crc & 1));
+  }
+
+  return ~crc;
+}
+
+static void png_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t size) {
+  uint8_t header[8] = {size >> 24, size >> 16 & 0xFF, size >> 8 & 0xFF, size & 0xFF};
+  memcpy(header + 4, type, 4);
+  uint32_t crc = crc32(crc32(0, header + 4, 4), data, size);
+  uint8_t tail[4] = {crc >> 24, crc >> 16 & 0xFF, crc >> 8 & 0xFF, crc & 0xFF};
+
+  fwrite(header, 1, 8, file);
+  fwrite(data, 1, size, file);
+  fwrite(tail, 1, 4, file);
+}
+
+/// @brief Writes the image of `f` as an 8-bit palette PNG. The pixels are compressed with
+/// deflate using the fixed Huffman code and runs of equal bytes only, which is enough for
+/// the flat colors of a plot
+/// @return 0 on success or -1 on failure
+static int png_write(const figure_t *f, FILE *file) {
+  size_t stride = FIGURE_WIDTH + 1, size = stride * FIGURE_HEIGHT; // Filter byte per row
+  uint8_t *raw = (uint8_t *)malloc(size);
+  bits_t b = {(uint8_t *)malloc(size * 9 / 8 + 64), 0, 0, 0}; // 9 bits per literal at worst
+  if (!raw || !b.data) {
+    free(raw);
+    free(b.data);
+    return -1;
+  }
+
+  for (int y = 0; y < FIGURE_HEIGHT; y++) {
+    raw[y * stride] = 0;
+    memcpy(raw + y * stride + 1, f->pixels + y * FIGURE_WIDTH, FIGURE_WIDTH);
+  }
+
+  bits_put(&b, 0x78, 8); // zlib header
+  bits_put(&b, 0x01, 8);
+  bits_put(&b, 1, 1); // Final block
+  bits_put(&b, 1, 2); // Fixed Huffman code
+  for (size_t i = 0; i < size;) {
+    deflate_symbol(&b, raw[i]);
+    size_t run = 0;
+    while (i + 1 + run < size && run < 258 && raw[i + 1 + run] == raw[i])
+      run++;
+    if (run >= 3) {
+      deflate_run(&b, (int)run);
+      i += 1 + run;
+    } else
+      i++;
+  }
+  deflate_symbol(&b, 256);
+  bits_put(&b, 0, (8 - b.count) % 8); // Pads to a whole byte
+
+  uint32_t s1 = 1, s2 = 0; // Adler-32
+  for (size_t i = 0; i < size; i++) {
+    s1 = (s1 + raw[i]) % 65521;
+    s2 = (s2 + s1) % 65521;
+  }
+  bits_put(&b, s2 >> 8, 8);
+  bits_put(&b, s2 & 0xFF, 8);
+  bits_put(&b, s1 >> 8, 8);
+  bits_put(&b, s1 & 0xFF, 8);
+
+  uint8_t ihdr[13] = {0, 0, FIGURE_WIDTH >> 8, FIGURE_WIDTH & 0xFF, 0, 0, FIGURE_HEIGHT >> 8,
+                      FIGURE_HEIGHT & 0xFF, 8, 3, 0, 0, 0}; // 8-bit palette
+  uint8_t plte[3 * C_COUNT];
+  for (int c = 0; c < C_COUNT; c++)
+    memcpy(plte + 3 * c, colors[c].rgb, 3);
+
+  fwrite("\x89PNG\r\n\x1a\n", 1, 8, file);
+  png_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+  png_chunk(file, "PLTE", plte, sizeof(plte));
+  png_chunk(file, "IDAT", b.data, (uint32_t)b.size);
+  png_chunk(file, "IEND", NULL, 0);
+
+  free(raw);
+  free(b.data);
+
+  return ferror(file) ? -1 : 0;
+}
+
+/// @brief Draws the panels of `p`, skipping those without logged columns like stats.py
+static void figure_draw(figure_t *f, const plot_t *p) {
+  if (f->svg)
+    fprintf(f->svg,
+            "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" "
+            "viewBox=\"0 0 %d %d\" font-family=\"sans-serif\">\n"
+            "<rect width=\"100%%\" height=\"100%%\" fill=\"white\"/>\n",
+            FIGURE_WIDTH, FIGURE_HEIGHT, FIGURE_WIDTH, FIGURE_HEIGHT);
+
+  for (int i = 0; i < PANEL_COUNT; i++) {
+    bool shown = false;
+    for (int s = panels[i].first; s < panels[i].first + panels[i].count; s++)
+      shown |= p->present[s];
+    if (shown)
+      draw_panel(f, p, &panels[i], i);
+  }
+
+  if (f->svg)
+    fprintf(f->svg, "</svg>\n");
+}
+
+// Output file: `filename` with `extension` appended, so x.csv and x.rlog don't share a figure
+static int output_name(char *out, size_t size, const char *filename, const char *extension) {
+  int length = snprintf(out, size, "%s%s", filename, extension);
+  return length < 0 || (size_t)length >= size ? -1 : 0;
+}
+
+typedef struct plot_job_t {
+  char **files;
+  bool svg, png;
+  int *failed;
+
+} plot_job_t;
+
+static void plot_file(void *ctx, size_t i, int worker) {
+  (void)worker;
+  plot_job_t *job = (plot_job_t *)ctx;
+  const char *filename = job->files[i];
+  plot_t *p = (plot_t *)calloc(1, sizeof(plot_t));
+  figure_t f = {0};
+  char name[PLOT_MAX_LINE];
+
+  if (!p || plot_read(p, filename) != 0) {
+    fprintln(stderr, "Can't read the log '%s'", filename);
+    goto fail;
+  }
+
+  if (job->svg) {
+    if (output_name(name, sizeof(name), filename, ".svg") != 0 || !(f.svg = fopen(name, "w"))) {
+      fprintln(stderr, "Can't write '%s'", name);
+      goto fail;
+    }
+  }
+  if (job->png) {
+    f.pixels = (uint8_t *)malloc(FIGURE_WIDTH * FIGURE_HEIGHT);
+    if (!f.pixels)
+      goto fail;
+    memset(f.pixels, C_WHITE, FIGURE_WIDTH * FIGURE_HEIGHT);
+  }
+
+  figure_draw(&f, p);
+
+  if (f.svg) {
+    if (ferror(f.svg) | fclose(f.svg)) {
+      f.svg = NULL;
+      fprintln(stderr, "Can't write '%s'", name);
+      goto fail;
+    }
+    f.svg = NULL;
+    println("Plot saved to %s", name);
+  }
+  if (f.pixels) {
+    FILE *file = output_name(name, sizeof(name), filename, ".png") == 0 ? fopen(name, "wb") : NULL;
+    int result = file ? png_write(&f, file) : -1;
+    if (!file || (fclose(file) | result) != 0) {
+      fprintln(stderr, "Can't write '%s'", name);
+      goto fail;
+    }
+    println("Plot saved to %s", name);
+  }
+
+  free(f.pixels);
+  free(p);
+  return;
+
+fail:
+  job->failed[i] = 1;
+  if (f.svg)
+    fclose(f.svg);
+  free(f.pixels);
+  free(p);
+}
+
+void usage() {
+  puts("Usage: plot [OPTIONS] <log>...\n"
+       "Writes the figure of every CSV or .rlog log next to it(<log>.svg)\n"
+       "OPTIONS:\n"
+       "--png\t\t\tAlso write <log>.png\n"
+       "--no-svg\t\tDon't write <log>.svg\n"
+       "--threads <number>\tWorker threads(default is one per CPU)\n"
+       "-h\t\t\tPrint this help message");
+}
+
+int main(int argc, char *argv[]) {
+  bool to_svg = true, to_png = false;
+  int threads = 0, count = 0;
+  char **files = (char **)malloc(sizeof(char *) * argc);
+  if (!files)
+    return -1;
+
+  // Parsing cmd args
+  for (int i = 1; i < argc; i++) {
+    char *token = argv[i];
+    if (strcmp(token, "-h") == 0) {
+      usage();
+      return 0;
+    } else if (strcmp(token, "--threads") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      if ((threads = atoi(argv[++i])) <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+    } else if (strcmp(token, "--png") == 0)
+      to_png = true;
+    else if (strcmp(token, "--no-svg") == 0)
+      to_svg = false;
+    else if (strncmp(token, "--", 2) == 0) {
+      println("Unknown flag: %s", token);
+      return -1;
+    } else
+      files[count++] = token;
+  }
+
+  if (count == 0 || (!to_svg && !to_png)) {
+    usage();
+    return -1;
+  }
+
+  int *failed = (int *)calloc(count, sizeof(int));
+  pool_t *pool = pool_create(MIN(threads > 0 ? threads : pool_default_threads(), count));
+  if (!failed || !pool)
+    return -1;
+
+  plot_job_t job = {files, to_svg, to_png, failed};
+  pool_for(pool, count, plot_file, &job);
+  pool_free(pool);
+
+  int failures = 0;
+  for (int i = 0; i < count; i++)
+    failures += failed[i];
+  free(failed);
+  free(files);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,437 @@
+#define _POSIX_C_SOURCE 200809L
+#define DISPLAY_IMPLEMENTATION
+#define DISPLAY_STRIP_PREFIX
+#include "common.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static const char *input_names[SURROGATE_INPUTS] = {"dry_mass", "fuel_mass", "altitude", "thrust",
+                                                    "consumption"};
+
+typedef struct box_t {
+  double lo[SURROGATE_INPUTS], hi[SURROGATE_INPUTS];
+
+} box_t;
+
+#define B(field) offsetof(box_t, field)
+
+// [surrogate] section: range of every input, ±10% around [rocket] and [engine] if not set
+static const fparser_binding_t box_bindings[] = {
+    {"surrogate", "dry_mass_min", B(lo[SURROGATE_DRY_MASS]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "dry_mass_max", B(hi[SURROGATE_DRY_MASS]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "fuel_mass_min", B(lo[SURROGATE_FUEL_MASS]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "fuel_mass_max", B(hi[SURROGATE_FUEL_MASS]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "altitude_min", B(lo[SURROGATE_ALTITUDE]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "altitude_max", B(hi[SURROGATE_ALTITUDE]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "thrust_min", B(lo[SURROGATE_THRUST]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "thrust_max", B(hi[SURROGATE_THRUST]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "consumption_min", B(lo[SURROGATE_CONSUMPTION]), FPARSER_DOUBLE, 0, false},
+    {"surrogate", "consumption_max", B(hi[SURROGATE_CONSUMPTION]), FPARSER_DOUBLE, 0, false},
+};
+
+#undef B
+
+/// @brief Reads the box of the training scenarios
+/// @return 0 on success or -1 on failure
+int load_box(fparser_t *fp, const scenario_params_t *params, box_t *box) {
+  if (fparser_bind(fp, box_bindings, sizeof(box_bindings) / sizeof(box_bindings[0]), box,
+                   stderr) != 0)
+    return -1;
+
+  double base[SURROGATE_INPUTS] = {params->dry_mass, params->fuel_mass, params->altitude,
+                                   params->eng.thrust, params->eng.consumption};
+  for (int k = 0; k < SURROGATE_INPUTS; k++) {
+    if (box->lo[k] == 0 && box->hi[k] == 0) {
+      box->lo[k] = 0.9 * base[k];
+      box->hi[k] = 1.1 * base[k];
+    }
+    if (box->lo[k] <= 0 || box->hi[k] <= box->lo[k]) {
+      fprintln(stderr, "Invalid range of %s: [%f, %f]", input_names[k], box->lo[k], box->hi[k]);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static uint64_t next_random(uint64_t *state) {
+  *state = *state * 6364136223846793005u + 1442695040888963407u;
+  return *state >> 11;
+}
+
+/// @brief Latin hypercube sample of `count` points in the box: every input hits every one of
+/// `count` equal strata exactly once
+void latin_hypercube(const box_t *box, int count, uint64_t seed, double *points) {
+  int *strata = (int *)malloc(sizeof(int) * count);
+  assert(strata);
+
+  for (int k = 0; k < SURROGATE_INPUTS; k++) {
+    for (int i = 0; i < count; i++)
+      strata[i] = i;
+    for (int i = count - 1; i > 0; i--) { // Fisher-Yates
+      int j = (int)(next_random(&seed) % (uint64_t)(i + 1)), t = strata[i];
+      strata[i] = strata[j];
+      strata[j] = t;
+    }
+
+    for (int i = 0; i < count; i++) {
+      double u = (strata[i] + (double)next_random(&seed) / (double)(1ull << 53)) / count;
+      points[i * SURROGATE_INPUTS + k] = box->lo[k] + u * (box->hi[k] - box->lo[k]);
+    }
+  }
+
+  free(strata);
+}
+
+typedef struct sample_job_t {
+  const planet_t *pl;
+  double dt, eps;
+  const double *inputs;
+  double *outputs;
+  bool *lands;
+
+} sample_job_t;
+
+static void sample_scenario(void *ctx, size_t i, int worker) {
+  (void)worker;
+  sample_job_t *job = (sample_job_t *)ctx;
+  job->lands[i] = landing_outcome(job->pl, job->inputs + i * SURROGATE_INPUTS, job->dt, job->eps,
+                                  job->outputs + i * SURROGATE_OUTPUTS);
+}
+
+/// @brief Fits the models to the scenarios which landed
+/// @return Number of training points or -1 on failure
+int fit_surrogate(landing_surrogate_t *s, const double *inputs, const double *outputs,
+                  const bool *lands, int count) {
+  double *x = (double *)malloc(sizeof(double) * count * SURROGATE_INPUTS);
+  double *y = (double *)malloc(sizeof(double) * count);
+  if (!x || !y) {
+    free(x);
+    free(y);
+    return -1;
+  }
+
+  int n = 0;
+  for (int i = 0; i < count; i++) {
+    if (!lands[i])
+      continue;
+    for (int k = 0; k < SURROGATE_INPUTS; k++)
+      x[n * SURROGATE_INPUTS + k] =
+          (inputs[i * SURROGATE_INPUTS + k] - s->lo[k]) / (s->hi[k] - s->lo[k]);
+    n++;
+  }
+
+  int result = n;
+  for (int o = 0; o < SURROGATE_OUTPUTS && result > 0; o++) {
+    for (int i = 0, j = 0; i < count; i++)
+      if (lands[i])
+        y[j++] = outputs[i * SURROGATE_OUTPUTS + o];
+    if (gp_fit(&s->gp[o], x, y, n, SURROGATE_INPUTS) != 0)
+      result = -1;
+  }
+
+  free(x);
+  free(y);
+
+  return result;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/// @brief Scales the standard deviations of the models, so that two of them cover 95% of the
+/// errors on the validation scenarios. The marginal likelihood fit tends to make them too small.
+/// They are never made smaller
+/// @return 0 on success or -1 on failure
+int calibrate_sigma(landing_surrogate_t *s, const double *inputs, const double *outputs,
+                    const bool *lands, int count) {
+  double *z = (double *)malloc(sizeof(double) * count);
+  if (!z)
+    return -1;
+
+  for (int o = 0; o < SURROGATE_OUTPUTS; o++) {
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+      if (!lands[i])
+        continue;
+
+      double u[SURROGATE_INPUTS], sigma;
+      for (int k = 0; k < SURROGATE_INPUTS; k++)
+        u[k] = (inputs[i * SURROGATE_INPUTS + k] - s->lo[k]) / (s->hi[k] - s->lo[k]);
+      double error = gp_predict(&s->gp[o], u, &sigma) - outputs[i * SURROGATE_OUTPUTS + o];
+      z[n++] = sigma > 0 ? fabs(error) / sigma : 0;
+    }
+
+    s->sigma_scale[o] = 1;
+    if (n == 0)
+      continue;
+    qsort(z, n, sizeof(double), compare_doubles);
+    s->sigma_scale[o] = MAX(1, z[(int)ceil(0.95 * n) - 1] / 2);
+  }
+
+  free(z);
+
+  return 0;
+}
+
+/// @brief Compares the predictions of the model with simulated scenarios and prints the RMSE,
+/// how many of the errors are inside two standard deviations of the model and the factor
+/// calibrate_sigma applied to them
+void print_validation(const landing_surrogate_t *s, const double *inputs, const double *outputs,
+                      const bool *lands, int count, double max_sigma) {
+  static const char *names[SURROGATE_OUTPUTS] = {"ignition_time", "landing_velocity",
+                                                 "fuel_mass"};
+  double squares[SURROGATE_OUTPUTS] = {0};
+  int covered[SURROGATE_OUTPUTS] = {0}, n = 0, uncertain = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (!lands[i])
+      continue;
+
+    const double *in = inputs + i * SURROGATE_INPUTS;
+    double u[SURROGATE_INPUTS];
+    for (int k = 0; k < SURROGATE_INPUTS; k++)
+      u[k] = (in[k] - s->lo[k]) / (s->hi[k] - s->lo[k]);
+
+    for (int o = 0; o < SURROGATE_OUTPUTS; o++) {
+      double sigma, error = gp_predict(&s->gp[o], u, &sigma) - outputs[i * SURROGATE_OUTPUTS + o];
+      squares[o] += error * error;
+      covered[o] += fabs(error) <= 2 * sigma;
+      if (o == SURROGATE_FUEL)
+        uncertain += sigma * s->sigma_scale[o] > max_sigma;
+    }
+    n++;
+  }
+
+  if (n == 0)
+    return;
+
+  println("output,rmse,within_2_raw_sigma,sigma_scale");
+  for (int o = 0; o < SURROGATE_OUTPUTS; o++)
+    println("%s,%f,%.1f%%,%.3f", names[o], sqrt(squares[o] / n), 100.0 * covered[o] / n,
+            s->sigma_scale[o]);
+  println("%d of %d validation scenarios would fall back to simulation(--max-sigma %g)",
+          uncertain, n, max_sigma);
+}
+
+/// @brief Answers the queries of a CSV file(dry_mass,fuel_mass,altitude,thrust,consumption per
+/// line, lines which don't parse are skipped)
+int run_queries(const landing_surrogate_t *s, const char *filename, double max_sigma) {
+  FILE *file = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+  if (!file)
+    return -1;
+
+  char line[MAX_LINE];
+  int simulated = 0, total = 0;
+  double start = bench_now();
+
+  println("dry_mass,fuel_mass,altitude,thrust,consumption,lands,source,ignition_time,"
+          "ignition_sigma,landing_velocity,velocity_sigma,fuel_mass_left,fuel_sigma");
+  while (fgets(line, sizeof(line), file)) {
+    double in[SURROGATE_INPUTS];
+    if (sscanf(line, "%lf,%lf,%lf,%lf,%lf", &in[0], &in[1], &in[2], &in[3], &in[4]) != 5)
+      continue;
+
+    landing_prediction_t p = landing_surrogate_predict(s, in, max_sigma);
+    total++;
+    simulated += p.simulated;
+
+    if (!p.lands) {
+      println("%g,%g,%g,%g,%g,no,%s,,,,,,", in[0], in[1], in[2], in[3], in[4],
+              p.simulated ? "simulation" : "delta-v");
+      continue;
+    }
+    println("%g,%g,%g,%g,%g,yes,%s,%f,%f,%f,%f,%f,%f", in[0], in[1], in[2], in[3], in[4],
+            p.simulated ? "simulation" : "model", p.value[SURROGATE_IGNITION],
+            p.sigma[SURROGATE_IGNITION], p.value[SURROGATE_VELOCITY], p.sigma[SURROGATE_VELOCITY],
+            p.value[SURROGATE_FUEL], p.sigma[SURROGATE_FUEL]);
+  }
+
+  if (file != stdin)
+    fclose(file);
+
+  fprintln(stderr, "%d queries in %.3f s, %d simulated", total, bench_now() - start, simulated);
+
+  return 0;
+}
+
+void usage() {
+  puts("OPTIONS:\n"
+       "--rocket <file>\t\tSpecify file with simulation parameters and [surrogate] ranges\n"
+       "--samples <number>\tTraining scenarios(default is 200)\n"
+       "--validate <number>\tScenarios to check and calibrate the model on(default is 50)\n"
+       "--seed <number>\t\tSeed of the sampling(default is 1)\n"
+       "--threads <number>\tWorker threads(default is one per CPU)\n"
+       "--no-pin\t\tDon't pin the workers to CPUs\n"
+       "--model <file>\t\tModel file to write, or to read with --query(default is landing.gp)\n"
+       "--query <file>\t\tPredict the scenarios of a CSV file('-' for stdin)\n"
+       "--max-sigma <number>\tSimulate when the fuel mass is less certain(kg, default is 10)\n"
+       "--dt <number>\t\tChange dt variable(default is 2e-3)\n"
+       "--eps <number>\t\tChange eps variable(default is 1e-4)\n"
+       "-h\t\t\tPrint this help message");
+}
+
+int main(int argc, char *argv[]) {
+  double dt = 2e-3, eps = 1e-4, max_sigma = 10;
+  int samples = 200, validate = 50, threads = 0;
+  bool to_pin = true;
+  uint64_t seed = 1;
+  char *rocket_file = "rocket.dat", *model_file = "landing.gp", *query_file = NULL;
+
+  // Parsing cmd args
+  for (int i = 1; i < argc; i++) {
+    char *token = argv[i];
+    if (strcmp(token, "-h") == 0) {
+      usage();
+      return 0;
+    } else if (strcmp(token, "--dt") == 0 || strcmp(token, "--eps") == 0 ||
+               strcmp(token, "--max-sigma") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      double value = atof(argv[++i]);
+      if (value <= 0) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--dt") == 0)
+        dt = value;
+      else if (strcmp(token, "--eps") == 0)
+        eps = value;
+      else
+        max_sigma = value;
+    } else if (strcmp(token, "--samples") == 0 || strcmp(token, "--validate") == 0 ||
+               strcmp(token, "--seed") == 0 || strcmp(token, "--threads") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      int value = atoi(argv[++i]);
+      if (value < 0 || (value == 0 && strcmp(token, "--validate") != 0)) {
+        fprintln(stderr, "Invalid value : %s", argv[i]);
+        return -1;
+      }
+      if (strcmp(token, "--samples") == 0)
+        samples = value;
+      else if (strcmp(token, "--validate") == 0)
+        validate = value;
+      else if (strcmp(token, "--seed") == 0)
+        seed = value;
+      else
+        threads = value;
+    } else if (strcmp(token, "--rocket") == 0 || strcmp(token, "--model") == 0 ||
+               strcmp(token, "--query") == 0) {
+      if (!argv[i + 1]) {
+        fprintln(stderr, "Expected value after '%s'!", token);
+        return -1;
+      }
+      if (strcmp(token, "--rocket") == 0)
+        rocket_file = argv[++i];
+      else if (strcmp(token, "--model") == 0)
+        model_file = argv[++i];
+      else
+        query_file = argv[++i];
+    } else if (strcmp(token, "--no-pin") == 0)
+      to_pin = false;
+    else {
+      println("Unknown flag: %s", token);
+      return -1;
+    }
+  }
+
+  landing_surrogate_t s = {0};
+
+  if (query_file) {
+    if (landing_surrogate_read(&s, model_file) != 0) {
+      fprintln(stderr, "Can't read model '%s'!", model_file);
+      return -1;
+    }
+    int result = run_queries(&s, query_file, max_sigma);
+    if (result != 0)
+      fprintln(stderr, "Can't read queries '%s'!", query_file);
+    landing_surrogate_free(&s);
+    return result;
+  }
+
+  // Parsing 'rocket_file' file
+  fparser_t fp = fparser_init(rocket_file);
+  if (!fp.file) {
+    fprintln(stderr, "No '%s' file was found!", rocket_file);
+    return -1;
+  }
+
+  fparser_parse(&fp);
+  fparser_free(&fp);
+
+  scenario_params_t params = {0};
+  box_t box = {0};
+  if (scenario_params_load(&fp, &params) != 0 || load_box(&fp, &params, &box) != 0) {
+    fprintln(stderr, "Invalid '%s' file!", rocket_file);
+    return -1;
+  }
+
+  s.pl = params.pl;
+  s.dt = dt;
+  s.eps = eps;
+  memcpy(s.lo, box.lo, sizeof(s.lo));
+  memcpy(s.hi, box.hi, sizeof(s.hi));
+
+  // Training and validation scenarios are flown together
+  int total = samples + validate;
+  double *inputs = (double *)malloc(sizeof(double) * total * SURROGATE_INPUTS);
+  double *outputs = (double *)calloc((size_t)total * SURROGATE_OUTPUTS, sizeof(double));
+  bool *lands = (bool *)calloc(total, sizeof(bool));
+  topology_t topo = to_pin ? topology_detect() : (topology_t){0};
+  pool_t *pool = pool_create_pinned(threads, &topo);
+  assert(inputs && outputs && lands && pool);
+
+  latin_hypercube(&box, samples, seed, inputs);
+  if (validate)
+    latin_hypercube(&box, validate, ~seed, inputs + samples * SURROGATE_INPUTS);
+
+  double start = bench_now();
+  sample_job_t job = {&s.pl, dt, eps, inputs, outputs, lands};
+  pool_for(pool, total, sample_scenario, &job);
+  double simulated = bench_now() - start;
+  pool_free(pool);
+  topology_free(&topo);
+
+  start = bench_now();
+  int trained = fit_surrogate(&s, inputs, outputs, lands, samples);
+  if (trained < 2) {
+    fprintln(stderr, "Not enough landing scenarios to train on(%d)", trained);
+    return -1;
+  }
+  println("Trained on %d of %d scenarios(%.3f s of simulation on %d threads, %.3f s of fitting)",
+          trained, samples, simulated, threads > 0 ? threads : pool_default_threads(),
+          bench_now() - start);
+
+  for (int o = 0; o < SURROGATE_OUTPUTS; o++)
+    s.sigma_scale[o] = 1;
+  if (validate) {
+    if (calibrate_sigma(&s, inputs + samples * SURROGATE_INPUTS,
+                        outputs + samples * SURROGATE_OUTPUTS, lands + samples, validate) != 0)
+      return -1;
+    print_validation(&s, inputs + samples * SURROGATE_INPUTS,
+                     outputs + samples * SURROGATE_OUTPUTS, lands + samples, validate, max_sigma);
+  } else
+    fprintln(stderr, "No validation scenarios: the standard deviations are not calibrated");
+
+  if (landing_surrogate_write(&s, model_file) != 0) {
+    fprintln(stderr, "Can't write model '%s'!", model_file);
+    return -1;
+  }
+  println("Model written to %s", model_file);
+
+  landing_surrogate_free(&s);
+  free(inputs);
+  free(outputs);
+  free(lands);
+
+  return 0;
+}
@@ -1,74 +1,121 @@
 import matplotlib.pyplot as plt
+import numpy as np
 import pandas as pd
+import struct
 import sys
 import os
 
+# Binary log layout (see rocketlib/include/rocketlib/logger.h):
+# magic[8], uint32 version, uint32 columns, uint64 rows, uint64 data_offset,
+# comma separated column names, then rows * columns float64 values (row-major)
+RLOG_MAGIC = b'RLOGBIN\0'
+RLOG_HEADER = struct.Struct('<8sIIQQ')
+
+def read_binary_log(filename):
+    with open(filename, 'rb') as f:
+        magic, version, cols, rows, data_offset = RLOG_HEADER.unpack(f.read(RLOG_HEADER.size))
+        names = f.read(data_offset - RLOG_HEADER.size).split(b'\0', 1)[0].decode()
+
+    if rows == 0: # Writer didn't finish, use every complete row
+        rows = (os.path.getsize(filename) - data_offset) // (8 * cols)
+
+    data = np.memmap(filename, dtype='<f8', mode='r', offset=data_offset, shape=(rows, cols))
+    return pd.DataFrame(data, columns=names.split(','), copy=False)
+
+def read_log(filename):
+    with open(filename, 'rb') as f:
+        is_binary = f.read(len(RLOG_MAGIC)) == RLOG_MAGIC
+
+    return read_binary_log(filename) if is_binary else pd.read_csv(filename)
+
+VELOCITY = ['velocityOx(m/s)', 'velocityOy(m/s)', 'velocityOz(m/s)']
+ACCELERATION = ['accOx(m/s^2)', 'accOy(m/s^2)', 'accOz(m/s^2)']
+
+def magnitude(df, columns):
+    # Logs may contain only some of the components (see --columns)
+    present = [c for c in columns if c in df]
+    if not present:
+        return None
+    return sum(df[c]**2 for c in present)**0.5
+
 def plot_data(df, filename):
     plt.figure(figsize=(16, 12))
+    # Without the time column (see --columns) the rows are plotted in order
+    if 'time(s)' in df:
+        t, x_label, vs = df['time(s)'], 'Time (s)', 'Time'
+    else:
+        t, x_label, vs = np.arange(len(df)), 'Sample', 'Sample'
     
     # 1. Altitude vs. Time
-    plt.subplot(3, 3, 1)
-    plt.plot(df['time(s)'], df['CoordinateOz(m)'], 'b-', linewidth=2)
-    plt.title('Altitude vs. Time')
-    plt.xlabel('Time (s)')
-    plt.ylabel('Altitude (m)')
-    plt.grid(True, alpha=0.3)
+    if 'CoordinateOz(m)' in df:
+        plt.subplot(3, 3, 1)
+        plt.plot(t, df['CoordinateOz(m)'], 'b-', linewidth=2)
+        plt.title('Altitude vs. ' + vs)
+        plt.xlabel(x_label)
+        plt.ylabel('Altitude (m)')
+        plt.grid(True, alpha=0.3)
     
     # 2. Velocity Components vs. Time
-    plt.subplot(3, 3, 2)
-    plt.plot(df['time(s)'], df['velocityOx(m/s)'], 'r-', label='Velocity X', linewidth=2)
-    plt.plot(df['time(s)'], df['velocityOy(m/s)'], 'g-', label='Velocity Y', linewidth=2)
-    plt.plot(df['time(s)'], df['velocityOz(m/s)'], 'b-', label='Velocity Z', linewidth=2)
-    plt.title('Velocity Components vs. Time')
-    plt.xlabel('Time (s)')
-    plt.ylabel('Velocity (m/s)')
-    plt.legend()
-    plt.grid(True, alpha=0.3)
+    if any(c in df for c in VELOCITY):
+        plt.subplot(3, 3, 2)
+        for column, style, label in zip(VELOCITY, ['r-', 'g-', 'b-'], ['Velocity X', 'Velocity Y', 'Velocity Z']):
+            if column in df:
+                plt.plot(t, df[column], style, label=label, linewidth=2)
+        plt.title('Velocity Components vs. ' + vs)
+        plt.xlabel(x_label)
+        plt.ylabel('Velocity (m/s)')
+        plt.legend()
+        plt.grid(True, alpha=0.3)
     
     # 3. Acceleration Components vs. Time
-    plt.subplot(3, 3, 3)
-    plt.plot(df['time(s)'], df['accOx(m/s^2)'], 'r-', label='Acceleration X', linewidth=2)
-    plt.plot(df['time(s)'], df['accOy(m/s^2)'], 'g-', label='Acceleration Y', linewidth=2)
-    plt.plot(df['time(s)'], df['accOz(m/s^2)'], 'b-', label='Acceleration Z', linewidth=2)
-    plt.title('Acceleration Components vs. Time')
-    plt.xlabel('Time (s)')
-    plt.ylabel('Acceleration (m/s²)')
-    plt.legend()
-    plt.grid(True, alpha=0.3)
+    if any(c in df for c in ACCELERATION):
+        plt.subplot(3, 3, 3)
+        for column, style, label in zip(ACCELERATION, ['r-', 'g-', 'b-'], ['Acceleration X', 'Acceleration Y', 'Acceleration Z']):
+            if column in df:
+                plt.plot(t, df[column], style, label=label, linewidth=2)
+        plt.title('Acceleration Components vs. ' + vs)
+        plt.xlabel(x_label)
+        plt.ylabel('Acceleration (m/s²)')
+        plt.legend()
+        plt.grid(True, alpha=0.3)
     
     # 4. Engine Thrust vs. Time
-    plt.subplot(3, 3, 4)
-    plt.plot(df['time(s)'], df['thrust_percent(%)'], 'purple', linewidth=2)
-    plt.title('Engine Thrust vs. Time')
-    plt.xlabel('Time (s)')
-    plt.ylabel('Thrust (%)')
-    plt.grid(True, alpha=0.3)
+    if 'thrust_percent(%)' in df:
+        plt.subplot(3, 3, 4)
+        plt.plot(t, df['thrust_percent(%)'], 'purple', linewidth=2)
+        plt.title('Engine Thrust vs. ' + vs)
+        plt.xlabel(x_label)
+        plt.ylabel('Thrust (%)')
+        plt.grid(True, alpha=0.3)
 
     # 5. Fuel Mass vs. Time
-    plt.subplot(3, 3, 5)
-    plt.plot(df['time(s)'], df['fuel_mass(kg)'], 'orange', linewidth=2)
-    plt.title('Fuel Mass vs. Time')
-    plt.xlabel('Time (s)')
-    plt.ylabel('Fuel Mass (kg)')
-    plt.grid(True, alpha=0.3)
+    if 'fuel_mass(kg)' in df:
+        plt.subplot(3, 3, 5)
+        plt.plot(t, df['fuel_mass(kg)'], 'orange', linewidth=2)
+        plt.title('Fuel Mass vs. ' + vs)
+        plt.xlabel(x_label)
+        plt.ylabel('Fuel Mass (kg)')
+        plt.grid(True, alpha=0.3)
     
     # 6. Total Velocity vs. Time
-    plt.subplot(3, 3, 6)
-    total_velocity = (df['velocityOx(m/s)']**2 + df['velocityOy(m/s)']**2 + df['velocityOz(m/s)']**2)**0.5
-    plt.plot(df['time(s)'], total_velocity, 'red', linewidth=2)
-    plt.title('Total Velocity vs. Time')
-    plt.xlabel('Time (s)')
-    plt.ylabel('Velocity (m/s)')
-    plt.grid(True, alpha=0.3)
+    total_velocity = magnitude(df, VELOCITY)
+    if total_velocity is not None:
+        plt.subplot(3, 3, 6)
+        plt.plot(t, total_velocity, 'red', linewidth=2)
+        plt.title('Total Velocity vs. ' + vs)
+        plt.xlabel(x_label)
+        plt.ylabel('Velocity (m/s)')
+        plt.grid(True, alpha=0.3)
     
     # 7. Total Acceleration vs. Time
-    plt.subplot(3, 3, 7)
-    total_acceleration = (df['accOx(m/s^2)']**2 + df['accOy(m/s^2)']**2 + df['accOz(m/s^2)']**2)**0.5
-    plt.plot(df['time(s)'], total_acceleration, 'darkblue', linewidth=2)
-    plt.title('Total Acceleration vs. Time')
-    plt.xlabel('Time (s)')
-    plt.ylabel('Acceleration (m/s²)')
-    plt.grid(True, alpha=0.3)
+    total_acceleration = magnitude(df, ACCELERATION)
+    if total_acceleration is not None:
+        plt.subplot(3, 3, 7)
+        plt.plot(t, total_acceleration, 'darkblue', linewidth=2)
+        plt.title('Total Acceleration vs. ' + vs)
+        plt.xlabel(x_label)
+        plt.ylabel('Acceleration (m/s²)')
+        plt.grid(True, alpha=0.3)
     
     plt.tight_layout()
     base_filename, _ = os.path.splitext(filename)
@@ -78,19 +125,23 @@ def plot_data(df, filename):
 
 
 def flight_summary(df):
-    max_total_velocity = (df['velocityOx(m/s)']**2 + df['velocityOy(m/s)']**2 + df['velocityOz(m/s)']**2)**0.5
-    max_total_acceleration = (df['accOx(m/s^2)']**2 + df['accOy(m/s^2)']**2 + df['accOz(m/s^2)']**2)**0.5
+    max_total_velocity = magnitude(df, VELOCITY)
+    max_total_acceleration = magnitude(df, ACCELERATION)
    
     print("\nFlight Summary:")
-    print(f"  Total flight time: {df['time(s)'].max():.2f} s")
-    print(f"  Maximum speed: {max_total_velocity.max():.2f} m/s")
-    print(f"  Maximum acceleration: {max_total_acceleration.max():.2f} m/s²")
-    print(f"  Fuel used: {(df['fuel_mass(kg)'].iloc[0] - df['fuel_mass(kg)'].iloc[-1]):.2f} kg")
+    if 'time(s)' in df:
+        print(f"  Total flight time: {df['time(s)'].max():.2f} s")
+    if max_total_velocity is not None:
+        print(f"  Maximum speed: {max_total_velocity.max():.2f} m/s")
+    if max_total_acceleration is not None:
+        print(f"  Maximum acceleration: {max_total_acceleration.max():.2f} m/s²")
+    if 'fuel_mass(kg)' in df:
+        print(f"  Fuel used: {(df['fuel_mass(kg)'].iloc[0] - df['fuel_mass(kg)'].iloc[-1]):.2f} kg")
 
 # Main program
 if __name__ == "__main__":
     if len(sys.argv) < 2:
-       print("Usage: python3 stats.py <path_to_csv_file>")
+       print("Usage: python3 stats.py <path_to_csv_or_rlog_file>")
        sys.exit(1) 
 
     filename = sys.argv[1] 
@@ -99,9 +150,9 @@ if __name__ == "__main__":
         sys.exit(1)
 
     try:
-        df = pd.read_csv(filename)
+        df = read_log(filename)
     except Exception as e:
-        print(f"Error reading or parsing CSV file: {e}")
+        print(f"Error reading or parsing log file: {e}")
         sys.exit(1)
     
     # Generate plot